@@ -25,9 +25,25 @@
 
 #include "casadi_interrupt.hpp"
 
+#include <thread>
+
 namespace casadi {
 
   bool (*InterruptHandler::checkInterrupted)() =
     InterruptHandler::checkInterruptedDefault;
 
+  const std::atomic<bool>*& InterruptHandler::cancel_flag() {
+    static thread_local const std::atomic<bool>* flag = 0;
+    return flag;
+  }
+
+  namespace {
+    // Thread that loaded the library
+    const std::thread::id main_thread_id = std::this_thread::get_id();
+  } // namespace
+
+  bool InterruptHandler::is_main_thread() {
+    return std::this_thread::get_id()==main_thread_id;
+  }
+
 } // namespace casadi
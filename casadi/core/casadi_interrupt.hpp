@@ -31,6 +31,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <atomic>
 
 namespace casadi {
 
@@ -58,9 +59,39 @@ namespace casadi {
     /// The routine that is used for checking interrupts
     static bool (*checkInterrupted)();
 
-    /// Raises an error if an interrupt was captured.
+    /** \brief Cancellation token of the task executing on the current thread
+     *
+     * Null unless the thread is executing a task of the AsyncExecutor that belongs to
+     * an evaluation started with Function::call_async. The token is stored with the
+     * task and installed by the executor for the duration of the task.
+     */
+    static const std::atomic<bool>*& cancel_flag();
+
+    /** \brief Is the current thread the one that loaded CasADi
+     *
+     * The Python and MATLAB interfaces only poll for interrupts on this thread,
+     * since it holds the interpreter.
+     */
+    static bool is_main_thread();
+
+    /// Raises an error if the asynchronous evaluation on the current thread was cancelled
+    static void check_cancelled() {
+      const std::atomic<bool>* flag = cancel_flag();
+      casadi_assert_message(flag==0 || !*flag, "Cancelled.");
+    }
+
+    /** \brief Raises an error if an interrupt was captured.
+     *
+     * For asynchronous evaluations, the cancellation token is checked instead,
+     * interrupts are captured by the thread waiting for the result.
+     */
     static void check() {
-      casadi_assert_message(!checkInterrupted(), "Interrupted by user.");
+      const std::atomic<bool>* flag = cancel_flag();
+      if (flag) {
+        casadi_assert_message(!*flag, "Cancelled.");
+      } else {
+        casadi_assert_message(!checkInterrupted(), "Interrupted by user.");
+      }
     }
   };
 
@@ -0,0 +1,193 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "casadi_trace.hpp"
+#include "exception.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace casadi {
+
+  atomic<bool> Trace::active_(false);
+
+  namespace {
+    typedef chrono::steady_clock trace_clock;
+
+    /// A recorded event
+    struct TraceEvent {
+      /// Time since start [us]
+      double ts;
+      /// Phase: 'B' (begin), 'E' (end) or 'i' (instant)
+      char ph;
+      /// Category
+      const char* cat;
+      /// Name, null-terminated
+      char name[64];
+    };
+
+    /// Ring buffer of the events of a thread
+    struct TraceBuffer {
+      /// Thread identifier in the trace
+      int tid;
+      /// Events, position n % size() holds the next event
+      vector<TraceEvent> ev;
+      /// Number of events recorded
+      atomic<size_t> n;
+    };
+
+    /// Buffers of all threads since the last start
+    struct TraceRecorder {
+      mutex mtx;
+      vector<shared_ptr<TraceBuffer> > buffers;
+      int capacity = 65536;
+      atomic<int> generation{0};
+      /// Start time, as a tick count of trace_clock
+      atomic<trace_clock::rep> t0{trace_clock::now().time_since_epoch().count()};
+    };
+
+    TraceRecorder& recorder() {
+      static TraceRecorder r;
+      return r;
+    }
+
+    /// Buffer of the current thread and the start it belongs to
+    thread_local shared_ptr<TraceBuffer> thread_buffer;
+    thread_local int thread_generation = -1;
+
+    TraceBuffer& get_buffer() {
+      TraceRecorder& r = recorder();
+      lock_guard<mutex> lock(r.mtx);
+      if (thread_generation!=r.generation || !thread_buffer) {
+        thread_buffer = make_shared<TraceBuffer>();
+        thread_buffer->tid = r.buffers.size();
+        thread_buffer->ev.resize(r.capacity);
+        thread_buffer->n = 0;
+        thread_generation = r.generation;
+        r.buffers.push_back(thread_buffer);
+      }
+      return *thread_buffer;
+    }
+
+    void record(char ph, const char* name, const char* cat) {
+      // Registration needs a lock, but only once per thread and start
+      TraceBuffer& b = thread_generation==recorder().generation && thread_buffer ?
+        *thread_buffer : get_buffer();
+      size_t k = b.n.load(memory_order_relaxed);
+      TraceEvent& e = b.ev[k % b.ev.size()];
+      trace_clock::duration t(trace_clock::now().time_since_epoch().count() - recorder().t0);
+      e.ts = chrono::duration<double, micro>(t).count();
+      e.ph = ph;
+      e.cat = cat;
+      strncpy(e.name, name, sizeof(e.name)-1);
+      e.name[sizeof(e.name)-1] = '\0';
+      b.n.store(k+1, memory_order_release);
+    }
+  } // namespace
+
+  void Trace::write_json_string(ostream& stream, const char* s) {
+    stream << '"';
+    for (; *s; ++s) {
+      if (*s=='"' || *s=='\\') {
+        stream << '\\' << *s;
+      } else if (static_cast<unsigned char>(*s)>=0x20) {
+        stream << *s;
+      }
+    }
+    stream << '"';
+  }
+
+  void Trace::start(int capacity) {
+    casadi_assert_message(capacity>0, "Trace: Capacity must be positive");
+    TraceRecorder& r = recorder();
+    {
+      lock_guard<mutex> lock(r.mtx);
+      r.buffers.clear();
+      r.capacity = capacity;
+      r.generation++;
+      r.t0 = trace_clock::now().time_since_epoch().count();
+    }
+    active_ = true;
+  }
+
+  void Trace::stop() {
+    active_ = false;
+  }
+
+  void Trace::begin(const char* name, const char* cat) {
+    record('B', name, cat);
+  }
+
+  void Trace::end() {
+    record('E', "", "");
+  }
+
+  void Trace::instant(const char* name, const char* cat) {
+    if (is_active()) record('i', name, cat);
+  }
+
+  void Trace::write(ostream& stream) {
+    TraceRecorder& r = recorder();
+    lock_guard<mutex> lock(r.mtx);
+    stream << "{\"traceEvents\": [";
+    bool first = true;
+    for (auto&& b : r.buffers) {
+      // Oldest events are overwritten when the buffer is full
+      size_t n = b->n.load(memory_order_acquire);
+      size_t cap = b->ev.size();
+      for (size_t k = n>cap ? n-cap : 0; k<n; ++k) {
+        const TraceEvent& e = b->ev[k % cap];
+        char ts[32];
+        snprintf(ts, sizeof(ts), "%.3f", e.ts);
+        stream << (first ? "\n" : ",\n") << "{\"ph\": \"" << e.ph << "\", \"ts\": " << ts
+               << ", \"pid\": 1, \"tid\": " << b->tid;
+        first = false;
+        if (e.ph!='E') {
+          stream << ", \"name\": ";
+          write_json_string(stream, e.name);
+          stream << ", \"cat\": ";
+          write_json_string(stream, e.cat);
+        }
+        if (e.ph=='i') stream << ", \"s\": \"t\"";
+        stream << "}";
+      }
+    }
+    stream << "\n]}\n";
+  }
+
+  void Trace::write(const string& filename) {
+    ofstream f(filename);
+    casadi_assert_message(f.good(), "Trace: Cannot open \"" << filename << "\" for writing");
+    write(f);
+  }
+
+} // namespace casadi
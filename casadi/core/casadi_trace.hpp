@@ -0,0 +1,120 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifndef CASADI_TRACE_HPP
+#define CASADI_TRACE_HPP
+
+#include "casadi_common.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <string>
+
+namespace casadi {
+
+  /**
+   * \brief Timeline of events in Chrome Trace Event Format
+   *
+   * Records begin/end events of function evaluations, derivative construction,
+   * code generation and compilation, solver iterations and linear solves. The
+   * result can be inspected in chrome://tracing or other trace viewers.
+   *
+   * Each thread records into a ring buffer of its own, so that recording takes
+   * no locks and, when the buffer is full, the oldest events are overwritten.
+   * When tracing is not active, recording costs a single atomic load.
+   *
+   * Usage: Trace::start(), run the code of interest, Trace::stop(),
+   * Trace::write("trace.json").
+   */
+  class CASADI_EXPORT Trace {
+  private:
+    /// No implementation - no instances are allowed of this class
+    Trace();
+
+  public:
+    /// Start recording, discarding earlier events, with a buffer of \a capacity events per thread
+    static void start(int capacity=65536);
+
+    /// Stop recording
+    static void stop();
+
+    /// Is recording active
+    static bool is_active() { return active_.load(std::memory_order_relaxed);}
+
+    /// Write the events recorded since the last start in JSON format, after stop
+    static void write(const std::string& filename);
+
+#ifndef SWIG
+    /// Write the events recorded since the last start in JSON format, after stop
+    static void write(std::ostream& stream);
+
+    ///@{
+    /** \brief Record an event on the current thread
+     *
+     * \a cat must have static storage duration, e.g. a string literal. Names are
+     * truncated to 63 characters.
+     */
+    static void begin(const char* name, const char* cat);
+    static void begin(const std::string& name, const char* cat) { begin(name.c_str(), cat);}
+    static void end();
+    static void instant(const char* name, const char* cat);
+    ///@}
+
+    /// Write a JSON string literal, escaping quotes and backslashes
+    static void write_json_string(std::ostream& stream, const char* s);
+
+  private:
+    /// Recording active
+    static std::atomic<bool> active_;
+#endif // SWIG
+  };
+
+#ifndef SWIG
+  /// \cond INTERNAL
+  /** \brief Records a begin event on construction and the matching end event on destruction
+   *
+   * Nothing is recorded unless tracing is active.
+   */
+  class CASADI_EXPORT TraceScope {
+  public:
+    TraceScope(const char* name, const char* cat) : active_(Trace::is_active()) {
+      if (active_) Trace::begin(name, cat);
+    }
+    TraceScope(const std::string& name, const char* cat) : active_(Trace::is_active()) {
+      if (active_) Trace::begin(name, cat);
+    }
+    ~TraceScope() {
+      if (active_) Trace::end();
+    }
+  private:
+    /// Tracing was active when the begin event was due
+    bool active_;
+  };
+  /// \endcond
+#endif // SWIG
+
+} // namespace casadi
+
+#endif // CASADI_TRACE_HPP
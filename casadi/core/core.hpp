@@ -33,6 +33,7 @@
 #include "polynomial.hpp"
 #include "std_vector_tools.hpp"
 #include "global_options.hpp"
+#include "casadi_trace.hpp"
 #include "casadi_meta.hpp"
 
 // Matrices
@@ -46,6 +47,7 @@
 #include "function/code_generator.hpp"
 #include "function/compiler.hpp"
 #include "function/callback.hpp"
+#include "function/jacobian_product.hpp"
 #include "function/integrator.hpp"
 #include "function/qpsol.hpp"
 #include "function/nlpsol.hpp"
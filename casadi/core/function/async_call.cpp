@@ -0,0 +1,313 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "async_call.hpp"
+#include "function_internal.hpp"
+#include "../casadi_interrupt.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+namespace casadi {
+
+  struct AsyncCall::State {
+    /// Function being evaluated
+    FunctionInternal* f;
+
+    /// Nonzeros of the inputs and outputs
+    vector<vector<double> > arg, res;
+
+    /// Error message, if any
+    string err;
+
+    /// Cancellation requested, evaluation finished
+    atomic<bool> cancelled, done;
+
+    /// Notifies threads waiting for the result
+    mutex mtx;
+    condition_variable cv;
+
+    State() : f(0), cancelled(false), done(false) {}
+
+    /// Evaluate, called by the executor
+    void run();
+
+    /// Wait for the evaluation to finish
+    void wait();
+  };
+
+  namespace {
+    /// Is the current thread a worker of the executor
+    thread_local bool is_worker_thread = false;
+
+    /// Queued task with the cancellation token of the evaluation it belongs to
+    struct Task {
+      function<void()> f;
+      const atomic<bool>* cancel;
+
+      /// Execute with the token installed
+      void operator()() const {
+        const atomic<bool>*& flag = InterruptHandler::cancel_flag();
+        const atomic<bool>* flag0 = flag;
+        flag = cancel;
+        f();
+        flag = flag0;
+      }
+    };
+
+    /// Worker threads and task queue
+    class Executor {
+    public:
+      Executor() : stop_(false) {
+        unsigned int n = max(1u, thread::hardware_concurrency());
+        for (unsigned int i=0; i<n; ++i) threads_.emplace_back(&Executor::work, this);
+      }
+
+      ~Executor() {
+        {
+          lock_guard<mutex> lock(mtx_);
+          stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto&& t : threads_) t.join();
+      }
+
+      int n_threads() const { return threads_.size();}
+
+      void submit(const function<void()>& task, const atomic<bool>* cancel) {
+        {
+          lock_guard<mutex> lock(mtx_);
+          queue_.push_back(Task{task, cancel});
+        }
+        cv_.notify_one();
+      }
+
+      bool run_one() {
+        Task task;
+        {
+          lock_guard<mutex> lock(mtx_);
+          if (queue_.empty()) return false;
+          task = move(queue_.front());
+          queue_.pop_front();
+        }
+        task();
+        return true;
+      }
+
+    private:
+      void work() {
+        is_worker_thread = true;
+        while (true) {
+          Task task;
+          {
+            unique_lock<mutex> lock(mtx_);
+            cv_.wait(lock, [this] { return stop_ || !queue_.empty();});
+            if (stop_) return;
+            task = move(queue_.front());
+            queue_.pop_front();
+          }
+          task();
+        }
+      }
+
+      vector<thread> threads_;
+      deque<Task> queue_;
+      mutex mtx_;
+      condition_variable cv_;
+      bool stop_;
+    };
+
+    Executor& executor() {
+      static Executor e;
+      return e;
+    }
+  } // namespace
+
+  void AsyncExecutor::submit(const function<void()>& task, const atomic<bool>* cancel) {
+    executor().submit(task, cancel);
+  }
+
+  bool AsyncExecutor::run_one() {
+    return executor().run_one();
+  }
+
+  bool AsyncExecutor::is_worker() {
+    return is_worker_thread;
+  }
+
+  void AsyncExecutor::parallel_for(int n, const function<void(int)>& task) {
+    // Progress, shared with the helping workers which may outlive the call
+    struct Batch {
+      atomic<int> next, finished;
+      mutex mtx;
+      string err;
+    };
+    auto b = make_shared<Batch>();
+    b->next = 0;
+    b->finished = 0;
+
+    // Claim and execute tasks until none are left
+    const function<void(int)>* t = &task;
+    auto body = [b, n, t]() {
+      for (int k=b->next++; k<n; k=b->next++) {
+        try {
+          InterruptHandler::check_cancelled();
+          (*t)(k);
+        } catch (exception& e) {
+          lock_guard<mutex> lock(b->mtx);
+          if (b->err.empty()) b->err = e.what();
+        }
+        b->finished++;
+      }
+    };
+
+    // Let workers help, with the cancellation token of the caller, take part in the work
+    int n_help = min(n-1, executor().n_threads());
+    for (int i=0; i<n_help; ++i) submit(body, InterruptHandler::cancel_flag());
+    body();
+
+    // Wait for the tasks claimed by the workers
+    while (b->finished<n) {
+      if (!run_one()) this_thread::yield();
+    }
+    casadi_assert_message(b->err.empty(), b->err);
+  }
+
+  void AsyncCall::State::run() {
+    try {
+      InterruptHandler::check();
+      vector<const double*> argp(arg.size());
+      for (int i=0; i<arg.size(); ++i) argp[i] = get_ptr(arg[i]);
+      vector<double*> resp(res.size());
+      for (int i=0; i<res.size(); ++i) resp[i] = get_ptr(res[i]);
+      f->call_threadsafe(get_ptr(argp), get_ptr(resp));
+    } catch (exception& e) {
+      err = e.what();
+    }
+    {
+      lock_guard<mutex> lock(mtx);
+      done = true;
+    }
+    cv.notify_all();
+  }
+
+  void AsyncCall::State::wait() {
+    bool worker = AsyncExecutor::is_worker();
+    while (!done) {
+      // Execute pending evaluations rather than blocking a worker
+      if (worker && AsyncExecutor::run_one()) continue;
+      {
+        unique_lock<mutex> lock(mtx);
+        cv.wait_for(lock, chrono::milliseconds(worker ? 1 : 10), [this] { return done.load();});
+      }
+
+      // Forward interrupts, or the cancellation of an enclosing evaluation
+      if (!done) {
+        try {
+          InterruptHandler::check();
+        } catch (...) {
+          cancelled = true;
+          throw;
+        }
+      }
+    }
+  }
+
+  AsyncCall::AsyncCall() {
+  }
+
+  AsyncCall AsyncCall::launch(const Function& f, const vector<DM>& arg) {
+    // Inputs with the correct dimensions
+    FunctionInternal* fi = f.operator->();
+    vector<DM> arg2 = fi->matchingArg(arg) ? arg : fi->replaceArg(arg);
+
+    // Copy nonzeros, the executor must not touch reference counted objects
+    AsyncCall ret;
+    shared_ptr<State> s = make_shared<State>();
+    s->f = fi;
+    s->arg.resize(f.n_in());
+    for (int i=0; i<f.n_in(); ++i) {
+      if (arg2[i].sparsity()==f.sparsity_in(i)) {
+        s->arg[i] = arg2[i].nonzeros();
+      } else {
+        s->arg[i] = project(arg2[i], f.sparsity_in(i)).nonzeros();
+      }
+    }
+    s->res.resize(f.n_out());
+    for (int i=0; i<f.n_out(); ++i) s->res[i].resize(f.nnz_out(i));
+    ret.state_ = s;
+
+    // Cancel and wait for the evaluation when the last handle is gone
+    ret.f_ = shared_ptr<Function>(new Function(f), [s](Function* f) {
+        s->cancelled = true;
+        while (!s->done) {
+          try {
+            s->wait();
+          } catch (...) {
+          }
+        }
+        delete f;
+      });
+
+    // Queue evaluation
+    AsyncExecutor::submit([s]() { s->run();}, &s->cancelled);
+    return ret;
+  }
+
+  bool AsyncCall::valid() const {
+    return state_!=0;
+  }
+
+  bool AsyncCall::ready() const {
+    return valid() && state_->done;
+  }
+
+  void AsyncCall::wait() const {
+    casadi_assert_message(valid(), "AsyncCall: No evaluation attached");
+    state_->wait();
+  }
+
+  vector<DM> AsyncCall::get() const {
+    wait();
+    casadi_assert_message(state_->err.empty(), state_->err);
+    vector<DM> ret(state_->res.size());
+    for (int i=0; i<ret.size(); ++i) {
+      ret[i] = DM(f_->sparsity_out(i), state_->res[i], false);
+    }
+    return ret;
+  }
+
+  void AsyncCall::cancel() {
+    casadi_assert_message(valid(), "AsyncCall: No evaluation attached");
+    state_->cancelled = true;
+  }
+
+} // namespace casadi
@@ -0,0 +1,126 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifndef CASADI_ASYNC_CALL_HPP
+#define CASADI_ASYNC_CALL_HPP
+
+#include "../matrix.hpp"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace casadi {
+
+  // Forward declaration
+  class Function;
+
+  /** \brief Handle to an asynchronous evaluation, cf. Function::call_async
+
+      Copies of the handle refer to the same evaluation. When the last copy is
+      destroyed before the evaluation has finished, the evaluation is cancelled.
+  */
+  class CASADI_EXPORT AsyncCall {
+  public:
+    /// Default constructor, no evaluation attached
+    AsyncCall();
+
+    /// Is an evaluation attached
+    bool valid() const;
+
+    /// Has the evaluation finished, successfully or not
+    bool ready() const;
+
+    /** \brief Wait for the evaluation to finish
+     *
+     * A worker thread of the executor waiting for the result executes pending
+     * evaluations in the meantime, so nested asynchronous calls overlap rather than
+     * deadlock. The evaluation is cancelled if an interrupt is captured while waiting.
+     */
+    void wait() const;
+
+    /// Wait for the evaluation to finish and get the result, rethrowing any error
+    std::vector<DM> get() const;
+
+    /** \brief Request cancellation
+     *
+     * Takes effect the next time the evaluation checks the InterruptHandler, at the
+     * latest before the evaluation starts.
+     */
+    void cancel();
+
+#ifndef SWIG
+    /// \cond INTERNAL
+    /// Start an evaluation on the executor
+    static AsyncCall launch(const Function& f, const std::vector<DM>& arg);
+
+    /// State shared with the executor
+    struct State;
+    /// \endcond
+
+  private:
+    /// State shared with the executor, contains no reference counted objects
+    std::shared_ptr<State> state_;
+
+    /// Function, kept alive until the evaluation has finished
+    std::shared_ptr<Function> f_;
+#endif // SWIG
+  };
+
+#ifndef SWIG
+  /// \cond INTERNAL
+  /** \brief Pool of worker threads for asynchronous evaluation
+
+      Started on first use, with one worker per hardware thread.
+  */
+  class CASADI_EXPORT AsyncExecutor {
+  public:
+    /** \brief Queue a task
+     *
+     * \a cancel is the cancellation token of the evaluation the task belongs to,
+     * installed as InterruptHandler::cancel_flag() on the thread executing it.
+     */
+    static void submit(const std::function<void()>& task, const std::atomic<bool>* cancel);
+
+    /// Execute a queued task on the calling thread, if any
+    static bool run_one();
+
+    /// Is the calling thread a worker of the pool
+    static bool is_worker();
+
+    /** \brief Execute task(0), ..., task(n-1) concurrently
+     *
+     * The calling thread takes part in the work and returns when all tasks have
+     * finished, rethrowing the first error. The workers helping out check the
+     * cancellation token of the calling thread.
+     */
+    static void parallel_for(int n, const std::function<void(int)>& task);
+  };
+  /// \endcond
+#endif // SWIG
+
+} // namespace casadi
+
+#endif // CASADI_ASYNC_CALL_HPP
@@ -81,6 +81,10 @@ namespace casadi {
     self_->init();
   }
 
+  bool CallbackInternal::is_a(const std::string& type, bool recursive) const {
+    return type=="callback" || (recursive && FunctionInternal::is_a(type, recursive));
+  }
+
   void CallbackInternal::finalize() {
     // Finalize this
     casadi_assert_message(self_!=0, "Callback object has been deleted");
@@ -61,6 +61,9 @@ namespace casadi {
     /** \brief  Initialize */
     virtual void init(const Dict& opts);
 
+    /** \brief Check if the function is of a particular type */
+    virtual bool is_a(const std::string& type, bool recursive) const;
+
     /** \brief Finalize the object creation */
     virtual void finalize();
 
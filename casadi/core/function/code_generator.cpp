@@ -26,7 +26,11 @@
 
 #include "code_generator.hpp"
 #include "function_internal.hpp"
+#include "../casadi_trace.hpp"
+#include "async_call.hpp"
 #include <iomanip>
+#include <cctype>
+#include <algorithm>
 #include "casadi/core/runtime/runtime_embedded.hpp"
 
 using namespace std;
@@ -39,8 +43,18 @@ namespace casadi {
     this->cpp = false;
     this->main = false;
     this->real_t = "double";
+    this->real_acc_t = "real_t";
+    this->local_real_t_default = "real_t";
     this->codegen_scalars = false;
     this->with_header = false;
+    this->split = false;
+    this->split_size = 10000;
+    this->single_assignment = false;
+    this->batch = false;
+    this->with_restrict = false;
+    this->embedded = false;
+    this->pointer_size = sizeof(void*);
+    this->real_t_size = 0;
 
     // Read options
     for (auto&& e : opts) {
@@ -54,14 +68,55 @@ namespace casadi {
         this->main = e.second;
       } else if (e.first=="real_t") {
         this->real_t = e.second.to_string();
+      } else if (e.first=="real_acc_t") {
+        this->real_acc_t = e.second.to_string();
+      } else if (e.first=="local_real_t") {
+        if (e.second.is_dict()) {
+          for (auto&& f : e.second.to_dict()) {
+            this->local_real_t_fcn[f.first] = f.second.to_string();
+          }
+        } else {
+          this->local_real_t_default = e.second.to_string();
+        }
       } else if (e.first=="codegen_scalars") {
         this->codegen_scalars = e.second;
       } else if (e.first=="with_header") {
         this->with_header = e.second;
+      } else if (e.first=="split") {
+        this->split = e.second;
+      } else if (e.first=="split_size") {
+        this->split_size = e.second;
+      } else if (e.first=="single_assignment") {
+        this->single_assignment = e.second;
+      } else if (e.first=="with_restrict") {
+        this->with_restrict = e.second;
+      } else if (e.first=="batch") {
+        this->batch = e.second;
+      } else if (e.first=="embedded") {
+        this->embedded = e.second;
+      } else if (e.first=="pointer_size") {
+        this->pointer_size = e.second;
+      } else if (e.first=="real_t_size") {
+        this->real_t_size = e.second;
       } else {
         casadi_error("Unrecongnized option: " << e.first);
       }
     }
+    casadi_assert_message(this->split_size>0, "Option 'split_size' must be positive");
+    casadi_assert_message(this->pointer_size>0, "Option 'pointer_size' must be positive");
+    if (this->real_t_size<=0) {
+      if (this->real_t=="float") {
+        this->real_t_size = 4;
+      } else if (this->real_t=="long double") {
+        this->real_t_size = sizeof(long double);
+      } else {
+        this->real_t_size = 8;
+      }
+    }
+    if (this->embedded) {
+      casadi_assert_message(!this->main && !this->mex,
+                            "Options 'main' and 'mex' cannot be combined with 'embedded'");
+    }
 
     // Includes needed
     if (this->main) addInclude("stdio.h");
@@ -71,19 +126,27 @@ namespace casadi {
       addInclude("string.h");
     }
 
+    // Type-generic math functions for single precision arithmetic
+    if (this->real_t!="double" || this->local_real_t_default!="real_t"
+        || !this->local_real_t_fcn.empty()) {
+      addAuxiliary(AUX_TGMATH);
+    }
+
     // Mex file?
     if (this->mex) {
       addInclude("mex.h", false, "MATLAB_MEX_FILE");
       // Define printf (note file should be compilable both with and without mex)
-      this->auxiliaries
-        << "#ifdef MATLAB_MEX_FILE" << endl
-        << "#define PRINTF mexPrintf" << endl
-        << "#else" << endl
-        << "#define PRINTF printf" << endl
-        << "#endif" << endl;
-    } else {
+      string def = "#ifdef MATLAB_MEX_FILE\n"
+        "#define PRINTF mexPrintf\n"
+        "#else\n"
+        "#define PRINTF printf\n"
+        "#endif\n";
+      this->auxiliaries << def;
+      this->auxiliary_declarations << def;
+    } else if (!this->embedded) {
       // Define printf as standard printf from stdio.h
       this->auxiliaries << "#define PRINTF printf" << endl;
+      this->auxiliary_declarations << "#define PRINTF printf" << endl;
     }
   }
 
@@ -93,6 +156,12 @@ namespace casadi {
       if (this->cpp) this->header << "extern \"C\" " ; // C linkage
       this->header << f->signature(f.name()) << ";" << endl;
     }
+    if (this->batch && !f->simplifiedCall()) {
+      f->generateBatch(*this, f.name());
+    }
+    if (this->embedded && !f->simplifiedCall()) {
+      generate_arena(f);
+    }
     f->generateMeta(*this, f.name());
     this->exposed_fname.push_back(f.name());
   }
@@ -103,12 +172,9 @@ namespace casadi {
     return s.str();
   }
 
-  void CodeGenerator::generate(const std::string& name) const {
-    // File(s) being generated, header is optional
-    vector<ofstream> s(this->with_header ? 2 : 1);
-
+  void CodeGenerator::split_name(const std::string& name,
+                                 std::string& basename, std::string& suffix) const {
     // Divide name into base and suffix (.c by default)
-    string basename, suffix;
     string::size_type dotpos = name.rfind('.');
     if (dotpos==string::npos) {
       basename = name;
@@ -117,6 +183,62 @@ namespace casadi {
       basename = name.substr(0, dotpos);
       suffix = name.substr(dotpos);
     }
+  }
+
+  std::vector<std::string> CodeGenerator::split_sources(const std::string& name) const {
+    string basename, suffix;
+    split_name(name, basename, suffix);
+    vector<string> ret;
+    if (this->split) {
+      for (int k=0; k<units.size(); ++k) ret.push_back(basename + "_" + to_string(k) + suffix);
+    }
+    return ret;
+  }
+
+  void CodeGenerator::print_prefix(std::ostream& s, const std::string& basename) {
+    // Prefix internal symbols to avoid symbol collisions
+    s << "#ifdef CODEGEN_PREFIX" << endl
+      << "  #define NAMESPACE_CONCAT(NS, ID) _NAMESPACE_CONCAT(NS, ID)" << endl
+      << "  #define _NAMESPACE_CONCAT(NS, ID) NS ## ID" << endl
+      << "  #define CASADI_PREFIX(ID) NAMESPACE_CONCAT(CODEGEN_PREFIX, ID)" << endl
+      << "#else /* CODEGEN_PREFIX */" << endl
+      << "  #define CASADI_PREFIX(ID) " << basename << "_ ## ID" << endl
+      << "#endif /* CODEGEN_PREFIX */" << endl << endl;
+  }
+
+  void CodeGenerator::print_real_t(std::ostream& s) const {
+    s << "#ifndef real_t" << endl
+      << "#define real_t " << this->real_t << endl
+      << "#define to_double(x) "
+      << (this->cpp ? "static_cast<double>(x)" : "(double) x") << endl
+      << "#define to_int(x) "
+      << (this->cpp ? "static_cast<int>(x)" : "(int) x") << endl
+      << "#endif /* real_t */" << endl
+      << "#ifndef real_acc_t" << endl
+      << "#define real_acc_t " << this->real_acc_t << endl
+      << "#endif /* real_acc_t */" << endl << endl;
+  }
+
+  void CodeGenerator::print_prec99(std::ostream& s, bool decl_only) {
+    string fmin_body = decl_only ? ";" : " { return x<y ? x : y;}";
+    string fmax_body = decl_only ? ";" : " { return x>y ? x : y;}";
+    s << "/* Pre-c99 compatibility */" << endl
+      << "#if __STDC_VERSION__ < 199901L" << endl
+      << "real_t CASADI_PREFIX(fmin)(real_t x, real_t y)" << fmin_body << endl
+      << "#define fmin(x,y) CASADI_PREFIX(fmin)(x,y)" << endl
+      << "real_t CASADI_PREFIX(fmax)(real_t x, real_t y)" << fmax_body << endl
+      << "#define fmax(x,y) CASADI_PREFIX(fmax)(x,y)" << endl
+      << "#endif" << endl << endl;
+  }
+
+  void CodeGenerator::generate(const std::string& name) const {
+    TraceScope trace(name, "codegen");
+    // File(s) being generated, header is optional
+    vector<ofstream> s(this->with_header ? 2 : 1);
+
+    // Divide name into base and suffix (.c by default)
+    string basename, suffix;
+    split_name(name, basename, suffix);
 
     // Make sure that the base name is sane
     casadi_assert(Function::check_name(basename));
@@ -129,6 +251,7 @@ namespace casadi {
 
       // Print header
       s[i] << "/* This function was automatically generated by CasADi */" << endl;
+      if (i==0 && this->embedded) print_footprint(s[i]);
 
       // C linkage
       if (!this->cpp) {
@@ -138,50 +261,63 @@ namespace casadi {
       }
     }
 
-    // Prefix internal symbols to avoid symbol collisions
-    s[0] << "#ifdef CODEGEN_PREFIX" << endl
-         << "  #define NAMESPACE_CONCAT(NS, ID) _NAMESPACE_CONCAT(NS, ID)" << endl
-         << "  #define _NAMESPACE_CONCAT(NS, ID) NS ## ID" << endl
-         << "  #define CASADI_PREFIX(ID) NAMESPACE_CONCAT(CODEGEN_PREFIX, ID)" << endl
-         << "#else /* CODEGEN_PREFIX */" << endl
-         << "  #define CASADI_PREFIX(ID) " << basename << "_ ## ID" << endl
-         << "#endif /* CODEGEN_PREFIX */" << endl << endl;
-
-    s[0] << this->includes.str();
-    s[0] << endl;
-
     // Real type (usually double)
-    for (int i=0; i<s.size(); ++i) {
-      s[i]
-        << "#ifndef real_t" << endl
-        << "#define real_t " << this->real_t << endl
-        << "#define to_double(x) "
-        << (this->cpp ? "static_cast<double>(x)" : "(double) x") << endl
-        << "#define to_int(x) "
-        << (this->cpp ? "static_cast<int>(x)" : "(int) x") << endl
-        << "#endif /* real_t */" << endl << endl;
-    }
-
-    // External function declarations
-    if (!added_externals_.empty()) {
-      s[0] << "/* External functions */" << endl;
-      for (auto&& i : added_externals_) {
-        s[0] << i << endl;
+    if (this->with_header) print_real_t(s[1]);
+
+    if (this->split) {
+      // Everything shared between the translation units goes in a common header
+      generate_common(basename);
+      s[0] << "#include \"" << basename << "_common.h\"" << endl << endl;
+
+      // Auxiliary functions and constants are defined once, in the main file
+      print_prec99(s[0], false);
+      s[0] << this->auxiliaries.str();
+      print_constants(s[0], false, false);
+      s[0] << this->body.str() << endl;
+
+      // One file for each function or chunk of a function
+      vector<string> unit_names = split_sources(name);
+      for (int k=0; k<units.size(); ++k) {
+        ofstream u(unit_names[k].c_str());
+        u << "/* This function was automatically generated by CasADi */" << endl
+          << "#include \"" << basename << "_common.h\"" << endl << endl;
+        if (!this->cpp) {
+          u << "#ifdef __cplusplus" << endl
+            << "extern \"C\" {" << endl
+            << "#endif" << endl << endl;
+        }
+        u << units[k] << endl;
+        if (!this->cpp) {
+          u << "#ifdef __cplusplus" << endl
+            << "} /* extern \"C\" */" << endl
+            << "#endif" << endl;
+        }
+      }
+    } else {
+      // Prefix internal symbols to avoid symbol collisions
+      print_prefix(s[0], basename);
+
+      s[0] << this->includes.str();
+      s[0] << endl;
+
+      // Real type (usually double)
+      print_real_t(s[0]);
+
+      // External function declarations
+      if (!added_externals_.empty()) {
+        s[0] << "/* External functions */" << endl;
+        for (auto&& i : added_externals_) {
+          s[0] << i << endl;
+        }
+        s[0] << endl << endl;
       }
-      s[0] << endl << endl;
-    }
 
-    // Pre-C99
-    s[0] << "/* Pre-c99 compatibility */" << endl
-         << "#if __STDC_VERSION__ < 199901L" << endl
-         << "real_t CASADI_PREFIX(fmin)(real_t x, real_t y) { return x<y ? x : y;}" << endl
-         << "#define fmin(x,y) CASADI_PREFIX(fmin)(x,y)" << endl
-         << "real_t CASADI_PREFIX(fmax)(real_t x, real_t y) { return x>y ? x : y;}" << endl
-         << "#define fmax(x,y) CASADI_PREFIX(fmax)(x,y)" << endl
-         << "#endif" << endl << endl;
+      // Pre-C99
+      print_prec99(s[0], false);
 
-    // Generate the actual function
-    generate(s[0]);
+      // Generate the actual function
+      generate(s[0]);
+    }
 
     // Generate header
     if (this->with_header) {
@@ -273,28 +409,184 @@ namespace casadi {
     // Codegen auxiliary functions
     s << this->auxiliaries.str();
 
+    // Print constants
+    print_constants(s, true, false);
+
+    // Declarations, needed if the functions have been split up
+    s << this->declarations.str();
+
+    // Codegen body
+    s << this->body.str();
+
+    // Functions that would go in translation units of their own
+    for (auto&& u : this->units) s << u;
+
+    // End with new line
+    s << endl;
+  }
+
+  void CodeGenerator::print_constants(std::ostream& s, bool decl_static, bool decl_only) const {
     // Print integer constants
-    stringstream name;
+    stringstream name, def;
     for (int i=0; i<integer_constants_.size(); ++i) {
       name.str(string());
       name << "CASADI_PREFIX(s" << i << ")";
-      print_vector(s, name.str(), integer_constants_[i]);
-      s << "#define s" << i << " CASADI_PREFIX(s" << i << ")" << endl;
+      if (decl_only) {
+        s << "extern const int " << name.str() << "[];" << endl;
+      } else {
+        def.str(string());
+        print_vector(def, name.str(), integer_constants_[i]);
+        // Drop the leading "static " for a definition with external linkage
+        s << (decl_static ? def.str() : def.str().substr(7));
+      }
+      if (decl_static || decl_only) {
+        s << "#define s" << i << " CASADI_PREFIX(s" << i << ")" << endl;
+      }
     }
 
     // Print double constants
     for (int i=0; i<double_constants_.size(); ++i) {
       name.str(string());
       name << "CASADI_PREFIX(c" << i << ")";
-      print_vector(s, name.str(), double_constants_[i]);
-      s << "#define c" << i << " CASADI_PREFIX(c" << i << ")" << endl;
+      if (decl_only) {
+        s << "extern const real_t " << name.str() << "[];" << endl;
+      } else {
+        def.str(string());
+        print_vector(def, name.str(), double_constants_[i]);
+        s << (decl_static ? def.str() : def.str().substr(7));
+      }
+      if (decl_static || decl_only) {
+        s << "#define c" << i << " CASADI_PREFIX(c" << i << ")" << endl;
+      }
+    }
+  }
+
+  void CodeGenerator::generate_common(const std::string& basename) const {
+    string fname = basename + "_common.h";
+    ofstream s(fname.c_str());
+    s << "/* This function was automatically generated by CasADi */" << endl
+      << "#ifndef " << basename << "_COMMON_H" << endl
+      << "#define " << basename << "_COMMON_H" << endl << endl;
+
+    // Prefix internal symbols to avoid symbol collisions
+    print_prefix(s, basename);
+
+    s << this->includes.str();
+    s << endl;
+
+    // C linkage
+    if (!this->cpp) {
+      s << "#ifdef __cplusplus" << endl
+        << "extern \"C\" {" << endl
+        << "#endif" << endl << endl;
     }
 
-    // Codegen body
-    s << this->body.str();
+    // Real type (usually double)
+    print_real_t(s);
 
-    // End with new line
+    // External function declarations
+    if (!added_externals_.empty()) {
+      s << "/* External functions */" << endl;
+      for (auto&& i : added_externals_) {
+        s << i << endl;
+      }
+      s << endl << endl;
+    }
+
+    // Pre-C99, defined in the main file
+    print_prec99(s, true);
+
+    // Auxiliary functions are defined in the main file, declared here
+    s << this->auxiliary_declarations.str() << endl;
+
+    // Constants are defined in the main file
+    print_constants(s, false, true);
     s << endl;
+
+    // Functions defined in the different translation units
+    s << this->declarations.str() << endl;
+
+    // C linkage
+    if (!this->cpp) {
+      s << "#ifdef __cplusplus" << endl
+        << "} /* extern \"C\" */" << endl
+        << "#endif" << endl << endl;
+    }
+
+    s << "#endif /* " << basename << "_COMMON_H */" << endl;
+  }
+
+  void CodeGenerator::generate_arena(const Function& f) {
+    string fname = f.name();
+    size_t sz_arg, sz_res, sz_iw, sz_w;
+    f.sz_work(sz_arg, sz_res, sz_iw, sz_w);
+
+    // Work vectors with their element sizes, largest elements first so that
+    // no padding is needed between them. C does not allow arrays of length zero
+    struct Buffer { string type, name; size_t n; int el_size; };
+    vector<Buffer> buf = {
+      {"real_t", "w", std::max(sz_w, size_t(1)), this->real_t_size},
+      {"const real_t*", "arg", std::max(sz_arg, size_t(1)), this->pointer_size},
+      {"real_t*", "res", std::max(sz_res, size_t(1)), this->pointer_size},
+      {"int", "iw", std::max(sz_iw, size_t(1)), static_cast<int>(sizeof(int))}};
+    std::stable_sort(buf.begin(), buf.end(), [](const Buffer& x, const Buffer& y) {
+        return x.el_size > y.el_size;});
+
+    // Total size, including padding at the end
+    size_t sz = 0;
+    for (auto&& b : buf) sz += b.n * b.el_size;
+    int align = buf.front().el_size;
+    sz = align * ((sz + align - 1) / align);
+    arena_size_.push_back(make_pair(fname, sz));
+
+    // Struct definition, needed by the caller to allocate it
+    stringstream def;
+    def << "/* Work buffers for " << fname << ", " << sz << " bytes */" << endl
+        << "struct " << fname << "_arena {" << endl;
+    for (auto&& b : buf) def << "  " << b.type << " " << b.name << "[" << b.n << "];" << endl;
+    def << "};" << endl << endl;
+    this->body << def.str();
+    if (this->with_header) this->header << def.str();
+
+    // Evaluate using the buffers, no other memory is needed
+    string decl = "int " + fname + "_arena_eval(const real_t** arg, real_t** res, struct "
+      + fname + "_arena* m)";
+    this->body << declare(decl) << " {" << endl
+               << "  int i;" << endl
+               << "  for (i=0; i<" << f.n_in() << "; ++i) m->arg[i] = arg[i];" << endl
+               << "  for (i=0; i<" << f.n_out() << "; ++i) m->res[i] = res[i];" << endl
+               << "  return " << fname << "(m->arg, m->res, m->iw, m->w, 0);" << endl
+               << "}" << endl << endl;
+  }
+
+  Dict CodeGenerator::footprint() const {
+    // Work buffers of the exposed functions
+    size_t ram = 0;
+    for (auto&& a : arena_size_) ram += a.second;
+
+    // Constant tables, excluding the code itself
+    size_t rom = 0;
+    for (auto&& v : integer_constants_) rom += v.size() * sizeof(int);
+    for (auto&& v : double_constants_) rom += v.size() * this->real_t_size;
+
+    Dict ret;
+    ret["ram"] = static_cast<int>(ram);
+    ret["rom"] = static_cast<int>(rom);
+    return ret;
+  }
+
+  void CodeGenerator::print_footprint(std::ostream& s) const {
+    Dict fp = footprint();
+    s << "/* Static memory: " << fp.at("rom").to_int() << " bytes of constant tables";
+    for (auto&& a : arena_size_) {
+      s << endl << "   " << a.first << "_arena: " << a.second << " bytes";
+    }
+    s << endl << "   No dynamic allocation, recursion or stdio */" << endl;
+  }
+
+  void CodeGenerator::add_unit(const std::string& decl, const std::string& def) {
+    this->declarations << decl << ";" << endl;
+    this->units.push_back(def);
   }
 
   std::string CodeGenerator::to_string(int n) {
@@ -495,69 +787,40 @@ namespace casadi {
     // Add the appropriate function
     switch (f) {
     case AUX_COPY:
-      this->auxiliaries
-        << codegen_str_copy
-        << codegen_str_copy_define << endl
-        << endl;
+      auxRuntime(codegen_str_copy, codegen_str_copy_decl, codegen_str_copy_define);
       break;
     case AUX_SWAP:
-      this->auxiliaries << codegen_str_swap
-        << codegen_str_swap_define
-        << endl;
+      auxRuntime(codegen_str_swap, codegen_str_swap_decl, codegen_str_swap_define);
       break;
     case AUX_SCAL:
-      this->auxiliaries << codegen_str_scal
-        << codegen_str_scal_define
-        << endl;
+      auxRuntime(codegen_str_scal, codegen_str_scal_decl, codegen_str_scal_define);
       break;
     case AUX_AXPY:
-      this->auxiliaries << codegen_str_axpy
-        << codegen_str_axpy_define
-        << endl;
+      auxRuntime(codegen_str_axpy, codegen_str_axpy_decl, codegen_str_axpy_define);
       break;
     case AUX_DOT:
-      this->auxiliaries
-        << codegen_str_dot
-        << codegen_str_dot_define << endl
-        << endl;
+      auxRuntime(codegen_str_dot, codegen_str_dot_decl, codegen_str_dot_define);
       break;
     case AUX_BILIN:
-      this->auxiliaries
-        << codegen_str_bilin
-        << codegen_str_bilin_define << endl
-        << endl;
+      auxRuntime(codegen_str_bilin, codegen_str_bilin_decl, codegen_str_bilin_define);
       break;
     case AUX_RANK1:
-      this->auxiliaries
-        << codegen_str_rank1
-        << codegen_str_rank1_define << endl
-        << endl;
+      auxRuntime(codegen_str_rank1, codegen_str_rank1_decl, codegen_str_rank1_define);
       break;
     case AUX_ASUM:
-      this->auxiliaries << codegen_str_asum
-        << codegen_str_asum_define
-        << endl;
+      auxRuntime(codegen_str_asum, codegen_str_asum_decl, codegen_str_asum_define);
       break;
     case AUX_IAMAX:
-      this->auxiliaries << codegen_str_iamax
-        << codegen_str_iamax_define
-        << endl;
+      auxRuntime(codegen_str_iamax, codegen_str_iamax_decl, codegen_str_iamax_define);
       break;
     case AUX_NRM2:
-      this->auxiliaries << codegen_str_nrm2
-        << codegen_str_nrm2_define
-        << endl;
+      auxRuntime(codegen_str_nrm2, codegen_str_nrm2_decl, codegen_str_nrm2_define);
       break;
     case AUX_FILL:
-      this->auxiliaries
-        << codegen_str_fill
-        << codegen_str_fill_define << endl
-        << endl;
+      auxRuntime(codegen_str_fill, codegen_str_fill_decl, codegen_str_fill_define);
       break;
     case AUX_MTIMES:
-      this->auxiliaries << codegen_str_mtimes
-        << codegen_str_mtimes_define
-        << endl;
+      auxRuntime(codegen_str_mtimes, codegen_str_mtimes_decl, codegen_str_mtimes_define);
       break;
     case AUX_SQ:
       auxSq();
@@ -566,15 +829,12 @@ namespace casadi {
       auxSign();
       break;
     case AUX_PROJECT:
-      this->auxiliaries
-        << codegen_str_project
-        << codegen_str_project_define
-        << endl << endl;
+      auxRuntime(codegen_str_project, codegen_str_project_decl, codegen_str_project_define);
       break;
     case AUX_TRANS:
-      this->auxiliaries << codegen_str_trans
-        << "#define trans(x, sp_x, y, sp_y, tmp) CASADI_PREFIX(trans)(x, sp_x, y, sp_y, tmp)"
-        << endl << endl;
+      auxRuntime(codegen_str_trans, codegen_str_trans_decl,
+                 "#define trans(x, sp_x, y, sp_y, tmp) "
+                 "CASADI_PREFIX(trans)(x, sp_x, y, sp_y, tmp)\n");
       break;
     case AUX_TO_MEX:
       this->auxiliaries
@@ -594,6 +854,11 @@ namespace casadi {
         << "}" << endl
         << "#define to_mex(sp, x) CASADI_PREFIX(to_mex)(sp, x)" << endl
         << "#endif" << endl << endl;
+      this->auxiliary_declarations
+        << "#ifdef MATLAB_MEX_FILE" << endl
+        << "mxArray* CASADI_PREFIX(to_mex)(const int* sp, const real_t* x);" << endl
+        << "#define to_mex(sp, x) CASADI_PREFIX(to_mex)(sp, x)" << endl
+        << "#endif" << endl;
       break;
     case AUX_FROM_MEX:
       addAuxiliary(AUX_FILL);
@@ -649,6 +914,49 @@ namespace casadi {
         << "}" << endl
         << "#define from_mex(p, y, sp, w) CASADI_PREFIX(from_mex)(p, y, sp, w)" << endl
         << "#endif" << endl << endl;
+      this->auxiliary_declarations
+        << "#ifdef MATLAB_MEX_FILE" << endl
+        << "real_t* CASADI_PREFIX(from_mex)(const mxArray *p, "
+        << "real_t* y, const int* sp, real_t* w);" << endl
+        << "#define from_mex(p, y, sp, w) CASADI_PREFIX(from_mex)(p, y, sp, w)" << endl
+        << "#endif" << endl;
+      break;
+    case AUX_TGMATH:
+      {
+        const char* def = "#if !defined(__cplusplus) && __STDC_VERSION__ >= 199901L\n"
+          "#include <tgmath.h>\n"
+          "#endif\n";
+        this->auxiliaries << def << endl;
+        this->auxiliary_declarations << def;
+      }
+      break;
+    case AUX_QR:
+      auxRuntime(codegen_str_house, codegen_str_house_decl, codegen_str_house_define);
+      auxRuntime(codegen_str_qr, codegen_str_qr_decl, codegen_str_qr_define);
+      auxRuntime(codegen_str_qr_solve, codegen_str_qr_solve_decl, codegen_str_qr_solve_define);
+      break;
+    case AUX_LU:
+      auxRuntime(codegen_str_lu, codegen_str_lu_decl, codegen_str_lu_define);
+      auxRuntime(codegen_str_lu_solve, codegen_str_lu_solve_decl, codegen_str_lu_solve_define);
+      break;
+    case AUX_LDL:
+      auxRuntime(codegen_str_ldl, codegen_str_ldl_decl, codegen_str_ldl_define);
+      auxRuntime(codegen_str_ldl_solve, codegen_str_ldl_solve_decl, codegen_str_ldl_solve_define);
+      break;
+    case AUX_RESTRICT:
+      {
+        const char* def = "#ifndef CASADI_RESTRICT\n"
+          "#if __STDC_VERSION__ >= 199901L\n"
+          "#define CASADI_RESTRICT restrict\n"
+          "#elif defined(__GNUC__) || defined(_MSC_VER)\n"
+          "#define CASADI_RESTRICT __restrict\n"
+          "#else\n"
+          "#define CASADI_RESTRICT\n"
+          "#endif\n"
+          "#endif\n";
+        this->auxiliaries << def << endl;
+        this->auxiliary_declarations << def;
+      }
       break;
     }
   }
@@ -674,17 +982,32 @@ namespace casadi {
   }
 
   void CodeGenerator::auxSq() {
-    this->auxiliaries
-      << "real_t CASADI_PREFIX(sq)(real_t x) "
-      << "{ return x*x;}" << endl
-      << "#define sq(x) CASADI_PREFIX(sq)(x)" << endl << endl;
+    auxRuntime("real_t CASADI_PREFIX(sq)(real_t x) { return x*x;}\n",
+               "real_t CASADI_PREFIX(sq)(real_t x);\n",
+               "#define sq(x) CASADI_PREFIX(sq)(x)\n");
   }
 
   void CodeGenerator::auxSign() {
-    this->auxiliaries
-      << "real_t CASADI_PREFIX(sign)(real_t x) "
-      << "{ return x<0 ? -1 : x>0 ? 1 : x;}" << endl
-      << "#define sign(x) CASADI_PREFIX(sign)(x)" << endl << endl;
+    auxRuntime("real_t CASADI_PREFIX(sign)(real_t x) { return x<0 ? -1 : x>0 ? 1 : x;}\n",
+               "real_t CASADI_PREFIX(sign)(real_t x);\n",
+               "#define sign(x) CASADI_PREFIX(sign)(x)\n");
+  }
+
+  void CodeGenerator::auxRuntime(const char* def, const char* decl, const char* define) {
+    this->auxiliaries << def << define << endl;
+    this->auxiliary_declarations << decl << define;
+  }
+
+  std::string CodeGenerator::local_real_t(const std::string& fname) const {
+    auto it = this->local_real_t_fcn.find(fname);
+    return it==this->local_real_t_fcn.end() ? this->local_real_t_default : it->second;
+  }
+
+  std::string CodeGenerator::constant(double v, const std::string& type) const {
+    // Avoid promoting single precision expressions to double
+    string t = type=="real_t" ? this->real_t : type;
+    if (t=="double" || t=="long double") return constant(v);
+    return "((" + type + ")" + constant(v) + ")";
   }
 
   std::string CodeGenerator::constant(double v) {
@@ -783,6 +1106,7 @@ namespace casadi {
   }
 
   std::string CodeGenerator::printf(const std::string& str, const std::vector<std::string>& arg) {
+    casadi_assert_message(!this->embedded, "Printing is not supported in embedded mode");
     addInclude("stdio.h");
     stringstream s;
     s << "PRINTF(\"" << str << "\"";
@@ -816,6 +1140,7 @@ namespace casadi {
 
   std::string CodeGenerator::compile(const std::string& name,
                                      const std::string& compiler) {
+    TraceScope trace(name, "compile");
     // Flag to get a DLL
 #ifdef __APPLE__
     string dlflag = " -dynamiclib";
@@ -834,10 +1159,33 @@ namespace casadi {
     // Codegen it
     generate(name);
 
-    // Compile it
-    string compile_command = compiler + " " + dlflag + " " + cname + " -o " + dlname;
-    flag = system(compile_command.c_str());
-    casadi_assert_message(flag==0, "Compilation failed");
+    if (this->split) {
+      // Compile the translation units to object files in parallel
+      vector<string> src = split_sources(name);
+      src.insert(src.begin(), cname);
+      vector<int> status(src.size(), 0);
+      AsyncExecutor::parallel_for(src.size(), [&](int i) {
+        string obj_command = compiler + " -c " + src[i] + " -o " + src[i] + ".o";
+        status[i] = system(obj_command.c_str());
+      });
+      string objs;
+      for (int i=0; i<src.size(); ++i) {
+        casadi_assert_message(status[i]==0, "Compilation of " + src[i] + " failed");
+        objs += " " + src[i] + ".o";
+      }
+
+      // Link
+      string link_command = compiler + " " + dlflag + objs + " -o " + dlname;
+      flag = system(link_command.c_str());
+      casadi_assert_message(flag==0, "Linking failed");
+      rm_command = "rm -f" + objs;
+      if (system(rm_command.c_str())) casadi_warning("Failed to remove object files");
+    } else {
+      // Compile it
+      string compile_command = compiler + " " + dlflag + " " + cname + " -o " + dlname;
+      flag = system(compile_command.c_str());
+      casadi_assert_message(flag==0, "Compilation failed");
+    }
 
     // Return name of compiled function
     return dlname;
@@ -55,6 +55,12 @@ namespace casadi {
     /// Compile and load function
     std::string compile(const std::string& name, const std::string& compiler="gcc -fPIC -O2");
 
+    /// Additional source files generated in split mode, besides the main file
+    std::vector<std::string> split_sources(const std::string& name) const;
+
+    /// Static memory needed by the generated code in bytes, "ram" and "rom", embedded mode
+    Dict footprint() const;
+
     /// Add an include file optionally using a relative path "..." instead of an absolute path <...>
     void addInclude(const std::string& new_include, bool relative_path=false,
                     const std::string& use_ifdef=std::string());
@@ -112,6 +118,9 @@ namespace casadi {
     /** \brief Declare a function */
     std::string declare(std::string s);
 
+    /** \brief Put a definition in a translation unit of its own (split mode) */
+    void add_unit(const std::string& decl, const std::string& def);
+
     /** \brief Auxiliary functions */
     enum Auxiliary {
       AUX_COPY,
@@ -131,12 +140,23 @@ namespace casadi {
       AUX_PROJECT,
       AUX_TRANS,
       AUX_TO_MEX,
-      AUX_FROM_MEX
+      AUX_FROM_MEX,
+      AUX_RESTRICT,
+      AUX_TGMATH,
+      AUX_QR,
+      AUX_LU,
+      AUX_LDL
     };
 
     /** \brief Add a built-in auxiliary function */
     void addAuxiliary(Auxiliary f);
 
+    /** \brief Real-type for the intermediates of an SX function */
+    std::string local_real_t(const std::string& fname) const;
+
+    /** \brief Print a constant for an expression of a given real-type */
+    std::string constant(double v, const std::string& type) const;
+
     /** Convert in integer to a string */
     static std::string to_string(int n);
 
@@ -191,6 +211,33 @@ namespace casadi {
     /// SIGN
     void auxSign();
 
+    /// Add a runtime function, recording its prototype and shorthand for split mode
+    void auxRuntime(const char* def, const char* decl, const char* define);
+
+    /// Divide a file name into base and suffix
+    void split_name(const std::string& name, std::string& basename, std::string& suffix) const;
+
+    /// Print the symbol prefix macros
+    static void print_prefix(std::ostream& s, const std::string& basename);
+
+    /// Print the real_t definition
+    void print_real_t(std::ostream& s) const;
+
+    /// Print the pre-c99 compatibility functions, optionally only the declarations
+    static void print_prec99(std::ostream& s, bool decl_only);
+
+    /// Print the constants, either static, as declarations or as definitions
+    void print_constants(std::ostream& s, bool decl_static, bool decl_only) const;
+
+    /// Generate the header shared by all translation units (split mode)
+    void generate_common(const std::string& basename) const;
+
+    /// Generate a struct with statically sized work buffers and an entry point using it
+    void generate_arena(const Function& f);
+
+    /// Print the memory footprint as a comment (embedded mode)
+    void print_footprint(std::ostream& s) const;
+
     //  private:
   public:
     /// \cond INTERNAL
@@ -198,6 +245,15 @@ namespace casadi {
     // Real-type used for the codegen
     std::string real_t;
 
+    // Real-type for accumulating sums in the runtime functions
+    std::string real_acc_t;
+
+    // Real-type for the intermediates of SX functions, by function name
+    std::map<std::string, std::string> local_real_t_fcn;
+
+    // Real-type for the intermediates of other SX functions
+    std::string local_real_t_default;
+
     // Generate header file?
     bool with_header;
 
@@ -213,6 +269,31 @@ namespace casadi {
     // Should we generate a main (allowing evaluation from command line)
     bool main;
 
+    // Split the code into multiple translation units?
+    bool split;
+
+    // Maximum number of elementary operations per translation unit, split mode
+    int split_size;
+
+    // Generate functions evaluating at several points in one call
+    bool batch;
+
+    // Emit every intermediate as a constant, assigned once (SX)
+    bool single_assignment;
+
+    // Access inputs and outputs through restrict-qualified pointers (SX)
+    bool with_restrict;
+
+    // Generate code for hard real-time targets: static memory only, no stdio
+    bool embedded;
+
+    // Size of a pointer on the target in bytes, for the footprint
+    int pointer_size;
+
+    // Size of real_t on the target in bytes, for the footprint. Defaults to the size
+    // on the host for "long double", which varies between platforms
+    int real_t_size;
+
     /** \brief Codegen scalar
      * Use the work vector for storing work vector elements of length 1
      * (typically scalar) instead of using local variables
@@ -225,9 +306,21 @@ namespace casadi {
     std::stringstream body;
     std::stringstream header;
 
+    // Declarations shared between the translation units, split mode
+    std::stringstream declarations;
+
+    // Prototypes, shorthands and preprocessor conditionals of the auxiliaries, split mode
+    std::stringstream auxiliary_declarations;
+
+    // Translation units in addition to the main one, split mode
+    std::vector<std::string> units;
+
     // Names of exposed functions
     std::vector<std::string> exposed_fname;
 
+    // Size in bytes of the work buffer struct of each exposed function, embedded mode
+    std::vector<std::pair<std::string, size_t> > arena_size_;
+
     // Set of already included header files
     typedef std::map<const void*, int> PointerMap;
     std::set<std::string> added_includes_;
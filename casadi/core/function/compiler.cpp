@@ -25,6 +25,7 @@
 
 #include "compiler.hpp"
 #include "compiler_internal.hpp"
+#include "../casadi_trace.hpp"
 
 using namespace std;
 namespace casadi {
@@ -35,6 +36,7 @@ namespace casadi {
   Compiler::Compiler(const std::string& name,
                            const std::string& compiler,
                            const Dict& opts) {
+    TraceScope trace(name, "compile");
     if (compiler=="none") {
       assignNode(new CompilerInternal(name));
     } else {
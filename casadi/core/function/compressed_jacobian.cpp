@@ -0,0 +1,379 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+
+#include "compressed_jacobian.hpp"
+
+#include <cmath>
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif // WITH_OPENMP
+
+using namespace std;
+
+namespace casadi {
+
+  CompressedJacobian::CompressedJacobian(const std::string& name, const Function& f,
+                                         int iind, int oind, bool compact, bool symmetric,
+                                         bool fd)
+    : FunctionInternal(name), f_(f), iind_(iind), oind_(oind),
+      compact_(compact), symmetric_(symmetric), fd_(fd) {
+  }
+
+  Options CompressedJacobian::options_
+  = {{&FunctionInternal::options_},
+     {{"fd_method",
+       {OT_STRING,
+        "Finite difference scheme: 'central' (default) or 'forward'"}},
+      {"fd_step",
+       {OT_DOUBLE,
+        "Relative step size, the perturbation is fd_step*max(1, |x|). "
+        "Defaults to the cubic root (central) or square root (forward) "
+        "of the machine precision."}},
+      {"n_threads",
+       {OT_INT,
+        "Number of threads for evaluating the perturbed points in parallel. "
+        "Requires OpenMP and a function that can be called concurrently, "
+        "i.e. not a Callback. Each thread uses a memory object of its own."}}
+     }
+  };
+
+  CompressedJacobian::~CompressedJacobian() {
+  }
+
+  Sparsity CompressedJacobian::get_sparsity_out(int i) {
+    if (i==0) {
+      return f_.sparsity_jac(iind_, oind_, compact_, symmetric_);
+    } else {
+      return f_.sparsity_out(i-1);
+    }
+  }
+
+  void CompressedJacobian::init(const Dict& opts) {
+    // Call the initialization method of the base class
+    FunctionInternal::init(opts);
+
+    // Default options
+    fd_central_ = true;
+    fd_step_ = -1;
+    n_threads_ = 1;
+
+    // Read options
+    for (auto&& op : opts) {
+      if (op.first=="fd_method") {
+        string m = op.second;
+        casadi_assert_message(m=="central" || m=="forward",
+                              "Unknown finite difference scheme: " + m);
+        fd_central_ = m=="central";
+      } else if (op.first=="fd_step") {
+        fd_step_ = op.second;
+      } else if (op.first=="n_threads") {
+        n_threads_ = op.second;
+      }
+    }
+    if (fd_step_<0) {
+      double eps = numeric_limits<double>::epsilon();
+      fd_step_ = fd_central_ ? cbrt(eps) : sqrt(eps);
+    }
+    casadi_assert_message(fd_step_>0, "'fd_step' must be positive");
+    casadi_assert_message(n_threads_>=1, "'n_threads' must be a positive integer");
+    // Callbacks, e.g. from Python, may not be entered from several threads
+    casadi_assert_message(n_threads_==1 || !f_.is_a("callback"),
+                          "'n_threads' must be 1 for a Callback");
+#ifndef WITH_OPENMP
+    casadi_assert_warning(n_threads_==1, "CasADi was not compiled with OpenMP. "
+                          "Falling back to serial evaluation of the perturbed points.");
+    n_threads_ = 1;
+#endif // WITH_OPENMP
+
+    // Compact Jacobian sparsity and seed matrices from the graph coloring
+    Sparsity jsp = f_.sparsity_jac(iind_, oind_, true, symmetric_);
+    casadi_assert_message(jsp.nnz()==sparsity_out(0).nnz(),
+                          "CompressedJacobian: Inconsistent Jacobian sparsity patterns");
+    Sparsity D1, D2;
+    if (jsp.nnz()>0) {
+      if (fd_) {
+        // Finite differences only give forward directional derivatives
+        D1 = symmetric_ ? jsp.star_coloring() : jsp.uni_coloring(jsp.T());
+        if (verbose()) userOut() << "CompressedJacobian: " << D1.size2() << " perturbations "
+                                 << "needed (" << jsp.size2() << " without coloring)" << endl;
+      } else {
+        f_->getPartition(iind_, oind_, D1, D2, true, symmetric_);
+      }
+    }
+    casadi_assert_message(D1.is_null() || D2.is_null(),
+                          "CompressedJacobian: Bidirectional coloring not supported");
+    fwd_ = !D1.is_null();
+    seed_ = fwd_ ? D1 : D2;
+    ndir_ = seed_.is_null() ? 0 : seed_.size2();
+    nbatch_ = fd_ ? 0 : std::min(ndir_, optimized_num_dir);
+    nseed_ = fwd_ ? f_.nnz_in(iind_) : f_.nnz_out(oind_);
+    nsens_ = fwd_ ? f_.nnz_out(oind_) : f_.nnz_in(iind_);
+
+    // Directional derivative function
+    if (ndir_>0 && !fd_) df_ = fwd_ ? f_.forward(nbatch_) : f_.reverse(nbatch_);
+
+    // Color of each seeded nonzero
+    vector<int> color(nseed_, -1);
+    for (int d=0; d<ndir_; ++d) {
+      for (int el=seed_.colind(d); el<seed_.colind(d+1); ++el) color[seed_.row(el)] = d;
+    }
+
+    // Pattern with the seeded nonzeros as columns and the sensitivities as rows
+    vector<int> mapping;
+    Sparsity A = fwd_ ? jsp : jsp.transpose(mapping);
+    if (fwd_) mapping = range(jsp.nnz());
+    vector<int> mapping_tr;
+    Sparsity AT = A.transpose(mapping_tr);
+
+    // For each Jacobian nonzero, the direction and sensitivity nonzero it is recovered from
+    vector<int> nz_dir(jsp.nnz(), -1), nz_sens(jsp.nnz(), -1), nz_seed(jsp.nnz(), -1);
+    vector<int> count(ndir_, 0);
+    for (int i=0; i<AT.size2(); ++i) {
+      // Count the number of entries in the row of each color
+      for (int el=AT.colind(i); el<AT.colind(i+1); ++el) count[color[AT.row(el)]]++;
+      for (int el=AT.colind(i); el<AT.colind(i+1); ++el) {
+        int c = AT.row(el), k = mapping[mapping_tr[el]];
+        if (count[color[c]]==1) {
+          // Structurally orthogonal, entry can be read off directly
+          nz_dir[k] = color[c];
+          nz_sens[k] = i;
+          nz_seed[k] = c;
+        } else {
+          // Star coloring, recover from the symmetric entry
+          casadi_assert_message(symmetric_, "CompressedJacobian: Inconsistent coloring");
+          nz_dir[k] = color[i];
+          nz_sens[k] = c;
+          nz_seed[k] = i;
+        }
+      }
+      for (int el=AT.colind(i); el<AT.colind(i+1); ++el) count[color[AT.row(el)]] = 0;
+    }
+
+    // Sort by direction
+    dir_ptr_.resize(ndir_+1);
+    fill(dir_ptr_.begin(), dir_ptr_.end(), 0);
+    for (int k=0; k<nz_dir.size(); ++k) dir_ptr_[nz_dir[k]+1]++;
+    for (int d=0; d<ndir_; ++d) dir_ptr_[d+1] += dir_ptr_[d];
+    dir_nz_.resize(jsp.nnz());
+    dir_sens_.resize(jsp.nnz());
+    dir_seed_.resize(jsp.nnz());
+    vector<int> pos(dir_ptr_.begin(), dir_ptr_.end()-1);
+    for (int k=0; k<nz_dir.size(); ++k) {
+      int el = pos[nz_dir[k]]++;
+      dir_nz_[el] = k;
+      dir_sens_[el] = nz_sens[k];
+      dir_seed_[el] = nz_seed[k];
+    }
+
+    // Work vectors for calling f_ and df_
+    size_t sz_arg, sz_res, sz_iw, sz_w;
+    f_.sz_work(sz_arg, sz_res, sz_iw, sz_w);
+    if (fd_) {
+      // Separate work vectors for each thread, step sizes
+      alloc_arg(n_threads_*sz_arg);
+      alloc_res(n_threads_*sz_res);
+      alloc_iw(n_threads_*sz_iw);
+      alloc_w(f_.nnz_out() + nseed_ + n_threads_*(nseed_ + 2*nsens_ + sz_w));
+      return;
+    }
+    if (ndir_>0) {
+      sz_arg = std::max(sz_arg, df_.sz_arg());
+      sz_res = std::max(sz_res, df_.sz_res());
+      sz_iw = std::max(sz_iw, df_.sz_iw());
+      sz_w = std::max(sz_w, df_.sz_w());
+    }
+    alloc_arg(sz_arg);
+    alloc_res(sz_res);
+    alloc_iw(sz_iw);
+    alloc_w(sz_w + f_.nnz_out() + nbatch_*(nseed_ + nsens_));
+  }
+
+  void CompressedJacobian::eval(void* mem, const double** arg, double** res,
+                                int* iw, double* w) const {
+    int n_in = f_.n_in(), n_out = f_.n_out();
+    const double** arg1 = arg + this->n_in();
+    double** res1 = res + this->n_out();
+
+    // Work vectors for the nondifferentiated outputs, seeds and sensitivities
+    double* out = w; w += f_.nnz_out();
+    double* seed = w; w += nbatch_*nseed_;
+    double* sens = w; w += nbatch_*nsens_;
+
+    // Evaluate nondifferentiated function
+    copy(arg, arg+n_in, arg1);
+    for (int i=0; i<n_out; ++i) {
+      res1[i] = res[i+1] ? res[i+1] : out;
+      out += f_.nnz_out(i);
+    }
+    f_(arg1, res1, iw, w, 0);
+
+    // Quick return if Jacobian not requested
+    double* jac = res[0];
+    if (jac==0) return;
+    fill_n(jac, nnz_out(0), 0);
+    if (ndir_==0) return;
+
+    // Approximate with finite differences
+    if (fd_) return eval_fd(arg, res1[oind_], jac, arg1, res1, iw, w);
+
+    // Nondifferentiated outputs are inputs to the derivative function
+    copy(res1, res1+n_out, arg1+n_in);
+
+    // Number of seeds and sensitivities per direction and their index
+    int n_seed = fwd_ ? n_in : n_out, i_seed = fwd_ ? iind_ : oind_;
+    int n_sens = fwd_ ? n_out : n_in, i_sens = fwd_ ? oind_ : iind_;
+
+    // Evaluate the compressed directions in batches
+    for (int offset=0; offset<ndir_; offset+=nbatch_) {
+      int nb = std::min(nbatch_, ndir_-offset);
+
+      // Seeds, unused directions are zero
+      fill_n(seed, nbatch_*nseed_, 0);
+      for (int b=0; b<nb; ++b) {
+        for (int el=seed_.colind(offset+b); el<seed_.colind(offset+b+1); ++el) {
+          seed[b*nseed_ + seed_.row(el)] = 1;
+        }
+      }
+      for (int b=0; b<nbatch_; ++b) {
+        for (int i=0; i<n_seed; ++i) {
+          arg1[n_in+n_out+b*n_seed+i] = i==i_seed && b<nb ? seed+b*nseed_ : 0;
+        }
+        for (int i=0; i<n_sens; ++i) {
+          res1[b*n_sens+i] = i==i_sens && b<nb ? sens+b*nsens_ : 0;
+        }
+      }
+
+      // Calculate directional derivatives
+      df_(arg1, res1, iw, w, 0);
+
+      // Scatter to the Jacobian nonzeros
+      for (int b=0; b<nb; ++b) {
+        const double* sens_b = sens + b*nsens_;
+        for (int el=dir_ptr_[offset+b]; el<dir_ptr_[offset+b+1]; ++el) {
+          jac[dir_nz_[el]] = sens_b[dir_sens_[el]];
+        }
+      }
+    }
+  }
+
+  void CompressedJacobian::eval_fd(const double** arg, const double* y0, double* jac,
+                                   const double** arg1, double** res1,
+                                   int* iw, double* w) const {
+    int n_in = f_.n_in(), n_out = f_.n_out();
+    size_t sz_arg, sz_res, sz_iw, sz_w;
+    f_.sz_work(sz_arg, sz_res, sz_iw, sz_w);
+
+    // Perturbation for each seeded nonzero
+    const double* x = arg[iind_];
+    double* h = w; w += nseed_;
+    for (int j=0; j<nseed_; ++j) h[j] = fd_step_*std::max(1., fabs(x ? x[j] : 0));
+
+    // Perturb all entries of the same color at once
+    size_t sz_thread = nseed_ + 2*nsens_ + sz_w;
+    string err;
+#ifdef WITH_OPENMP
+#pragma omp parallel for num_threads(n_threads_) schedule(dynamic)
+#endif // WITH_OPENMP
+    for (int d=0; d<ndir_; ++d) {
+#ifdef WITH_OPENMP
+      int t = omp_get_thread_num();
+#else // WITH_OPENMP
+      int t = 0;
+#endif // WITH_OPENMP
+      const double** arg_t = arg1 + t*sz_arg;
+      double** res_t = res1 + t*sz_res;
+      double* xp = w + t*sz_thread;
+      double* yp = xp + nseed_;
+      double* ym = yp + nsens_;
+      // Memory object of its own, cf. the "mem_pool" option of the function
+      int mem = f_->checkout();
+      try {
+        for (int s=0; s<(fd_central_ ? 2 : 1); ++s) {
+          // Perturbed input
+          if (x) {
+            copy(x, x+nseed_, xp);
+          } else {
+            fill_n(xp, nseed_, 0);
+          }
+          for (int el=seed_.colind(d); el<seed_.colind(d+1); ++el) {
+            int j = seed_.row(el);
+            xp[j] += s==0 ? h[j] : -h[j];
+          }
+
+          // Evaluate, only the output of interest
+          copy(arg, arg+n_in, arg_t);
+          arg_t[iind_] = xp;
+          fill_n(res_t, n_out, static_cast<double*>(0));
+          res_t[oind_] = s==0 ? yp : ym;
+          f_(arg_t, res_t, iw + t*sz_iw, ym + nsens_, mem);
+        }
+
+        // Difference quotients
+        const double* yref = fd_central_ ? ym : y0;
+        double scale = fd_central_ ? 2 : 1;
+        for (int el=dir_ptr_[d]; el<dir_ptr_[d+1]; ++el) {
+          int r = dir_sens_[el];
+          jac[dir_nz_[el]] = (yp[r] - yref[r])/(scale*h[dir_seed_[el]]);
+        }
+      } catch (exception& e) {
+#ifdef WITH_OPENMP
+#pragma omp critical(compressed_jacobian_error)
+#endif // WITH_OPENMP
+        if (err.empty()) err = e.what();
+      }
+      f_->release(mem);
+    }
+    casadi_assert_message(err.empty(), err);
+  }
+
+  Function CompressedJacobian::symbolic_jacobian() {
+    Dict opts = {{"input_scheme", ischeme_},
+                 {"output_scheme", oscheme_}};
+    return f_->getJacobian(name_ + "_sym", iind_, oind_, compact_, symmetric_, opts);
+  }
+
+  Function CompressedJacobian
+  ::get_forward(const std::string& name, int nfwd, Dict& opts) {
+    casadi_assert_message(!fd_, "Derivatives of finite difference Jacobians not supported");
+    return symbolic_jacobian()->get_forward(name, nfwd, opts);
+  }
+
+  Function CompressedJacobian
+  ::get_reverse(const std::string& name, int nadj, Dict& opts) {
+    casadi_assert_message(!fd_, "Derivatives of finite difference Jacobians not supported");
+    return symbolic_jacobian()->get_reverse(name, nadj, opts);
+  }
+
+  void CompressedJacobian::print(ostream &stream) const {
+    stream << "CompressedJacobian(" << f_.name() << ", " << ndir_ << " ";
+    if (fd_) {
+      stream << (fd_central_ ? "central" : "forward") << " differences)";
+    } else {
+      stream << (fwd_ ? "forward" : "reverse") << " directions)";
+    }
+  }
+
+} // namespace casadi
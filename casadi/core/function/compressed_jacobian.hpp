@@ -0,0 +1,150 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+
+#ifndef CASADI_COMPRESSED_JACOBIAN_HPP
+#define CASADI_COMPRESSED_JACOBIAN_HPP
+
+#include "function_internal.hpp"
+
+/// \cond INTERNAL
+
+namespace casadi {
+
+  /** \brief Jacobian evaluated numerically from compressed directional derivatives
+
+      Instead of constructing a symbolic expression for the Jacobian, the seed
+      matrices from the graph coloring are stored together with a single forward
+      or reverse derivative function. At evaluation time, all compressed directions
+      are evaluated in batches and the result is scattered into the nonzeros of the
+      Jacobian. This trades construction time and memory for evaluation time.
+
+      For functions without derivative information, e.g. black-box callbacks, the
+      directional derivatives are instead approximated by finite differences,
+      perturbing all columns of the same color at once.
+  */
+  class CASADI_EXPORT CompressedJacobian : public FunctionInternal {
+  public:
+    /** \brief Constructor */
+    CompressedJacobian(const std::string& name, const Function& f,
+                       int iind, int oind, bool compact, bool symmetric, bool fd);
+
+    /** \brief  Destructor */
+    virtual ~CompressedJacobian();
+
+    ///@{
+    /** \brief Number of function inputs and outputs */
+    virtual size_t get_n_in() { return f_.n_in();}
+    virtual size_t get_n_out() { return 1 + f_.n_out();}
+    ///@}
+
+    /// @{
+    /** \brief Sparsities of function inputs and outputs */
+    virtual Sparsity get_sparsity_in(int i) { return f_.sparsity_in(i);}
+    virtual Sparsity get_sparsity_out(int i);
+    /// @}
+
+    ///@{
+    /** \brief Options */
+    static Options options_;
+    virtual const Options& get_options() const { return options_;}
+    ///@}
+
+    /** \brief  Initialize */
+    virtual void init(const Dict& opts);
+
+    /** \brief  Evaluate numerically, work vectors given */
+    virtual void eval(void* mem, const double** arg, double** res, int* iw, double* w) const;
+
+    ///@{
+    /** \brief Generate a function that calculates \a nfwd forward derivatives */
+    virtual Function get_forward(const std::string& name, int nfwd, Dict& opts);
+    virtual int get_n_forward() const { return 64;}
+    ///@}
+
+    ///@{
+    /** \brief Generate a function that calculates \a nadj adjoint derivatives */
+    virtual Function get_reverse(const std::string& name, int nadj, Dict& opts);
+    virtual int get_n_reverse() const { return 64;}
+    ///@}
+
+    /** \brief  Print description */
+    virtual void print(std::ostream &stream) const;
+
+  protected:
+    /// Symbolic Jacobian, used for higher order derivatives
+    Function symbolic_jacobian();
+
+    /// Approximate the directional derivatives with finite differences
+    void eval_fd(const double** arg, const double* y0, double* jac,
+                 const double** arg1, double** res1, int* iw, double* w) const;
+
+    // Function being differentiated
+    Function f_;
+
+    // Input and output index
+    int iind_, oind_;
+
+    // Flags
+    bool compact_, symmetric_;
+
+    // Forward (true) or reverse (false) mode
+    bool fwd_;
+
+    // Finite differences instead of directional derivatives
+    bool fd_;
+
+    // Central (true) or forward (false) differences
+    bool fd_central_;
+
+    // Relative step size for finite differences
+    double fd_step_;
+
+    // Number of threads for evaluating perturbed points
+    int n_threads_;
+
+    // Number of compressed directions and number of directions per sweep
+    int ndir_, nbatch_;
+
+    // Directional derivative function, for nbatch_ directions
+    Function df_;
+
+    // Seed matrix, seeded nonzeros for each direction
+    Sparsity seed_;
+
+    // Number of seeded and sensitivity nonzeros per direction
+    int nseed_, nsens_;
+
+    // Jacobian nonzeros recovered from each direction (CCS-like)
+    std::vector<int> dir_ptr_, dir_nz_;
+
+    // Corresponding sensitivity nonzero and seeded nonzero
+    std::vector<int> dir_sens_, dir_seed_;
+  };
+
+} // namespace casadi
+/// \endcond
+
+#endif // CASADI_COMPRESSED_JACOBIAN_HPP
@@ -0,0 +1,153 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "derivative_cache.hpp"
+#include "function_internal.hpp"
+#include "../global_options.hpp"
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+using namespace std;
+
+namespace casadi {
+
+  namespace {
+    /// A cached derivative
+    struct Entry {
+      const FunctionInternal* owner;
+      Function f;
+      size_t bytes;
+    };
+
+    /// Cached derivatives, most recently used first
+    struct Cache {
+      mutex mtx;
+      list<Entry> lru;
+      unordered_map<const FunctionInternal*, list<Entry>::iterator> index;
+      unordered_map<const FunctionInternal*, int> n_owner;
+      size_t bytes = 0;
+
+      /// Remove an entry, the function is moved to released
+      void erase(list<Entry>::iterator it, vector<Function>& released) {
+        released.push_back(it->f);
+        bytes -= it->bytes;
+        if (--n_owner[it->owner]==0) n_owner.erase(it->owner);
+        index.erase(it->f.get());
+        lru.erase(it);
+      }
+    };
+
+    Cache& cache() {
+      // Never destroyed, functions may be destroyed during static destruction
+      static Cache* c = new Cache();
+      return *c;
+    }
+  } // namespace
+
+  void DerivativeCache::touch(const FunctionInternal* owner, const Function& f, int max_owner) {
+    if (f.is_null()) return;
+    // Functions released here are freed after unlocking, since freeing may cascade
+    vector<Function> released;
+    Cache& c = cache();
+    unique_lock<mutex> lock(c.mtx);
+
+    // Move to front if already cached
+    auto it = c.index.find(f.get());
+    if (it!=c.index.end()) {
+      c.lru.splice(c.lru.begin(), c.lru, it->second);
+      return;
+    }
+
+    // Memory usage, without holding the lock
+    lock.unlock();
+    Entry e = {owner, f, static_cast<size_t>(f.memory_usage().at("total").to_double())};
+    lock.lock();
+    if (c.index.count(f.get())) return;
+
+    // Add to front
+    c.lru.push_front(e);
+    c.index[f.get()] = c.lru.begin();
+    c.n_owner[owner]++;
+    c.bytes += e.bytes;
+
+    // Evict least recently used derivatives of the same function
+    if (max_owner>=0) {
+      auto j = c.lru.end();
+      while (c.n_owner[owner]>max_owner && j!=c.lru.begin()) {
+        --j;
+        if (j->owner==owner) c.erase(j++, released);
+      }
+    }
+
+    // Evict least recently used derivatives, never the one just added
+    int max_entries = GlobalOptions::derivative_cache_entries;
+    long max_memory = GlobalOptions::derivative_cache_memory;
+    while (c.lru.size()>1 && ((max_entries>0 && c.lru.size()>max_entries)
+                              || (max_memory>0 && c.bytes>max_memory))) {
+      c.erase(--c.lru.end(), released);
+    }
+  }
+
+  void DerivativeCache::release(const FunctionInternal* owner) {
+    vector<Function> released;
+    Cache& c = cache();
+    lock_guard<mutex> lock(c.mtx);
+    // Quick return, called whenever a function is destroyed
+    if (c.n_owner.count(owner)==0) return;
+    for (auto it=c.lru.begin(); it!=c.lru.end();) {
+      if (it->owner==owner) {
+        c.erase(it++, released);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  void DerivativeCache::clear() {
+    vector<Function> released;
+    Cache& c = cache();
+    lock_guard<mutex> lock(c.mtx);
+    for (auto&& e : c.lru) released.push_back(e.f);
+    c.lru.clear();
+    c.index.clear();
+    c.n_owner.clear();
+    c.bytes = 0;
+  }
+
+  int DerivativeCache::size() {
+    Cache& c = cache();
+    lock_guard<mutex> lock(c.mtx);
+    return c.lru.size();
+  }
+
+  size_t DerivativeCache::memory() {
+    Cache& c = cache();
+    lock_guard<mutex> lock(c.mtx);
+    return c.bytes;
+  }
+
+} // namespace casadi
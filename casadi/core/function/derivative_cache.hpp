@@ -0,0 +1,81 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifndef CASADI_DERIVATIVE_CACHE_HPP
+#define CASADI_DERIVATIVE_CACHE_HPP
+
+#include "function.hpp"
+
+/// \cond INTERNAL
+
+namespace casadi {
+
+  // Forward declaration
+  class FunctionInternal;
+
+  /** \brief Strong cache of derivative functions with least recently used eviction
+
+      The derivative caches of FunctionInternal only hold weak references, so
+      derivative functions are freed as soon as the user drops them. This cache
+      keeps them alive within a budget: GlobalOptions::derivative_cache_entries
+      and GlobalOptions::derivative_cache_memory for the whole process, and
+      the "derivative_cache" option for the derivatives of an individual function.
+
+      Entries are keyed by the function the derivatives were generated from,
+      which releases them when it is destroyed, so that a new function at the
+      same address never inherits them. Derivatives only refer weakly to that
+      function ("derivative_of"), so caching them does not keep it alive.
+      Derivatives that evaluate the original function, e.g. finite difference
+      or compressed Jacobians, do hold it and keep it alive until evicted.
+  */
+  class CASADI_EXPORT DerivativeCache {
+  private:
+    /// No instances are allowed
+    DerivativeCache();
+  public:
+    /** \brief Keep a derivative of a function alive, marking it as most recently used
+     * \param owner Function the derivative was generated from
+     * \param max_owner Maximum number of cached derivatives of owner, -1 for no limit
+     */
+    static void touch(const FunctionInternal* owner, const Function& f, int max_owner);
+
+    /// Release all cached derivatives of a function
+    static void release(const FunctionInternal* owner);
+
+    /// Release all cached derivatives
+    static void clear();
+
+    /// Number of cached derivatives
+    static int size();
+
+    /// Memory held by the cached derivatives [bytes], estimate
+    static size_t memory();
+  };
+
+} // namespace casadi
+
+/// \endcond
+
+#endif // CASADI_DERIVATIVE_CACHE_HPP
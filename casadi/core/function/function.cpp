@@ -34,6 +34,7 @@
 #include "nlpsol.hpp"
 #include "qpsol.hpp"
 #include "jit.hpp"
+#include "derivative_cache.hpp"
 #include "../casadi_file.hpp"
 
 #include <typeinfo>
@@ -275,6 +276,58 @@ namespace casadi {
     (*this)->call(arg, res, always_inline, never_inline);
   }
 
+  void Function::call_batch(const vector<vector<DM> >& arg, vector<vector<DM> >& res,
+                            int n_threads) const {
+    int n = arg.size(), n_in = this->n_in(), n_out = this->n_out();
+
+    // Inputs with the correct sparsity, copied only if needed
+    vector<vector<DM> > arg2(n);
+    for (int k=0; k<n; ++k) {
+      bool matching = (*this)->matchingArg(arg[k]);
+      for (int i=0; matching && i<n_in; ++i) matching = arg[k][i].sparsity()==sparsity_in(i);
+      if (matching) continue;
+      arg2[k] = (*this)->replaceArg(arg[k]);
+      for (int i=0; i<n_in; ++i) {
+        if (arg2[k][i].sparsity()!=sparsity_in(i)) {
+          arg2[k][i] = project(arg2[k][i], sparsity_in(i));
+        }
+      }
+    }
+
+    // Allocate results
+    res.resize(n);
+    for (auto&& r : res) {
+      r.resize(n_out);
+      for (int i=0; i<n_out; ++i) {
+        if (r[i].sparsity()!=sparsity_out(i)) r[i] = DM::zeros(sparsity_out(i));
+      }
+    }
+
+    // Buffers for all calls
+    vector<const double*> argv(n*n_in);
+    vector<double*> resv(n*n_out);
+    vector<const double**> argp(n);
+    vector<double**> resp(n);
+    for (int k=0; k<n; ++k) {
+      argp[k] = get_ptr(argv) + k*n_in;
+      const vector<DM>& a = arg2[k].empty() ? arg[k] : arg2[k];
+      for (int i=0; i<n_in; ++i) argp[k][i] = get_ptr(a[i]);
+      resp[k] = get_ptr(resv) + k*n_out;
+      for (int i=0; i<n_out; ++i) resp[k][i] = get_ptr(res[k][i]);
+    }
+    call_batch(argp, resp, n_threads);
+  }
+
+  void Function::call_batch(const vector<const double**>& arg, const vector<double**>& res,
+                            int n_threads) const {
+    casadi_assert_message(arg.size()==res.size(), "Function::call_batch: Dimension mismatch");
+    (*this)->call_batch(arg.size(), get_ptr(arg), get_ptr(res), n_threads);
+  }
+
+  AsyncCall Function::call_async(const vector<DM>& arg) const {
+    return AsyncCall::launch(*this, arg);
+  }
+
   vector<const double*> Function::buf_in(Function::VecArg arg) const {
     casadi_assert(arg.size()==n_in());
     auto arg_it=arg.begin();
@@ -613,6 +666,38 @@ namespace casadi {
     return (*this)->_get_stats(mem);
   }
 
+  std::string Function::profile_json() const {
+    stringstream ss;
+    (*this)->profile_json(ss);
+    return ss.str();
+  }
+
+  std::string Function::profile_folded() const {
+    stringstream ss;
+    (*this)->profile_folded(ss, "", 1);
+    return ss.str();
+  }
+
+  void Function::profile_reset() {
+    (*this)->profile_reset();
+  }
+
+  Dict Function::memory_usage() const {
+    return (*this)->memory_usage();
+  }
+
+  Dict Function::memory_usage_global() {
+    return FunctionInternal::memory_usage_global();
+  }
+
+  void Function::release_derivatives() {
+    (*this)->release_derivatives();
+  }
+
+  void Function::clear_derivative_cache() {
+    DerivativeCache::clear();
+  }
+
   const Sparsity Function::sparsity_jac(int iind, int oind, bool compact, bool symmetric) {
     return (*this)->sparsity_jac(iind, oind, compact, symmetric);
   }
@@ -859,6 +944,14 @@ namespace casadi {
     return (*this)->reverse(nadj);
   }
 
+  JacobianProduct Function::jvp(int ndir) {
+    return JacobianProduct(*this, ndir, false);
+  }
+
+  JacobianProduct Function::vjp(int ndir) {
+    return JacobianProduct(*this, ndir, true);
+  }
+
   void Function::set_forward(const Function& fcn, int nfwd) {
     (*this)->set_forward(fcn, nfwd);
   }
@@ -1221,4 +1314,8 @@ namespace casadi {
     return (*this)->memory(ind);
   }
 
+  void Function::call_threadsafe(const double** arg, double** res) const {
+    (*this)->call_threadsafe(arg, res);
+  }
+
 } // namespace casadi
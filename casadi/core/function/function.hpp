@@ -28,6 +28,7 @@
 
 #include "../sx/sx_elem.hpp"
 #include "../mx/mx.hpp"
+#include "async_call.hpp"
 
 #include <exception>
 
@@ -44,9 +45,11 @@ namespace casadi {
 #ifndef SWIG
   /** Forward declaration of internal class */
   class FunctionInternal;
-
 #endif // SWIG
 
+  // Forward declaration
+  class JacobianProduct;
+
   /** \brief General function
 
       A general function \f$f\f$ in casadi can be multi-input, multi-output.\n
@@ -408,6 +411,34 @@ namespace casadi {
               bool always_inline=false, bool never_inline=false);
     ///@}
 
+    /** \brief Evaluate numerically for a batch of independent inputs
+     *
+     * Equivalent to calling the function once for each entry of \a arg, but with work
+     * vectors and memory objects allocated once, and with the calls distributed over
+     * \a n_threads threads (requires OpenMP). Unlike map, the inputs need not be
+     * concatenated.
+     */
+    void call_batch(const std::vector<std::vector<DM> >& arg,
+                    std::vector<std::vector<DM> >& SWIG_OUTPUT(res), int n_threads=1) const;
+
+#ifndef SWIG
+    /** \brief Evaluate numerically for a batch of independent inputs
+     *
+     * \a arg[k] and \a res[k] point to n_in() input and n_out() output buffers
+     * of the k-th call, null pointers meaning zero inputs and ignored outputs.
+     */
+    void call_batch(const std::vector<const double**>& arg, const std::vector<double**>& res,
+                    int n_threads=1) const;
+#endif // SWIG
+
+    /** \brief Evaluate numerically without blocking
+     *
+     * The evaluation is queued on an internal pool of worker threads, using a memory
+     * object and work vectors of its own. The result is retrieved from the returned
+     * handle. Requires the evaluation to be reentrant, cf. call_threadsafe.
+     */
+    AsyncCall call_async(const std::vector<DM>& arg) const;
+
 #ifndef SWIG
     ///@{
     /// Functor shorthand for evaluation
@@ -552,19 +583,19 @@ namespace casadi {
     /// \endcond
 
     /** \brief  Evaluate symbolically in parallel (matrix graph)
-        \param parallelization Type of parallelization used: unroll|serial|openmp
+        \param parallelization Type of parallelization used: unroll|serial|openmp|thread
     */
     std::vector<MX> map(const std::vector<MX > &arg,
                         const std::string& parallelization="serial");
 
     /** \brief  Evaluate symbolically in parallel (matrix graph)
-        \param parallelization Type of parallelization used: unroll|serial|openmp
+        \param parallelization Type of parallelization used: unroll|serial|openmp|thread
     */
     std::map<std::string, MX> map(const std::map<std::string, MX> &arg,
                         const std::string& parallelization="serial");
 
     /** \brief  Evaluate symbolically in parallel and sum (matrix graph)
-        \param parallelization Type of parallelization used: unroll|serial|openmp
+        \param parallelization Type of parallelization used: unroll|serial|openmp|thread
     */
     std::vector<MX> mapsum(const std::vector<MX > &arg,
                            const std::string& parallelization="serial");
@@ -626,7 +657,7 @@ namespace casadi {
                 s_(N-1) <- f(a_(N-1), p_(N-1))
         \endverbatim
 
-        \param parallelization Type of parallelization used: unroll|serial|openmp
+        \param parallelization Type of parallelization used: unroll|serial|openmp|thread
 
     */
 
@@ -734,6 +765,16 @@ namespace casadi {
      */
     Function reverse(int nadj);
 
+    /** \brief Get an object for evaluating \a ndir Jacobian-vector products J*v
+     *         on raw buffers, cf. JacobianProduct
+     */
+    JacobianProduct jvp(int ndir=1);
+
+    /** \brief Get an object for evaluating \a ndir vector-Jacobian products v^T*J
+     *         on raw buffers, cf. JacobianProduct
+     */
+    JacobianProduct vjp(int ndir=1);
+
     /** \brief Set a function that calculates \a nfwd forward derivatives
         NOTE: Does _not_ take ownership, only weak references to the derivatives are kept internally */
     void set_forward(const Function& fcn, int nfwd);
@@ -801,6 +842,63 @@ namespace casadi {
     /// Get all statistics obtained at the end of the last evaluate call
     Dict stats(int mem=0) const;
 
+    /** \brief Profiling data in JSON format
+     *
+     * Number of calls and accumulated wall time of the function and of each
+     * operation, recorded when the "profile" option is set. Called functions which
+     * are profiled themselves are nested.
+     */
+    std::string profile_json() const;
+
+    /** \brief Profiling data as folded stacks
+     *
+     * One line per stack with the accumulated wall time in microseconds, the input
+     * format of flame graph tools. The time of a call to a profiled function is
+     * distributed over its operations in proportion to their share of its total time.
+     */
+    std::string profile_folded() const;
+
+    /// Reset profiling data
+    void profile_reset();
+
+    /** \brief Estimated memory held by the function [bytes], by category
+     *
+     * graph: nodes of the expression graph (SX or MX)
+     * algorithm: the algorithm of the function
+     * work: work vectors needed for an evaluation (sz_arg, sz_res, sz_iw, sz_w)
+     * sparsity: input and output sparsity patterns
+     * jac_sparsity: cached sparsity patterns of the Jacobian blocks
+     * derivatives: cached derivative functions still alive, recursively
+     * total: the sum of the above
+     *
+     * Objects shared between functions are counted for each function
+     */
+    Dict memory_usage() const;
+
+    /** \brief Estimated memory held by the global caches [bytes]
+     *
+     * sparsity_cache: sparsity patterns currently alive in the sparsity cache
+     * sx_constant_cache: cached SX constants (real and integer)
+     * derivative_cache: derivative functions kept alive by the strong derivative cache
+     */
+    static Dict memory_usage_global();
+
+    /** \brief Release the cached derivative functions and Jacobian sparsity patterns
+     *
+     * Derivative functions are regenerated when needed. Functions still referenced
+     * elsewhere, e.g. from expressions, are not freed. Patterns set with
+     * set_jac_sparsity are kept.
+     */
+    void release_derivatives();
+
+    /** \brief Release all derivative functions held by the strong derivative cache
+     *
+     * Cached derivatives keep the function they were generated from alive until
+     * they are evicted or released.
+     * Cf. the "derivative_cache" option and GlobalOptions::setDerivativeCacheEntries
+     */
+    static void clear_derivative_cache();
+
     ///@{
     /** \brief Get symbolic primitives equivalent to the input expressions
      * There is no guarantee that subsequent calls return unique answers
@@ -947,10 +1045,10 @@ namespace casadi {
      */
     static std::string fix_name(const std::string& name);
 
-    /// Checkout a memory object
+    /// Checkout a memory object, thread-safe
     int checkout();
 
-    /// Release a memory object
+    /// Release a memory object, thread-safe
     void release(int mem);
 
     /// Create a solve node
@@ -960,6 +1058,17 @@ namespace casadi {
     /// Get memory object
     void* memory(int ind) const;
 
+    /** \brief Evaluate numerically, thread-safe
+     *
+     * A memory object is checked out from the pool for the duration of the call
+     * and work vectors are allocated locally, so several threads can evaluate
+     * the same Function concurrently, e.g. a server sharing one Function across
+     * a pool of workers. Requires the evaluation itself to be reentrant, which is
+     * the case for SX functions and MX functions built from them. Use the "mem_pool"
+     * option to allocate the memory objects up front.
+     */
+    void call_threadsafe(const double** arg, double** res) const;
+
     // Factorize linear system of equations
     void linsol_factorize(const double* A, int mem=0) const;
 
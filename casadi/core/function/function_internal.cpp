@@ -28,12 +28,23 @@
 #include "../std_vector_tools.hpp"
 #include "../global_options.hpp"
 #include "external.hpp"
+#include "sparsity_cache.hpp"
+#include "compressed_jacobian.hpp"
+#include "derivative_cache.hpp"
+#include "../casadi_trace.hpp"
+#include "../sparsity_internal.hpp"
+#include "../sx/constant_sx.hpp"
 
 #include <typeinfo>
 #include <cctype>
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif // WITH_OPENMP
 #ifdef WITH_DL
 #include <cstdlib>
+#include <cstdio>
 #include <ctime>
+#include <random>
 #endif // WITH_DL
 
 using namespace std;
@@ -54,12 +65,27 @@ namespace casadi {
     ad_weight_ = 0.33; // i.e. nf <= 2*na <=> 1/3*nf <= (1-1/3)*na, forward when tie
     // Both modes equally expensive by default (no "taping" needed)
     ad_weight_sp_ = 0.49; // Forward when tie
+    // Serial sparsity pattern calculation by default
+    n_threads_sp_ = 1;
+    compressed_jacobian_ = false;
+    enable_fd_ = false;
+    structural_hash_ = 0;
+    has_structural_hash_ = false;
     jac_penalty_ = 2;
     user_data_ = 0;
     regularity_check_ = false;
     inputs_check_ = true;
     gather_stats_ = false;
+    profile_ = false;
+    profile_n_call_ = 0;
+    profile_t_wall_ = 0;
+    derivative_cache_ = -1;
     jit_ = false;
+    jit_async_ = false;
+    jit_threshold_ = 0;
+    jit_pending_ = false;
+    jit_started_ = false;
+    jit_calls_ = 0;
     compilerplugin_ = "clang";
 
     eval_ = 0;
@@ -69,6 +95,12 @@ namespace casadi {
 
     has_refcount_ = false;
 
+    // Empty memory pool
+    mem_pool_ = 0;
+    for (int k=0; k<mem_max_block; ++k) mem_block_[k] = 0;
+    n_mem_alloc_ = 0;
+    unused_ = 0;
+
     sz_arg_tmp_ = 0;
     sz_res_tmp_ = 0;
     sz_iw_tmp_ = 0;
@@ -80,10 +112,12 @@ namespace casadi {
   }
 
   FunctionInternal::~FunctionInternal() {
-    for (auto&& i : mem_) {
-      casadi_assert_warning(i==0, "Memory object has not been properly freed");
+    // Derivatives kept alive on behalf of this function
+    DerivativeCache::release(this);
+    for (int i=0; i<n_mem_alloc_; ++i) {
+      casadi_assert_warning(mem_slot(i).mem==0, "Memory object has not been properly freed");
     }
-    mem_.clear();
+    for (int k=0; k<mem_max_block; ++k) delete[] mem_block_[k].load();
   }
 
   inline bool has_dot(const Dict& opts) {
@@ -213,6 +247,31 @@ namespace casadi {
         "Weighting factor for sparsity pattern calculation calculation."
         "Overrides default behavior. Set to 0 and 1 to force forward and "
         "reverse mode respectively. Cf. option \"ad_weight\"."}},
+      {"n_threads_sp",
+       {OT_INT,
+        "Number of threads used for propagating the seed blocks when calculating "
+        "Jacobian sparsity patterns. The default (1) means serial evaluation, 0 passes "
+        "the decision on to the parallelization library. Requires OpenMP and a function "
+        "whose sparsity propagation is reentrant."}},
+      {"compressed_jacobian",
+       {OT_BOOL,
+        "Evaluate Jacobians numerically, by evaluating all compressed directional "
+        "derivatives from the graph coloring and scattering the result, instead of "
+        "constructing a symbolic expression for the Jacobian. Cheaper to construct, "
+        "but typically more expensive to evaluate."}},
+      {"mem_pool",
+       {OT_INT,
+        "Number of memory objects to allocate up front, in addition to the one used "
+        "by ordinary calls, i.e. the number of threads that can evaluate the function "
+        "concurrently without allocating, cf. Function::call_threadsafe [0]"}},
+      {"enable_fd",
+       {OT_BOOL,
+        "Approximate Jacobians by colored finite differences when the function "
+        "provides no derivative information. Implied by 'fd_options'."}},
+      {"fd_options",
+       {OT_DICT,
+        "Options for the finite difference Jacobians used when the function "
+        "provides no derivative information: 'fd_method', 'fd_step', 'n_threads'"}},
       {"jac_penalty",
        {OT_DOUBLE,
         "When requested for a number of forward/reverse directions,   "
@@ -239,6 +298,17 @@ namespace casadi {
       {"gather_stats",
        {OT_BOOL,
         "Flag to indicate whether statistics must be gathered"}},
+      {"profile",
+       {OT_BOOL,
+        "Record the number of calls and the wall time of each operation during "
+        "numerical evaluation: per algorithm element for MXFunction, per operation "
+        "code for SXFunction. Cf. Function::profile_json and Function::profile_folded"}},
+      {"derivative_cache",
+       {OT_INT,
+        "Number of derivative functions (forward, reverse, Jacobian) kept alive by the "
+        "strong derivative cache, least recently used first out. "
+        "-1 (default): the global limit GlobalOptions::derivative_cache_entries applies, "
+        "0: disabled for this function"}},
       {"input_scheme",
        {OT_STRINGVECTOR,
         "Custom input scheme"}},
@@ -254,6 +324,14 @@ namespace casadi {
       {"jit_options",
        {OT_DICT,
         "Options to be passed to the jit compiler."}},
+      {"jit_async",
+       {OT_BOOL,
+        "Compile in a background thread and evaluate with the virtual machine until "
+        "the compiled code has been loaded [false]"}},
+      {"jit_threshold",
+       {OT_INT,
+        "Number of numerical evaluations before the just-in-time compilation is "
+        "started, so that only frequently called functions are compiled [0]"}},
       {"derivative_of",
        {OT_FUNCTION,
         "The function is a derivative of another function. "
@@ -269,6 +347,18 @@ namespace casadi {
         verbose_ = op.second;
       } else if (op.first=="jac_penalty") {
         jac_penalty_ = op.second;
+      } else if (op.first=="n_threads_sp") {
+        n_threads_sp_ = op.second;
+      } else if (op.first=="compressed_jacobian") {
+        compressed_jacobian_ = op.second;
+      } else if (op.first=="enable_fd") {
+        enable_fd_ = op.second;
+      } else if (op.first=="fd_options") {
+        fd_options_ = op.second;
+        enable_fd_ = true;
+      } else if (op.first=="mem_pool") {
+        mem_pool_ = op.second;
+        casadi_assert_message(mem_pool_>=0, "'mem_pool' must be nonnegative");
       } else if (op.first=="user_data") {
         user_data_ = op.second.to_void_pointer();
       } else if (op.first=="monitor") {
@@ -279,6 +369,10 @@ namespace casadi {
         inputs_check_ = op.second;
       } else if (op.first=="gather_stats") {
         gather_stats_ = op.second;
+      } else if (op.first=="profile") {
+        profile_ = op.second;
+      } else if (op.first=="derivative_cache") {
+        derivative_cache_ = op.second;
       } else if (op.first=="input_scheme") {
         ischeme_ = op.second;
       } else if (op.first=="output_scheme") {
@@ -289,11 +383,22 @@ namespace casadi {
         compilerplugin_ = op.second.to_string();
       } else if (op.first=="jit_options") {
         jit_options_ = op.second;
+      } else if (op.first=="jit_async") {
+        jit_async_ = op.second;
+      } else if (op.first=="jit_threshold") {
+        jit_threshold_ = op.second;
       } else if (op.first=="derivative_of") {
-        derivative_of_ = op.second;
+        // Weak reference, cached derivatives must not keep the original function alive
+        Function f = op.second;
+        derivative_of_ = f.is_null() ? WeakRef() : WeakRef(f);
       }
     }
 
+#ifndef WITH_OPENMP
+    casadi_assert_warning(n_threads_sp_==1, "CasADi was not compiled with OpenMP. "
+                          "Jacobian sparsity patterns will be calculated serially.");
+#endif // WITH_OPENMP
+
     // Get the number of inputs and outputs
     isp_.resize(get_n_in());
     osp_.resize(get_n_out());
@@ -319,6 +424,7 @@ namespace casadi {
     // Resize the matrix that holds the sparsity of the Jacobian blocks
     jac_sparsity_ = jac_sparsity_compact_ =
         SparseStorage<Sparsity>(Sparsity(n_out, n_in));
+    jac_sparsity_user_ = jac_sparsity_compact_user_ = jac_sparsity_;
     jac_ = jac_compact_ = SparseStorage<WeakRef>(Sparsity(n_out, n_in));
 
     // If input scheme empty, provide default names
@@ -347,8 +453,69 @@ namespace casadi {
     return "o" + CodeGenerator::to_string(i);
   }
 
-  void FunctionInternal::finalize() {
-    if (jit_) {
+  struct FunctionInternal::JitTask {
+    /// Generated source file, compiler plugin and options, owned by the task
+    std::string fname, plugin, symname;
+    Dict opts;
+
+    /// Result, only accessed by the evaluating threads once done is set
+    Compiler compiler;
+    eval_t eval;
+    simple_t simple;
+    std::string err;
+    std::atomic<bool> done;
+
+    JitTask() : eval(0), simple(0), done(false) {}
+
+    /// Compile and load, called by the executor
+    void run() {
+      try {
+        compiler = Compiler(fname, plugin, opts);
+        simple = (simple_t)compiler.get_function(symname + "_simple");
+        if (simple==0) eval = (eval_t)compiler.get_function(symname);
+        if (simple==0 && eval==0) err = "Cannot load JIT'ed function.";
+      } catch (exception& e) {
+        err = e.what();
+      }
+      remove(fname.c_str());
+      done = true;
+    }
+  };
+
+  /** \brief Copy options without sharing reference counted nodes,
+   * returns false if not possible, e.g. for Function options */
+  static bool jit_copy(const GenericType& in, GenericType& out) {
+    if (in.is_bool()) {
+      out = GenericType(in.to_bool());
+    } else if (in.is_int()) {
+      out = GenericType(in.to_int());
+    } else if (in.is_double()) {
+      out = GenericType(in.to_double());
+    } else if (in.is_string()) {
+      out = GenericType(string(in.to_string()));
+    } else if (in.is_int_vector()) {
+      out = GenericType(in.to_int_vector());
+    } else if (in.is_double_vector()) {
+      out = GenericType(in.to_double_vector());
+    } else if (in.is_string_vector()) {
+      out = GenericType(in.to_string_vector());
+    } else if (in.is_dict()) {
+      Dict d;
+      for (auto&& op : in.to_dict()) {
+        if (!jit_copy(op.second, d[op.first])) return false;
+      }
+      out = GenericType(d);
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  void FunctionInternal::jit_start() {
+    TraceScope trace(name_, "jit");
+
+    // Synchronous compilation
+    if (!jit_async_) {
       CodeGenerator gen;
       gen.add(function());
       gen.generate("jit_tmp.c");
@@ -361,15 +528,106 @@ namespace casadi {
         eval_ = (eval_t)compiler_.get_function(name());
         casadi_assert_message(eval_!=0, "Cannot load JIT'ed function.");
       }
+      jit_pending_ = false;
+      return;
+    }
+
+    // Options passed to the background thread may not share reference counted nodes
+    auto task = std::make_shared<JitTask>();
+    GenericType opts;
+    if (!jit_copy(jit_options_, opts)) {
+      casadi_warning("Function " + name_ + ": \"jit_options\" cannot be passed to a "
+                     "background thread, compiling synchronously");
+      jit_async_ = false;
+      return jit_start();
+    }
+    task->opts = opts;
+
+    // Generate code, with a unique file name since several functions may be compiled
+    // concurrently. The compiler plugin is loaded here, its registry is not thread-safe
+    static std::random_device rd;
+    stringstream ss;
+    ss << "jit_tmp_" << hex << rd() << rd();
+    task->fname = ss.str() + ".c";
+    task->plugin = compilerplugin_;
+    task->symname = name_;
+    CodeGenerator gen;
+    gen.add(function());
+    gen.generate(task->fname);
+    if (!Compiler::hasPlugin(compilerplugin_)) Compiler::loadPlugin(compilerplugin_);
+
+    // Compile in the background
+    jit_task_ = task;
+    AsyncExecutor::submit([task]() { task->run();}, 0);
+  }
+
+  void FunctionInternal::jit_poll() {
+    // Start the compilation once the function has become hot
+    if (!jit_started_) {
+      if (++jit_calls_ < jit_threshold_) return;
+      lock_guard<mutex> lock(jit_mtx_);
+      if (!jit_started_) {
+        // A failure must not abort the evaluation, cf. the asynchronous case below
+        try {
+          jit_start();
+        } catch (exception& e) {
+          casadi_warning("Function " + name_ + ": Just-in-time compilation failed, "
+                         "continuing without. " + e.what());
+          jit_pending_ = false;
+        }
+        jit_started_ = true;
+      }
+      return;
+    }
+
+    // Switch to the compiled code once loaded
+    if (!jit_task_ || !jit_task_->done) return;
+    lock_guard<mutex> lock(jit_mtx_);
+    if (!jit_pending_) return;
+    if (jit_task_->err.empty()) {
+      compiler_ = jit_task_->compiler;
+      if (jit_task_->simple) {
+        simple_ = jit_task_->simple;
+      } else {
+        eval_ = jit_task_->eval;
+      }
+    } else {
+      casadi_warning("Function " + name_ + ": Just-in-time compilation failed, "
+                     "continuing without. " + jit_task_->err);
+    }
+    jit_task_->compiler = Compiler();
+    jit_pending_ = false;
+  }
+
+  void FunctionInternal::finalize() {
+    if (jit_) {
+      if (jit_async_ || jit_threshold_>0) {
+        // Deferred, cf. jit_poll
+        jit_pending_ = true;
+        if (jit_threshold_<=0) {
+          jit_start();
+          jit_started_ = true;
+        }
+      } else {
+        jit_start();
+      }
     }
 
     // Create memory object
     int mem = checkout();
     casadi_assert(mem==0);
+
+    // Preallocate the memory pool, checked out in reverse order of use
+    int n_mem = this->n_mem();
+    int n_pool = n_mem==0 ? 1+mem_pool_ : std::min(1+mem_pool_, n_mem);
+    for (int i=1; i<n_pool; ++i) checkout();
+    for (int i=n_pool-1; i>=1; --i) release(i);
   }
 
   void FunctionInternal::
   _eval(const double** arg, double** res, int* iw, double* w, int mem) {
+    TraceScope trace(name_, "function");
+    if (jit_pending_) jit_poll();
     if (simplifiedCall()) {
       // Copy arguments to input buffers
       const double* arg1=w;
@@ -378,8 +636,9 @@ namespace casadi {
       }
 
       // Evaluate
-      if (simple_) {
-        simple_(arg1, w);
+      simple_t simple_fcn = simple_;
+      if (simple_fcn) {
+        simple_fcn(arg1, w);
       } else {
         simple(arg1, w);
       }
@@ -390,8 +649,9 @@ namespace casadi {
         ++w;
       }
     } else {
-      if (eval_) {
-        eval_(arg, res, iw, w, mem);
+      eval_t eval_fcn = eval_;
+      if (eval_fcn) {
+        eval_fcn(arg, res, iw, w, mem);
       } else {
         eval(memory(mem), arg, res, iw, w);
       }
@@ -465,6 +725,8 @@ namespace casadi {
                  {"jit", jit_},
                  {"compiler", compilerplugin_},
                  {"jit_options", jit_options_},
+                 {"jit_async", jit_async_},
+                 {"jit_threshold", jit_threshold_},
                  {"derivative_of", function()}};
     return getGradient(ss.str(), iind, oind, opts);
   }
@@ -492,6 +754,8 @@ namespace casadi {
                  {"jit", jit_},
                  {"compiler", compilerplugin_},
                  {"jit_options", jit_options_},
+                 {"jit_async", jit_async_},
+                 {"jit_threshold", jit_threshold_},
                  {"derivative_of", function()}};
     return getTangent(ss.str(), iind, oind, opts);
   }
@@ -531,14 +795,17 @@ namespace casadi {
     // Propagate AD parameters
     opts["ad_weight"] = adWeight();
     opts["ad_weight_sp"] = adWeightSp();
+    opts["n_threads_sp"] = n_threads_sp_;
 
     // Propagate information about AD
-    opts["derivative_of"] = derivative_of_;
+    opts["derivative_of"] = derivative_of();
 
     // Propagate JIT
     opts["jit"] = jit_;
     opts["compiler"] = compilerplugin_;
     opts["jit_options"] = jit_options_;
+    opts["jit_async"] = jit_async_;
+    opts["jit_threshold"] = jit_threshold_;
 
     // Wrap the function
     vector<MX> arg = mx_in();
@@ -601,23 +868,77 @@ namespace casadi {
     r = 0;
     for (int i=begin; i<end; ++i) r |= s[i];
   }
+
+  /// Evaluation buffers for one thread propagating sparsity patterns
+  struct SpBuffers {
+    SpBuffers(FunctionInternal* f, int iind, int oind)
+      : s_in(f->nnz_in(iind), 0), s_out(f->nnz_out(oind), 0),
+        arg_fwd(f->sz_arg(), 0), arg_adj(f->sz_arg(), 0), res(f->sz_res(), 0),
+        iw(f->sz_iw()), w(f->sz_w(), 0) {
+      arg_fwd[iind] = arg_adj[iind] = get_ptr(s_in);
+      res[oind] = get_ptr(s_out);
+    }
+    // Seeds and sensitivities
+    std::vector<bvec_t> s_in, s_out;
+    // Work vectors
+    std::vector<const bvec_t*> arg_fwd;
+    std::vector<bvec_t*> arg_adj, res;
+    std::vector<int> iw;
+    std::vector<bvec_t> w;
+  };
+
+  /** \brief Call f(i, buf) for i in [0, n), sweeps distributed over n_threads threads
+   * The first sweep is always carried out serially, which makes sure that
+   * lazily generated data (such as the Jacobian sparsity patterns of embedded
+   * functions) is in place before any thread is started.
+   */
+  template<typename F>
+  void sp_sweeps(FunctionInternal* f, int iind, int oind, int n, int n_threads, F sweep) {
+    SpBuffers buf(f, iind, oind);
+    if (n==0) return;
+    sweep(0, buf);
+#ifdef WITH_OPENMP
+    if (n_threads==0) n_threads = omp_get_max_threads();
+    n_threads = std::min(n_threads, n-1);
+    if (n_threads>1) {
+      // Thread-local buffers, allocated up front
+      std::vector<SpBuffers> thread_buf;
+      thread_buf.reserve(n_threads);
+      for (int t=0; t<n_threads; ++t) thread_buf.emplace_back(f, iind, oind);
+      // Exceptions may not propagate out of an OpenMP block
+      std::string err;
+#pragma omp parallel for num_threads(n_threads) schedule(dynamic)
+      for (int i=1; i<n; ++i) {
+        try {
+          sweep(i, thread_buf[omp_get_thread_num()]);
+        } catch (std::exception& e) {
+#pragma omp critical(sp_sweeps_error)
+          if (err.empty()) err = e.what();
+        }
+      }
+      casadi_assert_message(err.empty(), err);
+      return;
+    }
+#endif // WITH_OPENMP
+    for (int i=1; i<n; ++i) sweep(i, buf);
+  }
   /// \endcond
 
   // Traits
   template<bool fwd> struct JacSparsityTraits {};
   template<> struct JacSparsityTraits<true> {
-    typedef const bvec_t* arg_t;
-    static inline void sp(FunctionInternal *f, const bvec_t** arg, bvec_t** res,
-                          int* iw, bvec_t* w, int mem) {
-      f->spFwd(arg, res, iw, w, mem);
+    static inline void sp(FunctionInternal *f, SpBuffers& b) {
+      f->spFwd(get_ptr(b.arg_fwd), get_ptr(b.res), get_ptr(b.iw), get_ptr(b.w), 0);
     }
+    static inline std::vector<bvec_t>& seed(SpBuffers& b) { return b.s_in;}
+    static inline std::vector<bvec_t>& sens(SpBuffers& b) { return b.s_out;}
   };
   template<> struct JacSparsityTraits<false> {
-    typedef bvec_t* arg_t;
-    static inline void sp(FunctionInternal *f, bvec_t** arg, bvec_t** res,
-                          int* iw, bvec_t* w, int mem) {
-      f->spAdj(arg, res, iw, w, mem);
+    static inline void sp(FunctionInternal *f, SpBuffers& b) {
+      f->spAdj(get_ptr(b.arg_adj), get_ptr(b.res), get_ptr(b.iw), get_ptr(b.w), 0);
     }
+    static inline std::vector<bvec_t>& seed(SpBuffers& b) { return b.s_out;}
+    static inline std::vector<bvec_t>& sens(SpBuffers& b) { return b.s_in;}
   };
 
   template<bool fwd>
@@ -627,40 +948,33 @@ namespace casadi {
     int nz_in = nnz_in(iind);
     int nz_out = nnz_out(oind);
 
-    // Evaluation buffers
-    vector<typename JacSparsityTraits<fwd>::arg_t> arg(sz_arg(), 0);
-    vector<bvec_t*> res(sz_res(), 0);
-    vector<int> iw(sz_iw());
-    vector<bvec_t> w(sz_w(), 0);
-
-    // Seeds and sensitivities
-    vector<bvec_t> seed(nz_in, 0);
-    arg[iind] = get_ptr(seed);
-    vector<bvec_t> sens(nz_out, 0);
-    res[oind] = get_ptr(sens);
-    if (!fwd) std::swap(seed, sens);
+    // Number of seed directions and sensitivities
+    int nz_seed = fwd ? nz_in : nz_out;
+    int nz_sens = fwd ? nz_out : nz_in;
 
     // Number of forward sweeps we must make
-    int nsweep = seed.size() / bvec_size;
-    if (seed.size() % bvec_size) nsweep++;
+    int nsweep = nz_seed / bvec_size;
+    if (nz_seed % bvec_size) nsweep++;
 
     // Print
     if (verbose()) {
       userOut() << "FunctionInternal::getJacSparsityGen<" << fwd << ">: "
-                << nsweep << " sweeps needed for " << seed.size() << " directions" << endl;
+                << nsweep << " sweeps needed for " << nz_seed << " directions" << endl;
     }
 
     // Progress
     int progress = -10;
 
-    // Temporary vectors
-    std::vector<int> jcol, jrow;
+    // Triplets for each sweep, assembled in order
+    std::vector<std::vector<int> > jcol(nsweep), jrow(nsweep);
 
     // Loop over the variables, bvec_size variables at a time
-    for (int s=0; s<nsweep; ++s) {
+    sp_sweeps(this, iind, oind, nsweep, n_threads_sp_, [&](int s, SpBuffers& buf) {
+      std::vector<bvec_t>& seed = JacSparsityTraits<fwd>::seed(buf);
+      std::vector<bvec_t>& sens = JacSparsityTraits<fwd>::sens(buf);
 
       // Print progress
-      if (verbose()) {
+      if (verbose() && n_threads_sp_==1) {
         int progress_new = (s*100)/nsweep;
         // Print when entering a new decade
         if (progress_new / 10 > progress / 10) {
@@ -673,7 +987,7 @@ namespace casadi {
       int offset = s*bvec_size;
 
       // Number of local seed directions
-      int ndir_local = seed.size()-offset;
+      int ndir_local = nz_seed-offset;
       ndir_local = std::min(bvec_size, ndir_local);
 
       for (int i=0; i<ndir_local; ++i) {
@@ -681,10 +995,10 @@ namespace casadi {
       }
 
       // Propagate the dependencies
-      JacSparsityTraits<fwd>::sp(this, get_ptr(arg), get_ptr(res), get_ptr(iw), get_ptr(w), 0);
+      JacSparsityTraits<fwd>::sp(this, buf);
 
       // Loop over the nonzeros of the output
-      for (int el=0; el<sens.size(); ++el) {
+      for (int el=0; el<nz_sens; ++el) {
 
         // Get the sparsity sensitivity
         bvec_t spsens = sens[el];
@@ -703,8 +1017,8 @@ namespace casadi {
             // If dependents on the variable
             if ((bvec_t(1) << i) & spsens) {
               // Add to pattern
-              jcol.push_back(el);
-              jrow.push_back(i+offset);
+              jcol[s].push_back(el);
+              jrow[s].push_back(i+offset);
             }
           }
         }
@@ -714,17 +1028,32 @@ namespace casadi {
       for (int i=0; i<ndir_local; ++i) {
         seed[offset+i] = 0;
       }
-    }
+    });
 
     // Construct sparsity pattern and return
-    if (!fwd) swap(jrow, jcol);
-    Sparsity ret = Sparsity::triplet(nz_out, nz_in, jcol, jrow);
+    std::vector<int> jcol_all, jrow_all;
+    for (int s=0; s<nsweep; ++s) {
+      jcol_all.insert(jcol_all.end(), jcol[s].begin(), jcol[s].end());
+      jrow_all.insert(jrow_all.end(), jrow[s].begin(), jrow[s].end());
+    }
+    if (!fwd) swap(jrow_all, jcol_all);
+    Sparsity ret = Sparsity::triplet(nz_out, nz_in, jcol_all, jrow_all);
     casadi_msg("Formed Jacobian sparsity pattern (dimension " << ret.size() << ", "
                << ret.nnz() << " nonzeros, " << (100.0*ret.nnz())/ret.numel() << " % nonzeros).");
     casadi_msg("FunctionInternal::getJacSparsity end ");
     return ret;
   }
 
+  /// \cond INTERNAL
+  /// Seeds and lookup table for one sweep of the hierarchical sparsity algorithms
+  struct SpBatch {
+    // Lookup table
+    IM lookup;
+    // Seeds to toggle on, (begin, end, bit) triplets
+    std::vector<int> toggle;
+  };
+  /// \endcond
+
   Sparsity FunctionInternal::getJacSparsityHierarchicalSymm(int iind, int oind) {
     casadi_assert(spCanEvaluate(true));
 
@@ -732,20 +1061,6 @@ namespace casadi {
     int nz = nnz_in(iind);
     casadi_assert(nz==nnz_out(oind));
 
-    // Evaluation buffers
-    vector<const bvec_t*> arg(sz_arg(), 0);
-    vector<bvec_t*> res(sz_res(), 0);
-    vector<int> iw(sz_iw());
-    vector<bvec_t> w(sz_w());
-
-    // Seeds
-    vector<bvec_t> seed(nz, 0);
-    arg[iind] = get_ptr(seed);
-
-    // Sensitivities
-    vector<bvec_t> sens(nz, 0);
-    res[oind] = get_ptr(sens);
-
     // Sparsity triplet accumulator
     std::vector<int> jcol, jrow;
 
@@ -767,6 +1082,9 @@ namespace casadi {
 
     bool hasrun = false;
 
+    // Seeds and lookup tables for the sweeps of one refinement
+    std::vector<SpBatch> batches;
+
     while (!hasrun || coarse.size()!=nz+1) {
       casadi_msg("Block size: " << granularity);
 
@@ -781,9 +1099,6 @@ namespace casadi {
 
       casadi_msg("Star coloring on " << r.dim() << ": " << D.size2() << " <-> " << D.size1());
 
-      // Clear the seeds
-      fill(seed.begin(), seed.end(), 0);
-
       // Subdivide the coarse block
       for (int k=0; k<coarse.size()-1; ++k) {
         int diff = coarse[k+1]-coarse[k];
@@ -807,6 +1122,9 @@ namespace casadi {
       std::vector<int> lookup_row;
       std::vector<int> lookup_value;
 
+      // Seeds to be toggled on
+      std::vector<int> toggle;
+
       // Loop over all coarse seed directions from the coloring
       for (int csd=0; csd<D.size2(); ++csd) {
         // The maximum number of fine blocks contained in one coarse block
@@ -848,8 +1166,9 @@ namespace casadi {
               }
 
               // Toggle on seeds
-              bvec_toggle(get_ptr(seed), fine[fci+fci_start], fine[fci+fci_start+1],
-                          bvec_i+bvec_i_mod);
+              toggle.push_back(fine[fci+fci_start]);
+              toggle.push_back(fine[fci+fci_start+1]);
+              toggle.push_back(bvec_i+bvec_i_mod);
               bvec_i_mod++;
             }
           }
@@ -858,59 +1177,26 @@ namespace casadi {
           bvec_i+= min(n_fine_blocks_max, fci_cap);
 
           // Check if bvec buffer is full
-          if (bvec_i==bvec_size || csd==D.size2()-1) {
-            // Calculate sparsity for bvec_size directions at once
-
-            // Statistics
-            nsweeps+=1;
+          if ((bvec_i==bvec_size || csd==D.size2()-1) && !toggle.empty()) {
+            // Sparsity for bvec_size directions at once, calculated below
+            batches.push_back(SpBatch());
+            SpBatch& b = batches.back();
 
             // Construct lookup table
-            IM lookup = IM::triplet(lookup_row, lookup_col, lookup_value,
-                                    bvec_size, coarse.size());
+            b.lookup = IM::triplet(lookup_row, lookup_col, lookup_value,
+                                   bvec_size, coarse.size());
 
             std::reverse(lookup_col.begin(), lookup_col.end());
             std::reverse(lookup_row.begin(), lookup_row.end());
             std::reverse(lookup_value.begin(), lookup_value.end());
             IM duplicates =
               IM::triplet(lookup_row, lookup_col, lookup_value, bvec_size, coarse.size())
-              - lookup;
+              - b.lookup;
             duplicates = sparsify(duplicates);
-            lookup(duplicates.sparsity()) = -bvec_size;
-
-            // Propagate the dependencies
-            spFwd(get_ptr(arg), get_ptr(res), get_ptr(iw), get_ptr(w), 0);
-
-            // Temporary bit work vector
-            bvec_t spsens;
-
-            // Loop over the cols of coarse blocks
-            for (int cri=0; cri<coarse.size()-1; ++cri) {
-
-              // Loop over the cols of fine blocks within the current coarse block
-              for (int fri=fine_lookup[coarse[cri]];fri<fine_lookup[coarse[cri+1]];++fri) {
-                // Lump individual sensitivities together into fine block
-                bvec_or(get_ptr(sens), spsens, fine[fri], fine[fri+1]);
-
-                // Loop over all bvec_bits
-                for (int bvec_i=0;bvec_i<bvec_size;++bvec_i) {
-                  if (spsens & (bvec_t(1) << bvec_i)) {
-                    // if dependency is found, add it to the new sparsity pattern
-                    int ind = lookup.sparsity().get_nz(bvec_i, cri);
-                    if (ind==-1) continue;
-                    int lk = lookup->at(ind);
-                    if (lk>-bvec_size) {
-                      jrow.push_back(bvec_i+lk);
-                      jcol.push_back(fri);
-                      jrow.push_back(fri);
-                      jcol.push_back(bvec_i+lk);
-                    }
-                  }
-                }
-              }
-            }
+            b.lookup(duplicates.sparsity()) = -bvec_size;
 
-            // Clear the forward seeds/adjoint sensitivities, ready for next bvec sweep
-            fill(seed.begin(), seed.end(), 0);
+            // Seeds for the sweep
+            b.toggle.swap(toggle);
 
             // Clean lookup table
             lookup_col.clear();
@@ -928,6 +1214,65 @@ namespace casadi {
         }
       }
 
+      // Triplets for each sweep, assembled in order
+      std::vector<std::vector<int> > jcol_b(batches.size()), jrow_b(batches.size());
+
+      // Propagate the sweeps
+      sp_sweeps(this, iind, oind, batches.size(), n_threads_sp_, [&](int b, SpBuffers& buf) {
+        const IM& lookup = batches[b].lookup;
+        const std::vector<int>& toggle = batches[b].toggle;
+
+        // Toggle on seeds
+        for (int i=0; i<toggle.size(); i+=3) {
+          bvec_toggle(get_ptr(buf.s_in), toggle[i], toggle[i+1], toggle[i+2]);
+        }
+
+        // Propagate the dependencies
+        spFwd(get_ptr(buf.arg_fwd), get_ptr(buf.res), get_ptr(buf.iw), get_ptr(buf.w), 0);
+
+        // Temporary bit work vector
+        bvec_t spsens;
+
+        // Loop over the cols of coarse blocks
+        for (int cri=0; cri<coarse.size()-1; ++cri) {
+
+          // Loop over the cols of fine blocks within the current coarse block
+          for (int fri=fine_lookup[coarse[cri]];fri<fine_lookup[coarse[cri+1]];++fri) {
+            // Lump individual sensitivities together into fine block
+            bvec_or(get_ptr(buf.s_out), spsens, fine[fri], fine[fri+1]);
+
+            // Loop over all bvec_bits
+            for (int bvec_i=0;bvec_i<bvec_size;++bvec_i) {
+              if (spsens & (bvec_t(1) << bvec_i)) {
+                // if dependency is found, add it to the new sparsity pattern
+                int ind = lookup.sparsity().get_nz(bvec_i, cri);
+                if (ind==-1) continue;
+                int lk = lookup.nonzeros()[ind];
+                if (lk>-bvec_size) {
+                  jrow_b[b].push_back(bvec_i+lk);
+                  jcol_b[b].push_back(fri);
+                  jrow_b[b].push_back(fri);
+                  jcol_b[b].push_back(bvec_i+lk);
+                }
+              }
+            }
+          }
+        }
+
+        // Clear the forward seeds, ready for next bvec sweep
+        fill(buf.s_in.begin(), buf.s_in.end(), 0);
+      });
+
+      // Statistics
+      nsweeps += batches.size();
+
+      // Collect the triplets
+      for (int b=0; b<batches.size(); ++b) {
+        jcol.insert(jcol.end(), jcol_b[b].begin(), jcol_b[b].end());
+        jrow.insert(jrow.end(), jrow_b[b].begin(), jrow_b[b].end());
+      }
+      batches.clear();
+
       // Construct fine sparsity pattern
       r = Sparsity::triplet(fine.size()-1, fine.size()-1, jrow, jcol);
 
@@ -955,19 +1300,6 @@ namespace casadi {
     // Number of nonzero outputs
     int nz_out = nnz_out(oind);
 
-    // Seeds and sensitivities
-    vector<bvec_t> s_in(nz_in, 0);
-    vector<bvec_t> s_out(nz_out, 0);
-
-    // Evaluation buffers
-    vector<const bvec_t*> arg_fwd(sz_arg(), 0);
-    vector<bvec_t*> arg_adj(sz_arg(), 0);
-    arg_fwd[iind] = arg_adj[iind] = get_ptr(s_in);
-    vector<bvec_t*> res(sz_res(), 0);
-    res[oind] = get_ptr(s_out);
-    vector<int> iw(sz_iw());
-    vector<bvec_t> w(sz_w());
-
     // Sparsity triplet accumulator
     std::vector<int> jcol, jrow;
 
@@ -1007,6 +1339,9 @@ namespace casadi {
       bvec_lookup.push_back(bvec_t(1) << i);
     }
 
+    // Seeds and lookup tables for the sweeps of one refinement
+    std::vector<SpBatch> batches;
+
     while (!hasrun || coarse_col.size()!=nz_out+1 || coarse_row.size()!=nz_in+1) {
       casadi_msg("Block size: " << granularity_col << " x " << granularity_row);
 
@@ -1046,17 +1381,10 @@ namespace casadi {
                    << (1-sp_w)*D2.size2()*adj_cost << ")");
       }
 
-      // Get seeds and sensitivities
-      bvec_t* seed_v = use_fwd ? get_ptr(s_in) : get_ptr(s_out);
-      bvec_t* sens_v = use_fwd ? get_ptr(s_out) : get_ptr(s_in);
-
       // The number of zeros in the seed and sensitivity directions
       int nz_seed = use_fwd ? nz_in  : nz_out;
       int nz_sens = use_fwd ? nz_out : nz_in;
 
-      // Clear the seeds
-      for (int i=0; i<nz_seed; ++i) seed_v[i]=0;
-
       // Choose the active jacobian coloring scheme
       Sparsity D = use_fwd ? D1 : D2;
 
@@ -1101,6 +1429,9 @@ namespace casadi {
       std::vector<int> lookup_row;
       std::vector<int> lookup_value;
 
+      // Seeds to be toggled on
+      std::vector<int> toggle;
+
       // Loop over all coarse seed directions from the coloring
       for (int csd=0; csd<D.size2(); ++csd) {
 
@@ -1141,8 +1472,9 @@ namespace casadi {
               }
 
               // Toggle on seeds
-              bvec_toggle(seed_v, fine_row[fci+fci_start], fine_row[fci+fci_start+1],
-                          bvec_i+bvec_i_mod);
+              toggle.push_back(fine_row[fci+fci_start]);
+              toggle.push_back(fine_row[fci+fci_start+1]);
+              toggle.push_back(bvec_i+bvec_i_mod);
               bvec_i_mod++;
             }
           }
@@ -1151,57 +1483,17 @@ namespace casadi {
           bvec_i+= min(n_fine_blocks_max, fci_cap);
 
           // Check if bvec buffer is full
-          if (bvec_i==bvec_size || csd==D.size2()-1) {
-            // Calculate sparsity for bvec_size directions at once
-
-            // Statistics
-            nsweeps+=1;
+          if ((bvec_i==bvec_size || csd==D.size2()-1) && !toggle.empty()) {
+            // Sparsity for bvec_size directions at once, calculated below
+            batches.push_back(SpBatch());
+            SpBatch& b = batches.back();
 
             // Construct lookup table
-            IM lookup = IM::triplet(lookup_row, lookup_col, lookup_value, bvec_size,
-                                    coarse_col.size());
-
-            // Propagate the dependencies
-            if (use_fwd) {
-              spFwd(get_ptr(arg_fwd), get_ptr(res), get_ptr(iw), get_ptr(w), 0);
-            } else {
-              fill(w.begin(), w.end(), 0);
-              spAdj(get_ptr(arg_adj), get_ptr(res), get_ptr(iw), get_ptr(w), 0);
-            }
+            b.lookup = IM::triplet(lookup_row, lookup_col, lookup_value, bvec_size,
+                                   coarse_col.size());
 
-            // Temporary bit work vector
-            bvec_t spsens;
-
-            // Loop over the cols of coarse blocks
-            for (int cri=0;cri<coarse_col.size()-1;++cri) {
-
-              // Loop over the cols of fine blocks within the current coarse block
-              for (int fri=fine_col_lookup[coarse_col[cri]];
-                   fri<fine_col_lookup[coarse_col[cri+1]];++fri) {
-                // Lump individual sensitivities together into fine block
-                bvec_or(sens_v, spsens, fine_col[fri], fine_col[fri+1]);
-
-                // Next iteration if no sparsity
-                if (!spsens) continue;
-
-                // Loop over all bvec_bits
-                for (int bvec_i=0;bvec_i<bvec_size;++bvec_i) {
-                  if (spsens & bvec_lookup[bvec_i]) {
-                    // if dependency is found, add it to the new sparsity pattern
-                    int ind = lookup.sparsity().get_nz(bvec_i, cri);
-                    if (ind==-1) continue;
-                    jrow.push_back(bvec_i+lookup->at(ind));
-                    jcol.push_back(fri);
-                  }
-                }
-              }
-            }
-
-            // Clear the forward seeds/adjoint sensitivities, ready for next bvec sweep
-            fill(s_in.begin(), s_in.end(), 0);
-
-            // Clear the adjoint seeds/forward sensitivities, ready for next bvec sweep
-            fill(s_out.begin(), s_out.end(), 0);
+            // Seeds for the sweep
+            b.toggle.swap(toggle);
 
             // Clean lookup table
             lookup_col.clear();
@@ -1221,6 +1513,76 @@ namespace casadi {
 
       }
 
+      // Triplets for each sweep, assembled in order
+      std::vector<std::vector<int> > jcol_b(batches.size()), jrow_b(batches.size());
+
+      // Propagate the sweeps
+      sp_sweeps(this, iind, oind, batches.size(), n_threads_sp_, [&](int b, SpBuffers& buf) {
+        const IM& lookup = batches[b].lookup;
+        const std::vector<int>& toggle = batches[b].toggle;
+
+        // Get seeds and sensitivities
+        bvec_t* seed_v = use_fwd ? get_ptr(buf.s_in) : get_ptr(buf.s_out);
+        bvec_t* sens_v = use_fwd ? get_ptr(buf.s_out) : get_ptr(buf.s_in);
+
+        // Toggle on seeds
+        for (int i=0; i<toggle.size(); i+=3) {
+          bvec_toggle(seed_v, toggle[i], toggle[i+1], toggle[i+2]);
+        }
+
+        // Propagate the dependencies
+        if (use_fwd) {
+          spFwd(get_ptr(buf.arg_fwd), get_ptr(buf.res), get_ptr(buf.iw), get_ptr(buf.w), 0);
+        } else {
+          fill(buf.w.begin(), buf.w.end(), 0);
+          spAdj(get_ptr(buf.arg_adj), get_ptr(buf.res), get_ptr(buf.iw), get_ptr(buf.w), 0);
+        }
+
+        // Temporary bit work vector
+        bvec_t spsens;
+
+        // Loop over the cols of coarse blocks
+        for (int cri=0;cri<coarse_col.size()-1;++cri) {
+
+          // Loop over the cols of fine blocks within the current coarse block
+          for (int fri=fine_col_lookup[coarse_col[cri]];
+               fri<fine_col_lookup[coarse_col[cri+1]];++fri) {
+            // Lump individual sensitivities together into fine block
+            bvec_or(sens_v, spsens, fine_col[fri], fine_col[fri+1]);
+
+            // Next iteration if no sparsity
+            if (!spsens) continue;
+
+            // Loop over all bvec_bits
+            for (int bvec_i=0;bvec_i<bvec_size;++bvec_i) {
+              if (spsens & bvec_lookup[bvec_i]) {
+                // if dependency is found, add it to the new sparsity pattern
+                int ind = lookup.sparsity().get_nz(bvec_i, cri);
+                if (ind==-1) continue;
+                jrow_b[b].push_back(bvec_i+lookup.nonzeros()[ind]);
+                jcol_b[b].push_back(fri);
+              }
+            }
+          }
+        }
+
+        // Clear the forward seeds/adjoint sensitivities, ready for next bvec sweep
+        fill(buf.s_in.begin(), buf.s_in.end(), 0);
+
+        // Clear the adjoint seeds/forward sensitivities, ready for next bvec sweep
+        fill(buf.s_out.begin(), buf.s_out.end(), 0);
+      });
+
+      // Statistics
+      nsweeps += batches.size();
+
+      // Collect the triplets
+      for (int b=0; b<batches.size(); ++b) {
+        jcol.insert(jcol.end(), jcol_b[b].begin(), jcol_b[b].end());
+        jrow.insert(jrow.end(), jrow_b[b].begin(), jrow_b[b].end());
+      }
+      batches.clear();
+
       // Swap results if adjoint mode was used
       if (use_fwd) {
         // Construct fine sparsity pattern
@@ -1291,16 +1653,47 @@ namespace casadi {
   void FunctionInternal::set_jac_sparsity(const Sparsity& sp, int iind, int oind, bool compact) {
     if (compact) {
       jac_sparsity_compact_.elem(oind, iind) = sp;
+      jac_sparsity_compact_user_.elem(oind, iind) = sp;
     } else {
       jac_sparsity_.elem(oind, iind) = sp;
+      jac_sparsity_user_.elem(oind, iind) = sp;
+
+      // Keep the compact pattern consistent
+      Sparsity sp_compact = sp;
+      if (numel_out(oind)!=nnz_out(oind) || numel_in(iind)!=nnz_in(iind)) {
+        vector<int> mapping;
+        sp_compact = sp.sub(sparsity_out(oind).find(), sparsity_in(iind).find(), mapping);
+      }
+      jac_sparsity_compact_.elem(oind, iind) = sp_compact;
+      jac_sparsity_compact_user_.elem(oind, iind) = sp_compact;
     }
   }
 
   Sparsity& FunctionInternal::sparsity_jac(int iind, int oind, bool compact, bool symmetric) {
+    // Quick return if already calculated, without touching any reference counters
+    SparseStorage<Sparsity>& jsp_cache = compact ? jac_sparsity_compact_ : jac_sparsity_;
+    int jsp_ind = jsp_cache.sparsity().get_nz(oind, iind);
+    if (jsp_ind>=0 && !jsp_cache.nonzeros()[jsp_ind].is_null()) {
+      return jsp_cache.nonzeros()[jsp_ind];
+    }
+
     // Get an owning reference to the block
     Sparsity jsp = compact ? jac_sparsity_compact_.elem(oind, iind)
         : jac_sparsity_.elem(oind, iind);
 
+    // Try the persistent cache
+    size_t cache_key = 0;
+    vector<int> cache_fp;
+    if (jsp.is_null()) {
+      cache_key = sparsity_cache_key("jac_sparsity", iind, oind, compact, symmetric, cache_fp);
+      vector<Sparsity> cached;
+      if (cache_key!=0 && SparsityCache::load(cache_key, cache_fp, cached)
+          && cached.size()==1) {
+        jsp = cached[0];
+        cache_key = 0;
+      }
+    }
+
     // Generate, if null
     if (jsp.is_null()) {
       if (compact) {
@@ -1338,6 +1731,9 @@ namespace casadi {
         // Save
         jsp = sp;
       }
+
+      // Save to the persistent cache
+      if (cache_key!=0) SparsityCache::store(cache_key, cache_fp, {jsp});
     }
 
     // If still null, not dependent
@@ -1352,10 +1748,82 @@ namespace casadi {
     return jsp_ref;
   }
 
+  size_t FunctionInternal::structural_hash() {
+    if (!has_structural_hash_) {
+      size_t h = get_structural_hash();
+      if (h!=0) {
+        // Combine with the type and the input and output sparsities
+        for (char c : type_name()) hash_combine(h, c);
+        for (int i=0; i<n_in(); ++i) hash_combine(h, sparsity_in(i).hash());
+        for (int i=0; i<n_out(); ++i) hash_combine(h, sparsity_out(i).hash());
+      }
+      structural_hash_ = h;
+      has_structural_hash_ = true;
+    }
+    return structural_hash_;
+  }
+
+  bool FunctionInternal::structural_fingerprint(std::vector<int>& fp) const {
+    if (!get_structural_fingerprint(fp)) return false;
+    // Type and the input and output sparsities, cf. structural_hash
+    string t = type_name();
+    fp.push_back(t.size());
+    fp.insert(fp.end(), t.begin(), t.end());
+    for (int i=0; i<n_in(); ++i) {
+      vector<int> c = sparsity_in(i).compress();
+      fp.insert(fp.end(), c.begin(), c.end());
+    }
+    for (int i=0; i<n_out(); ++i) {
+      vector<int> c = sparsity_out(i).compress();
+      fp.insert(fp.end(), c.begin(), c.end());
+    }
+    return true;
+  }
+
+  size_t FunctionInternal::sparsity_cache_key(const std::string& kind, int iind, int oind,
+                                              bool compact, bool symmetric,
+                                              std::vector<int>& fingerprint) {
+    if (!SparsityCache::enabled()) return 0;
+    size_t sh = structural_hash();
+    if (sh==0) return 0;
+
+    // Everything the key is computed from, verified when loading. The instruction
+    // stream is stored in full, so that a hash collision cannot return a wrong pattern
+    fingerprint.clear();
+    for (char c : kind) fingerprint.push_back(c);
+    fingerprint.push_back(iind);
+    fingerprint.push_back(oind);
+    fingerprint.push_back(compact);
+    fingerprint.push_back(symmetric);
+    // The patterns depend on the choice of algorithm
+    double w = kind=="partition" ? adWeight() : adWeightSp();
+    fingerprint.push_back(static_cast<int>(1000*w));
+    fingerprint.push_back(GlobalOptions::hierarchical_sparsity);
+    // Algorithm and input and output sparsity patterns
+    if (!structural_fingerprint(fingerprint)) return 0;
+
+    size_t h = 0;
+    hash_combine(h, fingerprint);
+    return h==0 ? 1 : h;
+  }
+
   void FunctionInternal::getPartition(int iind, int oind, Sparsity& D1, Sparsity& D2,
                                       bool compact, bool symmetric) {
     log("FunctionInternal::getPartition begin");
 
+    // Try the persistent cache
+    vector<int> cache_fp;
+    size_t cache_key = sparsity_cache_key("partition", iind, oind, compact, symmetric,
+                                          cache_fp);
+    vector<Sparsity> cached;
+    if (cache_key!=0 && SparsityCache::load(cache_key, cache_fp, cached)
+        && cached.size()==2) {
+      D1 = cached[0];
+      D2 = cached[1];
+      log("FunctionInternal::getPartition loaded from cache");
+      return;
+    }
+
     // Sparsity pattern with transpose
     Sparsity &AT = sparsity_jac(iind, oind, compact, symmetric);
     Sparsity A = symmetric ? AT : AT.T();
@@ -1430,6 +1898,9 @@ namespace casadi {
       }
 
     }
+
+    // Save to the persistent cache
+    if (cache_key!=0) SparsityCache::store(cache_key, cache_fp, {D1, D2});
     log("FunctionInternal::getPartition end");
   }
 
@@ -1454,12 +1925,13 @@ namespace casadi {
     // Check if cached
     if (cached.alive()) {
       // Return an owning reference
-      return shared_cast<Function>(cached.shared());
+      return cache_derivative(shared_cast<Function>(cached.shared()));
 
     } else {
       // Give it a suitable name
       stringstream ss;
       ss << "jacobian_" << name_ << "_" << iind << "_" << oind;
+      TraceScope trace(ss.str(), "derivative");
 
       // Output names
       std::vector<std::string> ionames;
@@ -1476,12 +1948,28 @@ namespace casadi {
                    {"jit", jit_},
                    {"compiler", compilerplugin_},
                    {"jit_options", jit_options_},
+                   {"jit_async", jit_async_},
+                   {"jit_threshold", jit_threshold_},
                    {"derivative_of", function()}};
-      Function ret = getJacobian(ss.str(), iind, oind, compact, symmetric, opts);
+      Function ret;
+      bool fd = enable_fd_ && !hasDerivative();
+      if (compressed_jacobian_ || fd) {
+        // Finite differences if requested and no derivative information is available
+        Dict jopts = {{"verbose", verbose_},
+                      {"input_scheme", ischeme_},
+                      {"output_scheme", ionames},
+                      {"derivative_of", function()}};
+        if (fd) jopts.insert(fd_options_.begin(), fd_options_.end());
+        ret.assignNode(new CompressedJacobian(ss.str(), function(),
+                                              iind, oind, compact, symmetric, fd));
+        ret->construct(jopts);
+      } else {
+        ret = getJacobian(ss.str(), iind, oind, compact, symmetric, opts);
+      }
 
       // Save in cache
       compact ? jac_compact_.elem(oind, iind) : jac_.elem(oind, iind) = ret;
-      return ret;
+      return cache_derivative(ret);
     }
   }
 
@@ -1509,13 +1997,14 @@ namespace casadi {
 
     // Quick return if already cached
     if (derivative_fwd_[nfwd].alive()) {
-      return shared_cast<Function>(derivative_fwd_[nfwd].shared());
+      return cache_derivative(shared_cast<Function>(derivative_fwd_[nfwd].shared()));
     }
 
     // Give it a suitable name
     stringstream ss;
     ss << "fwd" << nfwd << "_" << name_;
     string name = ss.str();
+    TraceScope trace(name, "derivative");
 
     // Get the number of inputs and outputs
     int n_in = this->n_in();
@@ -1563,6 +2052,8 @@ namespace casadi {
                  {"jit", jit_},
                  {"compiler", compilerplugin_},
                  {"jit_options", jit_options_},
+                 {"jit_async", jit_async_},
+                 {"jit_threshold", jit_threshold_},
                  {"derivative_of", function()}};
 
     // Return value
@@ -1593,7 +2084,7 @@ namespace casadi {
     derivative_fwd_[nfwd] = ret;
 
     // Return generated function
-    return ret;
+    return cache_derivative(ret);
   }
 
   Function FunctionInternal::reverse(int nadj) {
@@ -1606,13 +2097,14 @@ namespace casadi {
 
     // Quick return if already cached
     if (derivative_adj_[nadj].alive()) {
-      return shared_cast<Function>(derivative_adj_[nadj].shared());
+      return cache_derivative(shared_cast<Function>(derivative_adj_[nadj].shared()));
     }
 
     // Give it a suitable name
     stringstream ss;
     ss << "adj" << nadj << "_" << name_;
     string name = ss.str();
+    TraceScope trace(name, "derivative");
 
     // Get the number of inputs and outputs
     int n_in = this->n_in();
@@ -1660,6 +2152,8 @@ namespace casadi {
                  {"jit", jit_},
                  {"compiler", compilerplugin_},
                  {"jit_options", jit_options_},
+                 {"jit_async", jit_async_},
+                 {"jit_threshold", jit_threshold_},
                  {"derivative_of", function()}};
 
     // Return value
@@ -1690,7 +2184,7 @@ namespace casadi {
     derivative_adj_[nadj] = ret;
 
     // Return generated function
-    return ret;
+    return cache_derivative(ret);
   }
 
   void FunctionInternal::set_forward(const Function& fcn, int nfwd) {
@@ -1775,10 +2269,11 @@ namespace casadi {
   Function FunctionInternal::fullJacobian() {
     if (full_jacobian_.alive()) {
       // Return cached Jacobian
-      return shared_cast<Function>(full_jacobian_.shared());
+      return cache_derivative(shared_cast<Function>(full_jacobian_.shared()));
     } else {
       // Options
       string name = name_ + "_jac";
+      TraceScope trace(name, "derivative");
       Dict opts;
       opts["input_scheme"] = ischeme_;
       opts["output_scheme"] = std::vector<std::string>(1, "jac");
@@ -1792,17 +2287,29 @@ namespace casadi {
 
       // Cache it for reuse and return
       full_jacobian_ = ret;
-      return ret;
+      return cache_derivative(ret);
     }
   }
 
   Function FunctionInternal::getFullJacobian(const std::string& name, const Dict& opts) {
-    casadi_assert(get_n_forward()>0 || get_n_reverse()>0);
-
     // Number inputs and outputs
     int n_in = this->n_in();
     int n_out = this->n_out();
 
+    // No directional derivatives: assemble from finite difference Jacobian blocks
+    if (get_n_forward()==0 && get_n_reverse()==0) {
+      casadi_assert_message(enable_fd_, "No derivative information available for "
+                            + type_name() + ", set 'enable_fd' to use finite differences");
+      vector<MX> argv = mx_in();
+      vector<vector<MX> > blocks(n_out, vector<MX>(n_in));
+      for (int oind=0; oind<n_out; ++oind) {
+        for (int iind=0; iind<n_in; ++iind) {
+          blocks[oind][iind] = jacobian(iind, oind, false, false)(argv).at(0);
+        }
+      }
+      return Function(name, argv, {blockcat(blocks)}, opts);
+    }
+
     // Symbolic inputs of the full Jacobian function under construction
     vector<MX> ret_argv = mx_in(), argv, resv;
 
@@ -1868,11 +2375,18 @@ namespace casadi {
     // Generate declarations
     generateDeclarations(g);
 
+    // In split mode, the function gets a translation unit of its own
+    string body_before;
+    if (g.split) {
+      body_before = g.body.str();
+      g.body.str(string());
+    }
+
     // Define function
     g.body << "/* " << name_ << " */" << endl;
-    if (decl_static) {
+    if (decl_static && !g.split) {
       g.body << "static ";
-    } else if (g.cpp) {
+    } else if (!decl_static && g.cpp) {
       g.body << "extern \"C\" ";
     }
     g.body << signature(fname) << " {" << endl;
@@ -1883,6 +2397,77 @@ namespace casadi {
     // Finalize the function
     if (!simplifiedCall()) g.body << "  return 0;" << endl;
     g.body << "}" << endl << endl;
+
+    if (g.split) {
+      string decl = signature(fname);
+      if (!decl_static && g.cpp) decl = "extern \"C\" " + decl;
+      g.add_unit(decl, g.body.str());
+      g.body.str(string());
+      g.body << body_before;
+    }
+  }
+
+  void FunctionInternal::generateBatch(CodeGenerator& g, const std::string& fname) const {
+    // In split mode, the function gets a translation unit of its own
+    string body_before;
+    if (g.split) {
+      body_before = g.body.str();
+      g.body.str(string());
+    }
+
+    // Define function
+    string decl = "int " + fname + "_batch(const real_t** arg, real_t** res, int* iw, "
+      "real_t* w, int n, int stride)";
+    g.body << "/* " << name_ << ", batch */" << endl
+           << g.declare(decl) << " {" << endl;
+    generateBatchBody(g, fname);
+    g.body << "  return 0;" << endl
+           << "}" << endl << endl;
+
+    if (g.split) {
+      g.add_unit((g.cpp ? "extern \"C\" " : "") + decl, g.body.str());
+      g.body.str(string());
+      g.body << body_before;
+    }
+  }
+
+  void FunctionInternal::generateBatchBody(CodeGenerator& g, const std::string& fname) const {
+    // Gather the inputs of each point in w, after the work vector of the function
+    int n_in = this->n_in(), n_out = this->n_out();
+    g.body << "  int p, j;" << endl
+           << "  const real_t** arg1 = arg+" << n_in << ";" << endl
+           << "  real_t** res1 = res+" << n_out << ";" << endl
+           << "  real_t* buf = w+" << sz_w() << ";" << endl
+           << "  for (p=0; p<n; ++p) {" << endl;
+    int off = 0;
+    for (int i=0; i<n_in; ++i) {
+      g.body << "    arg1[" << i << "] = arg[" << i << "] ? buf+" << off << " : 0;" << endl
+             << "    if (arg[" << i << "]) for (j=0; j<" << nnz_in(i) << "; ++j) "
+             << "buf[" << off << "+j] = arg[" << i << "][j*stride+p];" << endl;
+      off += nnz_in(i);
+    }
+    for (int i=0; i<n_out; ++i) {
+      g.body << "    res1[" << i << "] = res[" << i << "] ? buf+" << off << " : 0;" << endl;
+      off += nnz_out(i);
+    }
+    g.body << "    if (" << fname << "(arg1, res1, iw, w, 0)) return 1;" << endl;
+
+    // Scatter the outputs
+    off = nnz_in();
+    for (int i=0; i<n_out; ++i) {
+      g.body << "    if (res[" << i << "]) for (j=0; j<" << nnz_out(i) << "; ++j) "
+             << "res[" << i << "][j*stride+p] = buf[" << off << "+j];" << endl;
+      off += nnz_out(i);
+    }
+    g.body << "  }" << endl;
+  }
+
+  void FunctionInternal::sz_work_batch(size_t& sz_arg, size_t& sz_res,
+                                       size_t& sz_iw, size_t& sz_w) const {
+    sz_arg = n_in() + this->sz_arg();
+    sz_res = n_out() + this->sz_res();
+    sz_iw = this->sz_iw();
+    sz_w = this->sz_w() + nnz_in() + nnz_out();
   }
 
   std::string FunctionInternal::signature(const std::string& fname) const {
@@ -1969,6 +2554,20 @@ namespace casadi {
     s << "}" << endl;
     s << endl;
 
+    // Work vector lengths for the batch function
+    if (g.batch) {
+      size_t sz_arg_b, sz_res_b, sz_iw_b, sz_w_b;
+      sz_work_batch(sz_arg_b, sz_res_b, sz_iw_b, sz_w_b);
+      s << g.declare("int " + fname + "_batch_work(int *sz_arg, int* sz_res, int *sz_iw, "
+                     "int *sz_w)") << " {" << endl
+        << "  if (sz_arg) *sz_arg = " << sz_arg_b << ";" << endl
+        << "  if (sz_res) *sz_res = " << sz_res_b << ";" << endl
+        << "  if (sz_iw) *sz_iw = " << sz_iw_b << ";" << endl
+        << "  if (sz_w) *sz_w = " << sz_w_b << ";" << endl
+        << "  return 0;" << endl
+        << "}" << endl << endl;
+    }
+
     // Generate mex gateway for the function
     if (g.mex) {
       // Begin conditional compilation
@@ -2126,13 +2725,14 @@ namespace casadi {
       // Print to file
       generateFunction(g, "CASADI_PREFIX(" + name + ")", true);
 
-      // Shorthand
+      // Shorthand, shared by all translation units in split mode
+      stringstream& decl = g.split ? g.declarations : g.body;
       if (simplifiedCall()) {
-        g.body
+        decl
           << "#define " << name << "(arg, res) "
           << "CASADI_PREFIX(" << name << ")(arg, res)" << endl << endl;
       } else {
-        g.body
+        decl
           << "#define " << name << "(arg, res, iw, w, mem) "
           << "CASADI_PREFIX(" << name << ")(arg, res, iw, w, mem)" << endl << endl;
       }
@@ -2142,16 +2742,18 @@ namespace casadi {
         // Increase reference counter
         g.body << "void CASADI_PREFIX(" << name << "_incref)(void) {" << endl;
         codegen_incref(g);
-        g.body
-          << "}" << endl
+        g.body << "}" << endl;
+        if (g.split) decl << "void CASADI_PREFIX(" << name << "_incref)(void);" << endl;
+        decl
           << "#define " << name << "_incref() "
           << "CASADI_PREFIX(" << name << "_incref)()" << endl << endl;
 
         // Decrease reference counter
         g.body << "void CASADI_PREFIX(" << name << "_decref)(void) {" << endl;
         codegen_decref(g);
-        g.body
-          << "}" << endl
+        g.body << "}" << endl;
+        if (g.split) decl << "void CASADI_PREFIX(" << name << "_decref)(void);" << endl;
+        decl
           << "#define " << name << "_decref() "
           << "CASADI_PREFIX(" << name << "_decref)()" << endl << endl;
       }
@@ -2200,7 +2802,7 @@ namespace casadi {
         if (arg[iind]==0 || nnz_in(iind)==0) continue;
 
         // Get the sparsity of the Jacobian block
-        Sparsity sp = sparsity_jac(iind, oind, true, false);
+        const Sparsity& sp = sparsity_jac(iind, oind, true, false);
         if (sp.is_null() || sp.nnz() == 0) continue; // Skip if zero
 
         // Carry out the sparse matrix-vector multiplication
@@ -2231,7 +2833,7 @@ namespace casadi {
         if (arg[iind]==0 || nnz_in(iind)==0) continue;
 
         // Get the sparsity of the Jacobian block
-        Sparsity sp = sparsity_jac(iind, oind, true, false);
+        const Sparsity& sp = sparsity_jac(iind, oind, true, false);
         if (sp.is_null() || sp.nnz() == 0) continue; // Skip if zero
 
         // Carry out the sparse matrix-vector multiplication
@@ -2299,6 +2901,16 @@ namespace casadi {
     alloc_w(sz_w, persistent);
   }
 
+  void FunctionInternal::alloc(const JacobianProduct& jp, bool persistent) {
+    if (jp.is_null()) return;
+    size_t sz_arg, sz_res, sz_iw, sz_w;
+    jp.sz_work(sz_arg, sz_res, sz_iw, sz_w);
+    alloc_arg(sz_arg, persistent);
+    alloc_res(sz_res, persistent);
+    alloc_iw(sz_iw, persistent);
+    alloc_w(sz_w, persistent);
+  }
+
   bool FunctionInternal::hasFullJacobian() const {
     return full_jacobian_.alive();
   }
@@ -2346,8 +2958,10 @@ namespace casadi {
     casadi_assert_message(!always_inline, "Class " + type_name() +
                           " cannot be inlined in an MX expression");
 
-    // Derivative information must be available
-    casadi_assert(hasDerivative());
+    // Derivative information must be available, unless finite differences are enabled
+    casadi_assert_message(hasDerivative() || enable_fd_,
+                          "No derivative information available for " + type_name()
+                          + ", set 'enable_fd' to use finite differences");
 
     // Number of directional derivatives
     int nfwd = fseed.size();
@@ -2423,8 +3037,10 @@ namespace casadi {
     casadi_assert_message(!always_inline, "Class " + type_name() +
                           " cannot be inlined in an MX expression");
 
-    // Derivative information must be available
-    casadi_assert(hasDerivative());
+    // Derivative information must be available, unless finite differences are enabled
+    casadi_assert_message(hasDerivative() || enable_fd_,
+                          "No derivative information available for " + type_name()
+                          + ", set 'enable_fd' to use finite differences");
 
     // Number of directional derivatives
     int nadj = aseed.size();
@@ -2872,17 +3488,23 @@ namespace casadi {
   }
 
   void FunctionInternal::clear_memory() {
-    for (auto&& i : mem_) {
-      if (i!=0) free_memory(i);
+    for (int i=0; i<n_mem_alloc_; ++i) {
+      void*& m = mem_slot(i).mem;
+      if (m!=0) free_memory(m);
+      m = 0;
     }
-    mem_.clear();
+  }
+
+  Function FunctionInternal::derivative_of() {
+    return shared_cast<Function>(derivative_of_.shared());
   }
 
   size_t FunctionInternal::get_n_in() {
-    if (!derivative_of_.is_null()) {
-      string n = derivative_of_.name();
+    Function derivative_of = this->derivative_of();
+    if (!derivative_of.is_null()) {
+      string n = derivative_of.name();
       if (name_ == n + "_jac") {
-        return derivative_of_.n_in();
+        return derivative_of.n_in();
       }
     }
     // One by default
@@ -2890,8 +3512,9 @@ namespace casadi {
   }
 
   size_t FunctionInternal::get_n_out() {
-    if (!derivative_of_.is_null()) {
-      string n = derivative_of_.name();
+    Function derivative_of = this->derivative_of();
+    if (!derivative_of.is_null()) {
+      string n = derivative_of.name();
       if (name_ == n + "_jac") {
         return 1;
       }
@@ -2901,11 +3524,12 @@ namespace casadi {
   }
 
   Sparsity FunctionInternal::get_sparsity_in(int i) {
-    if (!derivative_of_.is_null()) {
-      string n = derivative_of_.name();
+    Function derivative_of = this->derivative_of();
+    if (!derivative_of.is_null()) {
+      string n = derivative_of.name();
       if (name_ == n + "_jac") {
         // Same as nondifferentiated function
-        return derivative_of_.sparsity_in(i);
+        return derivative_of.sparsity_in(i);
       }
     }
     // Scalar by default
@@ -2913,41 +3537,326 @@ namespace casadi {
   }
 
   Sparsity FunctionInternal::get_sparsity_out(int i) {
-    if (!derivative_of_.is_null()) {
-      string n = derivative_of_.name();
+    Function derivative_of = this->derivative_of();
+    if (!derivative_of.is_null()) {
+      string n = derivative_of.name();
       if (name_ == n + "_jac") {
         // Dense Jacobian by default
-        return Sparsity::dense(derivative_of_.nnz_out(), derivative_of_.nnz_in());
+        return Sparsity::dense(derivative_of.nnz_out(), derivative_of.nnz_in());
       }
     }
     // Scalar by default
     return Sparsity::scalar();
   }
 
+  FunctionInternal::MemSlot& FunctionInternal::mem_slot(int ind) const {
+    // Block k holds 2^k entries, starting at 2^k-1
+    int k = 0;
+    while ((2 << k) <= ind+1) k++;
+    return mem_block_[k].load(std::memory_order_acquire)[ind + 1 - (1 << k)];
+  }
+
   void* FunctionInternal::memory(int ind) const {
-    return mem_.at(ind);
+    casadi_assert_message(ind>=0 && ind<n_mem_alloc_.load(std::memory_order_acquire),
+                          "Memory object " << ind << " does not exist");
+    return mem_slot(ind).mem;
   }
 
   int FunctionInternal::checkout() {
-    if (unused_.empty()) {
-      // Allocate a new memory object
-      int n_mem = this->n_mem();
-      casadi_assert_message(n_mem==0 || mem_.size()<n_mem,
-                            "Too many memory objects");
-      void* m = alloc_memory();
-      mem_.push_back(m);
-      if (m) init_memory(m);
-      return mem_.size()-1;
-    } else {
-      // Use an unused memory object
-      int m = unused_.top();
-      unused_.pop();
-      return m;
+    // Pop an unused memory object from the free list, if any
+    uint64_t head = unused_.load(std::memory_order_acquire);
+    while (true) {
+      int ind = static_cast<int>(head & 0xffffffff) - 1;
+      if (ind<0) break;
+      int next = mem_slot(ind).next.load(std::memory_order_relaxed);
+      uint64_t new_head = (((head >> 32) + 1) << 32) | static_cast<uint32_t>(next + 1);
+      if (unused_.compare_exchange_weak(head, new_head, std::memory_order_acq_rel,
+                                        std::memory_order_acquire)) {
+        return ind;
+      }
     }
+
+    // Allocate a new memory object
+    std::lock_guard<std::mutex> lock(mem_mtx_);
+    int ind = n_mem_alloc_.load(std::memory_order_relaxed);
+    int n_mem = this->n_mem();
+    casadi_assert_message(n_mem==0 || ind<n_mem, "Too many memory objects");
+    int k = 0;
+    while ((2 << k) <= ind+1) k++;
+    casadi_assert_message(k<mem_max_block, "Too many memory objects");
+    if (mem_block_[k].load(std::memory_order_relaxed)==0) {
+      mem_block_[k].store(new MemSlot[1 << k], std::memory_order_release);
+    }
+    MemSlot& slot = mem_slot(ind);
+    slot.mem = alloc_memory();
+    slot.next = -1;
+    if (slot.mem) init_memory(slot.mem);
+    n_mem_alloc_.store(ind+1, std::memory_order_release);
+    return ind;
   }
 
   void FunctionInternal::release(int mem) {
-    unused_.push(mem);
+    // Push to the free list
+    MemSlot& slot = mem_slot(mem);
+    uint64_t head = unused_.load(std::memory_order_relaxed);
+    uint64_t new_head;
+    do {
+      slot.next.store(static_cast<int>(head & 0xffffffff) - 1, std::memory_order_relaxed);
+      new_head = (((head >> 32) + 1) << 32) | static_cast<uint32_t>(mem + 1);
+    } while (!unused_.compare_exchange_weak(head, new_head, std::memory_order_release,
+                                            std::memory_order_relaxed));
+  }
+
+  void FunctionInternal::call_threadsafe(const double** arg, double** res) {
+    // Work vectors local to the calling thread
+    vector<const double*> argp(sz_arg());
+    copy(arg, arg+n_in(), argp.begin());
+    vector<double*> resp(sz_res());
+    copy(res, res+n_out(), resp.begin());
+    vector<int> iw(sz_iw());
+    vector<double> w(sz_w());
+
+    // Evaluate with a memory object of its own
+    int mem = checkout();
+    try {
+      _eval(get_ptr(argp), get_ptr(resp), get_ptr(iw), get_ptr(w), mem);
+    } catch (...) {
+      release(mem);
+      throw;
+    }
+    release(mem);
+  }
+
+  void FunctionInternal::call_batch(int n, const double** const* arg, double** const* res,
+                                    int n_threads) {
+    casadi_assert_message(n_threads>=1, "Number of threads must be positive");
+#ifndef WITH_OPENMP
+    casadi_assert_warning(n_threads==1, "CasADi was not compiled with OpenMP. "
+                          "Falling back to serial mode.");
+    n_threads = 1;
+#endif // WITH_OPENMP
+    n_threads = std::max(1, std::min(n_threads, n));
+
+    // Work vectors and memory object for each thread
+    size_t sz_arg = this->sz_arg(), sz_res = this->sz_res();
+    size_t sz_iw = this->sz_iw(), sz_w = this->sz_w();
+    vector<const double*> argp(n_threads*sz_arg);
+    vector<double*> resp(n_threads*sz_res);
+    vector<int> iw(n_threads*sz_iw);
+    vector<double> w(n_threads*sz_w);
+    vector<int> mem(n_threads);
+    for (int t=0; t<n_threads; ++t) mem[t] = checkout();
+
+    // Evaluate, contiguous chunks of calls for each thread
+    int n_in = this->n_in(), n_out = this->n_out();
+    string err;
+#ifdef WITH_OPENMP
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+#endif // WITH_OPENMP
+    for (int k=0; k<n; ++k) {
+#ifdef WITH_OPENMP
+      int t = omp_get_thread_num();
+#else // WITH_OPENMP
+      int t = 0;
+#endif // WITH_OPENMP
+      const double** arg_t = get_ptr(argp) + t*sz_arg;
+      double** res_t = get_ptr(resp) + t*sz_res;
+      try {
+        copy(arg[k], arg[k]+n_in, arg_t);
+        copy(res[k], res[k]+n_out, res_t);
+        _eval(arg_t, res_t, get_ptr(iw) + t*sz_iw, get_ptr(w) + t*sz_w, mem[t]);
+      } catch (exception& e) {
+#ifdef WITH_OPENMP
+#pragma omp critical(call_batch_error)
+#endif // WITH_OPENMP
+        if (err.empty()) err = e.what();
+      }
+    }
+    for (int t=0; t<n_threads; ++t) release(mem[t]);
+    casadi_assert_message(err.empty(), err);
+  }
+
+  void FunctionInternal::profile_add(double t_wall, const vector<long>& n_call,
+                                     const vector<double>& t_op) const {
+    lock_guard<mutex> lock(profile_mtx_);
+    profile_n_call_++;
+    profile_t_wall_ += t_wall;
+    for (int i=0; i<profile_ops_.size(); ++i) {
+      profile_ops_[i].n_call += n_call[i];
+      profile_ops_[i].t_wall += t_op[i];
+    }
+  }
+
+  double FunctionInternal::profile_t_wall() const {
+    lock_guard<mutex> lock(profile_mtx_);
+    return profile_t_wall_;
+  }
+
+  void FunctionInternal::profile_reset() {
+    lock_guard<mutex> lock(profile_mtx_);
+    profile_n_call_ = 0;
+    profile_t_wall_ = 0;
+    for (auto&& e : profile_ops_) {
+      e.n_call = 0;
+      e.t_wall = 0;
+    }
+  }
+
+  void FunctionInternal::profile_json(ostream& stream) const {
+    lock_guard<mutex> lock(profile_mtx_);
+    stream << "{\"name\": ";
+    Trace::write_json_string(stream, name_.c_str());
+    stream << ", \"n_call\": " << profile_n_call_
+           << ", \"t_wall\": " << profile_t_wall_ << ", \"ops\": [";
+    bool first = true;
+    for (auto&& e : profile_ops_) {
+      if (e.n_call==0) continue;
+      stream << (first ? "" : ", ") << "{";
+      first = false;
+      if (e.index>=0) stream << "\"index\": " << e.index << ", ";
+      stream << "\"op\": ";
+      Trace::write_json_string(stream, e.op.c_str());
+      stream << ", ";
+      if (!e.callee.is_null()) {
+        stream << "\"callee\": ";
+        Trace::write_json_string(stream, e.callee.name().c_str());
+        stream << ", ";
+      }
+      stream << "\"n_call\": " << e.n_call << ", \"t_wall\": " << e.t_wall;
+      // Profiling data of the called function, if recorded
+      if (!e.callee.is_null() && e.callee->profile_) {
+        stream << ", \"profile\": ";
+        e.callee->profile_json(stream);
+      }
+      stream << "}";
+    }
+    stream << "]}";
+  }
+
+  void FunctionInternal::profile_folded(ostream& stream, const string& prefix,
+                                        double scale) const {
+    lock_guard<mutex> lock(profile_mtx_);
+    string stack = prefix.empty() ? name_ : prefix + ";" + name_;
+
+    // Microseconds, lines that round to zero are skipped
+    auto line = [&](const string& s, double t) {
+      long us = static_cast<long>(1e6*scale*t + 0.5);
+      if (us>0) stream << s << " " << us << endl;
+    };
+
+    double t_ops = 0;
+    for (auto&& e : profile_ops_) {
+      if (e.n_call==0) continue;
+      t_ops += e.t_wall;
+      // The called function may be evaluated concurrently, read its total once
+      double t_callee = !e.callee.is_null() && e.callee->profile_ ?
+        e.callee->profile_t_wall() : 0;
+      if (t_callee>0) {
+        // Distribute over the operations of the called function, in proportion
+        e.callee->profile_folded(stream, stack, scale*e.t_wall/t_callee);
+      } else {
+        line(stack + ";" + (e.callee.is_null() ? e.op : e.callee.name()), e.t_wall);
+      }
+    }
+
+    // Time spent outside of the operations
+    line(stack, profile_t_wall_ - t_ops);
+  }
+
+  namespace {
+    /// Memory held by a sparsity pattern [bytes]
+    size_t sparsity_bytes(const Sparsity& sp) {
+      if (sp.is_null()) return 0;
+      return sizeof(SparsityInternal) + (3 + sp.size2() + sp.nnz())*sizeof(int);
+    }
+  } // namespace
+
+  Dict FunctionInternal::memory_usage() const {
+    // Input and output sparsity patterns
+    size_t sparsity = 0;
+    for (int i=0; i<n_in(); ++i) sparsity += sparsity_bytes(sparsity_in(i));
+    for (int i=0; i<n_out(); ++i) sparsity += sparsity_bytes(sparsity_out(i));
+
+    // Cached Jacobian sparsity patterns
+    size_t jac_sparsity = 0;
+    for (auto&& sp : jac_sparsity_.nonzeros()) jac_sparsity += sparsity_bytes(sp);
+    for (auto&& sp : jac_sparsity_compact_.nonzeros()) jac_sparsity += sparsity_bytes(sp);
+
+    // Work vectors needed for an evaluation
+    size_t work = (sz_arg()+sz_res())*sizeof(void*) + sz_iw()*sizeof(int) + sz_w()*sizeof(double);
+
+    // Cached derivative functions still alive, each counted once
+    vector<WeakRef> cached = derivative_fwd_;
+    cached.insert(cached.end(), derivative_adj_.begin(), derivative_adj_.end());
+    cached.push_back(full_jacobian_);
+    cached.insert(cached.end(), jac_.nonzeros().begin(), jac_.nonzeros().end());
+    cached.insert(cached.end(), jac_compact_.nonzeros().begin(), jac_compact_.nonzeros().end());
+    set<const SharedObjectNode*> visited;
+    size_t derivatives = 0;
+    int n_derivatives = 0;
+    for (auto&& r : cached) {
+      if (!r.alive()) continue;
+      Function d = shared_cast<Function>(r.shared());
+      if (d.is_null() || !visited.insert(d.get()).second) continue;
+      derivatives += static_cast<size_t>(d.memory_usage().at("total").to_double());
+      n_derivatives++;
+    }
+
+    size_t graph = graph_bytes(), algorithm = algorithm_bytes();
+    Dict ret;
+    ret["graph"] = static_cast<double>(graph);
+    ret["algorithm"] = static_cast<double>(algorithm);
+    ret["work"] = static_cast<double>(work);
+    ret["sparsity"] = static_cast<double>(sparsity);
+    ret["jac_sparsity"] = static_cast<double>(jac_sparsity);
+    ret["derivatives"] = static_cast<double>(derivatives);
+    ret["n_derivatives"] = n_derivatives;
+    ret["total"] = static_cast<double>(graph + algorithm + work + sparsity + jac_sparsity
+                                       + derivatives);
+    return ret;
+  }
+
+  Dict FunctionInternal::memory_usage_global() {
+    // Sparsity patterns still alive in the cache
+    Sparsity::CachingMap& cache = Sparsity::getCache();
+    size_t sparsity_cache = cache.bucket_count()*sizeof(void*);
+    int n_sparsity = 0;
+    for (auto&& e : cache) {
+      sparsity_cache += sizeof(e) + 2*sizeof(void*);
+      if (!e.second.alive()) continue;
+      sparsity_cache += sparsity_bytes(shared_cast<Sparsity>(e.second.shared()));
+      n_sparsity++;
+    }
+
+    Dict ret;
+    ret["sparsity_cache"] = static_cast<double>(sparsity_cache);
+    ret["n_sparsity_cache"] = n_sparsity;
+    ret["sx_constant_cache"] = static_cast<double>(RealtypeSX::cache_bytes()
+                                                   + IntegerSX::cache_bytes());
+    ret["n_sx_constant_cache"] = static_cast<int>(RealtypeSX::cache_size()
+                                                  + IntegerSX::cache_size());
+    ret["derivative_cache"] = static_cast<double>(DerivativeCache::memory());
+    ret["n_derivative_cache"] = DerivativeCache::size();
+    return ret;
+  }
+
+  const Function& FunctionInternal::cache_derivative(const Function& f) const {
+    if (derivative_cache_>0 || (derivative_cache_<0 && (GlobalOptions::derivative_cache_entries>0
+                                                        || GlobalOptions::derivative_cache_memory>0))) {
+      DerivativeCache::touch(this, f, derivative_cache_);
+    }
+    return f;
+  }
+
+  void FunctionInternal::release_derivatives() {
+    DerivativeCache::release(this);
+    derivative_fwd_.clear();
+    derivative_adj_.clear();
+    full_jacobian_ = WeakRef();
+    // Patterns set by the user cannot be regenerated
+    jac_sparsity_ = jac_sparsity_user_;
+    jac_sparsity_compact_ = jac_sparsity_compact_user_;
+    jac_ = jac_compact_ = SparseStorage<WeakRef>(Sparsity(n_out(), n_in()));
   }
 
 } // namespace casadi
@@ -27,9 +27,14 @@
 #define CASADI_FUNCTION_INTERNAL_HPP
 
 #include "function.hpp"
+#include "jacobian_product.hpp"
 #include "../weak_ref.hpp"
 #include <set>
 #include <stack>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <memory>
 #include "code_generator.hpp"
 #include "compiler.hpp"
 #include "../sparse_storage.hpp"
@@ -441,6 +446,40 @@ namespace casadi {
     /** \brief Number of nodes in the algorithm */
     virtual int n_nodes() const;
 
+    /** \brief Memory held by the expression graph [bytes], estimate */
+    virtual size_t graph_bytes() const { return 0;}
+
+    /** \brief Memory held by the algorithm [bytes], estimate */
+    virtual size_t algorithm_bytes() const { return 0;}
+
+    /** \brief Memory usage by category [bytes], estimate */
+    Dict memory_usage() const;
+
+    /** \brief Memory usage of the global caches [bytes], estimate */
+    static Dict memory_usage_global();
+
+    /** \brief Release cached derivative functions and Jacobian sparsity patterns */
+    void release_derivatives();
+
+    /** \brief Keep a derivative alive in the strong derivative cache, if enabled */
+    const Function& cache_derivative(const Function& f) const;
+
+    /** \brief Hash of the structure of the algorithm, 0 if not available
+     * Functions with the same structural hash have the same sparsity patterns.
+     */
+    virtual std::size_t get_structural_hash() const { return 0;}
+
+    /** \brief Hash of the structure of the function, 0 if not available */
+    std::size_t structural_hash();
+
+    /** \brief Append the structure of the algorithm, i.e. everything that is hashed
+     * by get_structural_hash, returns false if not available
+     */
+    virtual bool get_structural_fingerprint(std::vector<int>& fp) const { return false;}
+
+    /** \brief Append the structure of the function, returns false if not available */
+    bool structural_fingerprint(std::vector<int>& fp) const;
+
     /** \brief Create a helper MXFunction with some properties copied
     *
     * Copied properties:
@@ -483,6 +522,20 @@ namespace casadi {
     /** \brief Generate code for the function body */
     virtual void generateBody(CodeGenerator& g) const;
 
+    /** \brief Generate code evaluating the function at several points
+     * Signature: int fname(arg, res, iw, w, int n, int stride), with nonzero j
+     * of point p at index j*stride+p of each input and output
+     */
+    void generateBatch(CodeGenerator& g, const std::string& fname) const;
+
+    /** \brief Generate code for the body of the batch function
+     * Default: loop over the points, calling the function \a fname
+     */
+    virtual void generateBatchBody(CodeGenerator& g, const std::string& fname) const;
+
+    /** \brief Work vector sizes needed by the batch function */
+    void sz_work_batch(size_t& sz_arg, size_t& sz_res, size_t& sz_iw, size_t& sz_w) const;
+
     /** \brief Export / Generate C code for the dependency function */
     virtual void generate_dependencies(const std::string& fname, const Dict& opts);
 
@@ -513,6 +566,9 @@ namespace casadi {
     /// Is function fcn being monitored
     bool monitored(const std::string& mod) const;
 
+    /// Function this function is a derivative of, null if none or no longer alive
+    Function derivative_of();
+
     ///@{
     /** \brief Number of function inputs and outputs */
     inline int n_in() const { return isp_.size();}
@@ -571,6 +627,11 @@ namespace casadi {
     /// Get, if necessary generate, the sparsity of a Jacobian block
     Sparsity& sparsity_jac(int iind, int oind, bool compact, bool symmetric);
 
+    /// Key into the persistent sparsity cache and the fingerprint it hashes, 0 if not cached
+    std::size_t sparsity_cache_key(const std::string& kind, int iind, int oind,
+                                   bool compact, bool symmetric,
+                                   std::vector<int>& fingerprint);
+
     /// Get a vector of symbolic variables corresponding to the outputs
     virtual std::vector<MX> symbolicOutput(const std::vector<MX>& arg);
 
@@ -681,6 +742,9 @@ namespace casadi {
     /** \brief Ensure work vectors long enough to evaluate function */
     void alloc(const Function& f, bool persistent=false);
 
+    /** \brief Ensure work vectors long enough to evaluate Jacobian-vector products */
+    void alloc(const JacobianProduct& jp, bool persistent=false);
+
     /// Memory objects
     void* memory(int ind) const;
 
@@ -705,6 +769,38 @@ namespace casadi {
     virtual Dict _get_stats(int mem) const { return get_stats(memory(mem));}
     ///@}
 
+    /// Profiling data of an operation, cf. the "profile" option
+    struct ProfileEntry {
+      /// Position in the algorithm, -1 if aggregated by operation code
+      int index;
+      /// Operation, e.g. "sin" or "call"
+      std::string op;
+      /// Called function, if any
+      Function callee;
+      /// Number of evaluations
+      long n_call;
+      /// Accumulated wall time [s]
+      double t_wall;
+      ProfileEntry(int index=-1, const std::string& op="", const Function& callee=Function())
+        : index(index), op(op), callee(callee), n_call(0), t_wall(0) {}
+    };
+
+    /// Add the profiling data of an evaluation, thread-safe
+    void profile_add(double t_wall, const std::vector<long>& n_call,
+                     const std::vector<double>& t_op) const;
+
+    /// Accumulated wall time of the profiled evaluations, thread-safe
+    double profile_t_wall() const;
+
+    ///@{
+    /// Export profiling data
+    void profile_json(std::ostream& stream) const;
+    void profile_folded(std::ostream& stream, const std::string& prefix, double scale) const;
+    ///@}
+
+    /// Reset profiling data
+    void profile_reset();
+
     ///@{
     /** \brief Set the (persistent) work vectors */
     virtual void set_work(void* mem, const double**& arg, double**& res,
@@ -739,12 +835,18 @@ namespace casadi {
     virtual bool adjViaJac(int nadj);
     ///@}
 
-    /// Checkout a memory object
+    /// Checkout a memory object, thread-safe
     int checkout();
 
-    /// Release a memory object
+    /// Release a memory object, thread-safe
     void release(int mem);
 
+    /// Evaluate with a checked out memory object and local work vectors, thread-safe
+    void call_threadsafe(const double** arg, double** res);
+
+    /// Evaluate for a batch of inputs, work vectors and memory allocated once per thread
+    void call_batch(int n, const double** const* arg, double** const* res, int n_threads);
+
     /// Input and output sparsity
     std::vector<Sparsity> isp_, osp_;
 
@@ -757,9 +859,33 @@ namespace casadi {
     /** \brief  Use just-in-time compiler */
     bool jit_;
 
-    /** \brief Numerical evaluation redirected to a C function */
-    eval_t eval_;
-    simple_t simple_;
+    /** \brief Compile in the background, cf. the "jit_async" option */
+    bool jit_async_;
+
+    /** \brief Evaluations before just-in-time compilation, cf. the "jit_threshold" option */
+    int jit_threshold_;
+
+    /** \brief Numerical evaluation redirected to a C function
+        Atomic, since they are replaced when a background compilation finishes */
+    std::atomic<eval_t> eval_;
+    std::atomic<simple_t> simple_;
+
+    /// State of a deferred just-in-time compilation
+    struct JitTask;
+
+    /// Deferred just-in-time compilation, started once the function is hot
+    std::shared_ptr<JitTask> jit_task_;
+
+    /// Just-in-time compilation deferred or running, number of evaluations so far
+    std::atomic<bool> jit_pending_, jit_started_;
+    std::atomic<int> jit_calls_;
+    std::mutex jit_mtx_;
+
+    /// Count evaluations, start the deferred compilation and switch to the compiled code
+    void jit_poll();
+
+    /// Generate code and compile it, in the background if "jit_async"
+    void jit_start();
 
     /// Set of module names which are extra monitored
     std::set<std::string> monitors_;
@@ -770,6 +896,22 @@ namespace casadi {
     /** \brief Flag to indicate whether statistics must be gathered */
     bool gather_stats_;
 
+    /// Record the number of calls and evaluation time of each operation
+    bool profile_;
+
+    /// Profiling data, one entry per operation
+    mutable std::vector<ProfileEntry> profile_ops_;
+
+    /// Number of evaluations and accumulated wall time [s] when profiling
+    mutable long profile_n_call_;
+    mutable double profile_t_wall_;
+
+    /// Guards the profiling data
+    mutable std::mutex profile_mtx_;
+
+    /// Number of derivatives kept alive by the strong derivative cache, -1: global limit
+    int derivative_cache_;
+
     /** \brief Reference counting in codegen? */
     bool has_refcount_;
 
@@ -782,11 +924,14 @@ namespace casadi {
     /// Cache for sparsities of the Jacobian blocks
     SparseStorage<Sparsity> jac_sparsity_, jac_sparsity_compact_;
 
+    /// Sparsities of the Jacobian blocks set with set_jac_sparsity, kept when releasing
+    SparseStorage<Sparsity> jac_sparsity_user_, jac_sparsity_compact_user_;
+
     /// Cache for Jacobians
     SparseStorage<WeakRef> jac_, jac_compact_;
 
     /// If the function is the derivative of another function
-    Function derivative_of_;
+    WeakRef derivative_of_;
 
     /// User-set field
     void* user_data_;
@@ -805,6 +950,22 @@ namespace casadi {
     // Weighting factor for derivative calculation and sparsity pattern calculation
     double ad_weight_, ad_weight_sp_;
 
+    // Number of threads for sparsity pattern calculation
+    int n_threads_sp_;
+
+    // Evaluate Jacobians numerically from compressed directional derivatives
+    bool compressed_jacobian_;
+
+    // Approximate Jacobians by finite differences if no derivatives are available
+    bool enable_fd_;
+
+    // Options for finite difference Jacobians
+    Dict fd_options_;
+
+    // Cached structural hash, 0 if not available
+    std::size_t structural_hash_;
+    bool has_structural_hash_;
+
     bool monitor_inputs_, monitor_outputs_;
 
     /// Errors are thrown when NaN is produced
@@ -855,12 +1016,37 @@ namespace casadi {
                               int* iw, bvec_t* w, int mem, bool tr, int nrhs);
     ///@}
 
+    /// Number of memory objects to allocate up front
+    int mem_pool_;
+
   private:
-    /// Memory objects
-    std::vector<void*> mem_;
+    /// Memory object in the pool
+    struct MemSlot {
+      void* mem;
+      /// Next unused memory object, -1 if none
+      std::atomic<int> next;
+    };
+
+    /// Maximum number of blocks of memory objects
+    static const int mem_max_block = 31;
+
+    /** \brief Memory objects
+     * Stored in blocks of doubling size, block k holding entries 2^k-1, ..., 2^(k+1)-2,
+     * so that existing entries never move when the pool grows
+     */
+    std::atomic<MemSlot*> mem_block_[mem_max_block];
+
+    /// Get a slot by index
+    MemSlot& mem_slot(int ind) const;
+
+    /// Number of memory objects allocated
+    std::atomic<int> n_mem_alloc_;
+
+    /// Lock-free list of unused memory objects: index+1 (lower bits) and ABA tag
+    std::atomic<std::uint64_t> unused_;
 
-    /// Unused memory objects
-    std::stack<int> unused_;
+    /// Serializes the allocation of new memory objects
+    std::mutex mem_mtx_;
 
     /** \brief Memory that is persistent during a call (but not between calls) */
     size_t sz_arg_per_, sz_res_per_, sz_iw_per_, sz_w_per_;
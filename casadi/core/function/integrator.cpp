@@ -1449,6 +1449,13 @@ namespace casadi {
     // Get discrete time dimensions
     nZ_ = F_.nnz_in(DAE_Z);
     nRZ_ =  G_.is_null() ? 0 : G_.nnz_in(RDAE_RZ);
+
+    // State and tape in generated code, kept in the memory object otherwise
+    alloc_w(1 + 2*nx_ + nz_ + 2*nZ_ + 2*nq_, true);
+    if (nrx_>0) {
+      alloc_w(2*nrx_ + nrz_ + 2*nRZ_ + 2*nrq_, true);
+      alloc_w((nk_+1)*nx_ + nk_*nZ_, true);
+    }
   }
 
   void FixedStepIntegrator::init_memory(void* mem) const {
@@ -1639,6 +1646,143 @@ namespace casadi {
     casadi_fill(m->RZ.ptr(), m->RZ.nnz(), numeric_limits<double>::quiet_NaN());
   }
 
+  void FixedStepIntegrator::generateDeclarations(CodeGenerator& g) const {
+    // Generate code for the discrete time dynamics
+    getExplicit()->addDependency(g);
+    if (nrx_>0) getExplicitB()->addDependency(g);
+  }
+
+  void FixedStepIntegrator::generate_guess(CodeGenerator& g, bool backward,
+                                           const std::string& x, const std::string& z,
+                                           const std::string& Z) const {
+    int n = backward ? nRZ_ : nZ_;
+    if (n>0) g.body << "  " << g.fill(Z, n, "NAN") << endl;
+  }
+
+  void FixedStepIntegrator::generateBody(CodeGenerator& g) const {
+    // Discrete time dynamics
+    const Function& F = getExplicit();
+    string t0 = g.constant(grid_.front()), h = g.constant(h_);
+
+    // Work vectors, as in the memory object
+    g.body << "  const real_t** arg1 = arg + " << INTEGRATOR_NUM_IN << ";" << endl
+           << "  real_t** res1 = res + " << INTEGRATOR_NUM_OUT << ";" << endl
+           << "  real_t* t = w; w += 1;" << endl
+           << "  real_t* x = w; w += " << nx_ << ";" << endl
+           << "  real_t* x_prev = w; w += " << nx_ << ";" << endl
+           << "  real_t* z = w; w += " << nz_ << ";" << endl
+           << "  real_t* Z = w; w += " << nZ_ << ";" << endl
+           << "  real_t* Z_prev = w; w += " << nZ_ << ";" << endl
+           << "  real_t* q = w; w += " << nq_ << ";" << endl
+           << "  real_t* q_prev = w; w += " << nq_ << ";" << endl;
+    if (nrx_>0) {
+      g.body << "  real_t* rx = w; w += " << nrx_ << ";" << endl
+             << "  real_t* rx_prev = w; w += " << nrx_ << ";" << endl
+             << "  real_t* rz = w; w += " << nrz_ << ";" << endl
+             << "  real_t* RZ = w; w += " << nRZ_ << ";" << endl
+             << "  real_t* RZ_prev = w; w += " << nRZ_ << ";" << endl
+             << "  real_t* rq = w; w += " << nrq_ << ";" << endl
+             << "  real_t* rq_prev = w; w += " << nrq_ << ";" << endl
+             << "  real_t* x_tape = w; w += " << (nk_+1)*nx_ << ";" << endl
+             << "  real_t* Z_tape = w; w += " << nk_*nZ_ << ";" << endl;
+    }
+    g.body << "  int k, j;" << endl;
+
+    // Reset the forward problem
+    g.body << "  *t = " << t0 << ";" << endl
+           << "  " << g.copy("arg[" + g.to_string(INTEGRATOR_X0) + "]", nx_, "x") << endl
+           << "  " << g.copy("arg[" + g.to_string(INTEGRATOR_Z0) + "]", nz_, "z") << endl
+           << "  " << g.fill("q", nq_, "0") << endl;
+    generate_guess(g, false, "x", "z", "Z");
+    if (nrx_>0) g.body << "  " << g.copy("x", nx_, "x_tape") << endl;
+
+    // Discrete time steps at which the outputs are returned
+    vector<int> k_out;
+    for (int k=output_t0_ ? 0 : 1; k<grid_.size(); ++k) {
+      int kk = std::ceil((grid_[k] - grid_.front())/h_);
+      k_out.push_back(std::min(kk, nk_));
+    }
+
+    // Discrete dynamics function inputs and outputs
+    g.body << "  arg1[" << DAE_T << "] = t;" << endl
+           << "  arg1[" << DAE_X << "] = x_prev;" << endl
+           << "  arg1[" << DAE_Z << "] = Z_prev;" << endl
+           << "  arg1[" << DAE_P << "] = arg[" << INTEGRATOR_P << "];" << endl
+           << "  res1[" << DAE_ODE << "] = x;" << endl
+           << "  res1[" << DAE_ALG << "] = Z;" << endl
+           << "  res1[" << DAE_QUAD << "] = q;" << endl;
+
+    // Take time steps until the last output has been reached
+    g.body << "  j = 0;" << endl
+           << "  for (k=0; ; ++k) {" << endl;
+    if (!k_out.empty()) {
+      string r[] = {"x", "Z+" + g.to_string(nZ_-nz_), "q"};
+      int ind[] = {INTEGRATOR_XF, INTEGRATOR_ZF, INTEGRATOR_QF};
+      int n[] = {nx_, nz_, nq_};
+      g.body << "    while (j<" << k_out.size() << " && s"
+             << g.getConstant(k_out, true) << "[j]==k) {" << endl;
+      for (int i=0; i<3; ++i) {
+        string res_i = "res[" + g.to_string(ind[i]) + "]";
+        g.body << "      " << g.copy(r[i], n[i], res_i + " ? " + res_i + "+j*"
+                                     + g.to_string(n[i]) + " : 0") << endl;
+      }
+      g.body << "      j++;" << endl
+             << "    }" << endl;
+    }
+    g.body << "    if (j==" << k_out.size() << ") break;" << endl
+           << "    " << g.copy("x", nx_, "x_prev") << endl
+           << "    " << g.copy("Z", nZ_, "Z_prev") << endl
+           << "    " << g.copy("q", nq_, "q_prev") << endl
+           << "    if (" << g(F, "arg1", "res1", "iw", "w") << ") return 1;" << endl;
+    g.addAuxiliary(CodeGenerator::AUX_AXPY);
+    g.body << "    axpy(" << nq_ << ", 1., q_prev, q);" << endl;
+    if (nrx_>0) {
+      g.body << "    " << g.copy("x", nx_, "x_tape+(k+1)*" + g.to_string(nx_)) << endl
+             << "    " << g.copy("Z", nZ_, "Z_tape+k*" + g.to_string(nZ_)) << endl;
+    }
+    g.body << "    *t = " << t0 << " + (k+1)*" << h << ";" << endl
+           << "  }" << endl;
+
+    // Quick return if no backward problem
+    if (nrx_==0) return;
+    const Function& G = getExplicitB();
+
+    // Reset the backward problem
+    g.body << "  *t = " << g.constant(grid_.back()) << ";" << endl
+           << "  " << g.copy("arg[" + g.to_string(INTEGRATOR_RX0) + "]", nrx_, "rx") << endl
+           << "  " << g.copy("arg[" + g.to_string(INTEGRATOR_RZ0) + "]", nrz_, "rz") << endl
+           << "  " << g.fill("rq", nrq_, "0") << endl;
+    generate_guess(g, true, "rx", "rz", "RZ");
+
+    // Discrete time dynamics function inputs and outputs
+    g.body << "  arg1[" << RDAE_T << "] = t;" << endl
+           << "  arg1[" << RDAE_P << "] = arg[" << INTEGRATOR_P << "];" << endl
+           << "  arg1[" << RDAE_RX << "] = rx_prev;" << endl
+           << "  arg1[" << RDAE_RZ << "] = RZ_prev;" << endl
+           << "  arg1[" << RDAE_RP << "] = arg[" << INTEGRATOR_RP << "];" << endl
+           << "  res1[" << RDAE_ODE << "] = rx;" << endl
+           << "  res1[" << RDAE_ALG << "] = RZ;" << endl
+           << "  res1[" << RDAE_QUAD << "] = rq;" << endl;
+
+    // Take time steps back to the beginning
+    g.body << "  for (k=" << (nk_-1) << "; k>=0; --k) {" << endl
+           << "    *t = " << t0 << " + k*" << h << ";" << endl
+           << "    " << g.copy("rx", nrx_, "rx_prev") << endl
+           << "    " << g.copy("RZ", nRZ_, "RZ_prev") << endl
+           << "    " << g.copy("rq", nrq_, "rq_prev") << endl
+           << "    arg1[" << RDAE_X << "] = x_tape+k*" << nx_ << ";" << endl
+           << "    arg1[" << RDAE_Z << "] = Z_tape+k*" << nZ_ << ";" << endl
+           << "    if (" << g(G, "arg1", "res1", "iw", "w") << ") return 1;" << endl
+           << "    axpy(" << nrq_ << ", 1., rq_prev, rq);" << endl
+           << "  }" << endl;
+
+    // Return to user
+    g.body << "  " << g.copy("rx", nrx_, "res[" + g.to_string(INTEGRATOR_RXF) + "]") << endl
+           << "  " << g.copy("RZ+" + g.to_string(nRZ_-nrz_), nrz_,
+                             "res[" + g.to_string(INTEGRATOR_RZF) + "]") << endl
+           << "  " << g.copy("rq", nrq_, "res[" + g.to_string(INTEGRATOR_RQF) + "]") << endl;
+  }
+
   ImplicitFixedStepIntegrator::
   ImplicitFixedStepIntegrator(const std::string& name, Oracle* dae)
     : FixedStepIntegrator(name, dae) {
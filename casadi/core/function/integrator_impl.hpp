@@ -375,6 +375,16 @@ namespace casadi {
     /// Get explicit dynamics (backward problem)
     virtual const Function& getExplicitB() const { return G_;}
 
+    /** \brief Generate code for the declarations of the C function */
+    virtual void generateDeclarations(CodeGenerator& g) const;
+
+    /** \brief Generate code for the body of the C function */
+    virtual void generateBody(CodeGenerator& g) const;
+
+    /// Generate code for the initial guess of the discrete time algebraic variables
+    virtual void generate_guess(CodeGenerator& g, bool backward, const std::string& x,
+                                const std::string& z, const std::string& Z) const;
+
     // Discrete time dynamics
     Function F_, G_;
 
@@ -0,0 +1,176 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+
+#include "jacobian_product.hpp"
+
+using namespace std;
+
+namespace casadi {
+
+  JacobianProduct::JacobianProduct() : ndir_(0), reverse_(false), eval_out_(false) {
+  }
+
+  JacobianProduct::JacobianProduct(const Function& f, int ndir, bool reverse)
+    : f_(f), ndir_(ndir), reverse_(reverse) {
+    casadi_assert(!f_.is_null());
+    casadi_assert_message(ndir_>=1, "JacobianProduct: Number of directions must be positive");
+    int n_in = f_.n_in(), n_out = f_.n_out();
+    df_ = reverse_ ? f_.reverse(ndir_) : f_.forward(ndir_);
+
+    // Nondifferentiated outputs only need to be calculated if they are used,
+    // for SX and MX functions they are empty placeholders
+    eval_out_ = false;
+    for (int i=0; i<n_out; ++i) eval_out_ = eval_out_ || df_.nnz_in(n_in+i)>0;
+
+    // Seeds and sensitivities must have the sparsity of the inputs and outputs
+    bool consistent = true;
+    vector<Sparsity> sp_in(df_.n_in()), sp_out(df_.n_out());
+    for (int k=0; k<df_.n_in(); ++k) {
+      if (k<n_in+n_out) {
+        sp_in[k] = df_.sparsity_in(k);
+      } else {
+        int i = (k-n_in-n_out) % n_seed();
+        sp_in[k] = reverse_ ? f_.sparsity_out(i) : f_.sparsity_in(i);
+        consistent = consistent && sp_in[k]==df_.sparsity_in(k);
+      }
+    }
+    for (int k=0; k<df_.n_out(); ++k) {
+      int i = k % n_sens();
+      sp_out[k] = reverse_ ? f_.sparsity_in(i) : f_.sparsity_out(i);
+      consistent = consistent && sp_out[k]==df_.sparsity_out(k);
+    }
+
+    // Project, if needed
+    if (!consistent) {
+      vector<MX> arg(sp_in.size()), arg1(sp_in.size());
+      for (int k=0; k<arg.size(); ++k) {
+        arg[k] = MX::sym(df_.name_in(k), sp_in[k]);
+        arg1[k] = project(arg[k], df_.sparsity_in(k));
+      }
+      vector<MX> res = df_(arg1);
+      for (int k=0; k<res.size(); ++k) res[k] = project(res[k], sp_out[k]);
+      df_ = Function("proj_" + df_.name(), arg, res, df_.name_in(), df_.name_out());
+    }
+
+    // Allocate work vectors
+    size_t sz_arg, sz_res, sz_iw, sz_w;
+    sz_work(sz_arg, sz_res, sz_iw, sz_w);
+    arg_.resize(sz_arg);
+    res_.resize(sz_res);
+    iw_.resize(sz_iw);
+    w_.resize(sz_w);
+  }
+
+  int JacobianProduct::n_seed() const {
+    return reverse_ ? f_.n_out() : f_.n_in();
+  }
+
+  int JacobianProduct::n_sens() const {
+    return reverse_ ? f_.n_in() : f_.n_out();
+  }
+
+  vector<DM> JacobianProduct::call(const vector<DM>& x, const vector<DM>& v) {
+    casadi_assert(!is_null());
+    int n_in = f_.n_in(), n_out = f_.n_out();
+    casadi_assert_message(x.size()==n_in, "JacobianProduct: Expected " << n_in
+                          << " inputs, got " << x.size());
+    casadi_assert_message(v.size()==ndir_*n_seed(), "JacobianProduct: Expected "
+                          << ndir_*n_seed() << " seeds, got " << v.size());
+
+    // Inputs and seeds with the expected sparsity
+    vector<DM> x1(n_in), v1(v.size());
+    vector<const double*> xp(n_in), vp(v.size());
+    for (int i=0; i<n_in; ++i) {
+      x1[i] = project(x[i], f_.sparsity_in(i));
+      xp[i] = x1[i].ptr();
+    }
+    for (int k=0; k<v.size(); ++k) {
+      int i = k % n_seed();
+      v1[k] = project(v[k], reverse_ ? f_.sparsity_out(i) : f_.sparsity_in(i));
+      vp[k] = v1[k].ptr();
+    }
+
+    // Sensitivities
+    vector<DM> ret(ndir_*n_sens());
+    vector<double*> rp(ret.size());
+    for (int k=0; k<ret.size(); ++k) {
+      int i = k % n_sens();
+      ret[k] = DM::zeros(reverse_ ? f_.sparsity_in(i) : f_.sparsity_out(i));
+      rp[k] = ret[k].ptr();
+    }
+    (*this)(get_ptr(xp), get_ptr(vp), get_ptr(rp));
+    return ret;
+  }
+
+  void JacobianProduct::sz_work(size_t& sz_arg, size_t& sz_res,
+                                size_t& sz_iw, size_t& sz_w) const {
+    df_.sz_work(sz_arg, sz_res, sz_iw, sz_w);
+    if (eval_out_) {
+      size_t f_sz_arg, f_sz_res, f_sz_iw, f_sz_w;
+      f_.sz_work(f_sz_arg, f_sz_res, f_sz_iw, f_sz_w);
+      sz_arg = max(sz_arg, f_sz_arg);
+      sz_res = max(sz_res, f_sz_res);
+      sz_iw = max(sz_iw, f_sz_iw);
+      sz_w = max(sz_w, f_sz_w) + f_.nnz_out();
+    }
+  }
+
+  void JacobianProduct::operator()(const double** x, const double** v, double** r,
+                                   const double** y) {
+    (*this)(x, v, r, y, get_ptr(arg_), get_ptr(res_), get_ptr(iw_), get_ptr(w_));
+  }
+
+  void JacobianProduct::operator()(const double** x, const double** v, double** r,
+                                   const double** y, const double** arg, double** res,
+                                   int* iw, double* w) const {
+    casadi_assert(!is_null());
+    int n_in = f_.n_in(), n_out = f_.n_out();
+
+    // Nondifferentiated outputs
+    if (eval_out_ && y==0) {
+      double* out = w;
+      w += f_.nnz_out();
+      copy(x, x+n_in, arg);
+      for (int i=0; i<n_out; ++i) {
+        res[i] = out;
+        out += f_.nnz_out(i);
+      }
+      f_(arg, res, iw, w, 0);
+      copy(res, res+n_out, arg+n_in);
+    } else if (y) {
+      copy(y, y+n_out, arg+n_in);
+    } else {
+      fill_n(arg+n_in, n_out, nullptr);
+    }
+
+    // Evaluate the derivative function
+    copy(x, x+n_in, arg);
+    copy(v, v+ndir_*n_seed(), arg+n_in+n_out);
+    copy(r, r+ndir_*n_sens(), res);
+    df_(arg, res, iw, w, 0);
+  }
+
+} // namespace casadi
@@ -0,0 +1,126 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifndef CASADI_JACOBIAN_PRODUCT_HPP
+#define CASADI_JACOBIAN_PRODUCT_HPP
+
+#include "function.hpp"
+
+namespace casadi {
+
+  /** \brief Matrix-free Jacobian-vector (J*v) or vector-Jacobian (v^T*J) products
+
+      Evaluates the forward or reverse mode derivative function of a Function on raw
+      buffers, for one or several directions per call, with work vectors that are
+      either owned by the object or provided by the caller, cf. Function::jvp and
+      Function::vjp. Intended for Krylov methods and other matrix-free algorithms.
+
+      Seeds and sensitivities are given one direction at a time. For J*v,
+      <tt>v[d*n_in + i]</tt> is the seed for input i and <tt>r[d*n_out + j]</tt>
+      receives the sensitivity of output j in direction d, with the sparsity patterns
+      of the corresponding input and output. For v^T*J the roles of inputs and outputs
+      are exchanged. Null seeds are zero and null sensitivities are not calculated.
+
+      The nondifferentiated outputs are only calculated if the derivative function
+      depends on them and they are not provided by the caller.
+  */
+  class CASADI_EXPORT JacobianProduct {
+  public:
+    /// Default constructor, null object
+    JacobianProduct();
+
+    /// Create a product object for \a ndir forward (J*v) or reverse (v^T*J) directions
+    JacobianProduct(const Function& f, int ndir=1, bool reverse=false);
+
+    /// Is the object null
+    bool is_null() const { return f_.is_null();}
+
+    /// Function being differentiated
+    const Function& function() const { return f_;}
+
+    /// Derivative function being evaluated
+    const Function& derivative() const { return df_;}
+
+    /// Number of directions
+    int n_dir() const { return ndir_;}
+
+    /// Reverse mode, i.e. vector-Jacobian products
+    bool is_reverse() const { return reverse_;}
+
+    /// Number of seeds per direction, n_in for J*v and n_out for v^T*J
+    int n_seed() const;
+
+    /// Number of sensitivities per direction, n_out for J*v and n_in for v^T*J
+    int n_sens() const;
+
+    /** \brief Evaluate with DM arguments
+     *
+     * \param x Nondifferentiated inputs, n_in
+     * \param v Seeds, n_dir*n_seed, with the shapes of the inputs (J*v) or outputs (v^T*J)
+     * \return Sensitivities, n_dir*n_sens
+     */
+    std::vector<DM> call(const std::vector<DM>& x, const std::vector<DM>& v);
+
+#ifndef SWIG
+    /// Get the work vector sizes needed for evaluating with external work vectors
+    void sz_work(size_t& sz_arg, size_t& sz_res, size_t& sz_iw, size_t& sz_w) const;
+
+    /** \brief Evaluate with work vectors owned by the object, not thread-safe
+     *
+     * \param x Nondifferentiated inputs, n_in pointers
+     * \param v Seeds, n_dir*n_seed pointers
+     * \param r Sensitivities, n_dir*n_sens pointers
+     * \param y Nondifferentiated outputs, n_out pointers, if available
+     */
+    void operator()(const double** x, const double** v, double** r, const double** y=0);
+
+    /// Evaluate with work vectors provided by the caller, cf. sz_work
+    void operator()(const double** x, const double** v, double** r, const double** y,
+                    const double** arg, double** res, int* iw, double* w) const;
+
+  private:
+    // Function and its derivative
+    Function f_, df_;
+
+    // Number of directions
+    int ndir_;
+
+    // Reverse mode
+    bool reverse_;
+
+    // Do the nondifferentiated outputs need to be calculated
+    bool eval_out_;
+
+    // Work vectors
+    std::vector<const double*> arg_;
+    std::vector<double*> res_;
+    std::vector<int> iw_;
+    std::vector<double> w_;
+#endif // SWIG
+  };
+
+} // namespace casadi
+
+#endif // CASADI_JACOBIAN_PRODUCT_HPP
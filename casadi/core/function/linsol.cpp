@@ -25,6 +25,7 @@
 
 #include "linsol_impl.hpp"
 #include "../std_vector_tools.hpp"
+#include "../casadi_trace.hpp"
 #include "../mx/mx_node.hpp"
 #include <typeinfo>
 
@@ -101,10 +102,12 @@ namespace casadi {
   }
 
   void Function::linsol_factorize(const double* A, int mem) const {
+    TraceScope trace(name(), "linsol_factorize");
     (*this)->linsol_factorize(memory(mem), A);
   }
 
   void Function::linsol_solve(double* x, int nrhs, bool tr, int mem) const {
+    TraceScope trace(name(), "linsol_solve");
     (*this)->linsol_solve(memory(mem), x, nrhs, tr);
   }
 
@@ -93,7 +93,10 @@ namespace casadi {
       if (parallelization == "serial") {
         return new MapSumSerial(name, f, n, repeat_in, repeat_out);
       } else {
-        if (parallelization == "openmp") {
+        if (parallelization == "thread") {
+          casadi_warning("Thread parallelization not yet supported for reductions. "
+                         "Falling back to serial mode.");
+        } else if (parallelization == "openmp") {
           if (reduce_out.size()>0) {
             casadi_warning("OpenMP not yet supported for reduced outputs. "
                            "Falling back to serial mode.");
@@ -112,6 +115,8 @@ namespace casadi {
 
     if (parallelization == "serial") {
       return new MapSerial(name, f, n);
+    } else if (parallelization == "thread") {
+      return new MapThread(name, f, n);
     } else {
       if (parallelization== "openmp") {
         #ifdef WITH_OPENMP
@@ -243,6 +248,33 @@ namespace casadi {
     return df.map(name, parallelization(), n_, opts);
   }
 
+  Sparsity PureMap::getJacSparsity(int iind, int oind, bool symmetric) {
+    // Instances are independent: repeat the pattern of f_ along the diagonal
+    return Sparsity::kron(Sparsity::diag(n_), f_.sparsity_jac(iind, oind, true, symmetric));
+  }
+
+  Function PureMap
+  ::getJacobian(const std::string& name, int iind, int oind, bool compact, bool symmetric,
+                const Dict& opts) {
+    // Jacobian of the mapped function, evaluated for all instances
+    Function jf = f_.jacobian(iind, oind, compact, symmetric);
+    Dict map_opts;
+    propagate_options(map_opts);
+    Function jf_map = jf.map(name + "_map", parallelization(), n_, map_opts);
+
+    // Evaluate symbolically
+    std::vector<MX> arg = mx_in();
+    std::vector<MX> res = jf_map(arg);
+
+    // The Jacobian blocks are concatenated horizontally, place them on the diagonal
+    if (jf.size2_out(0)>0) {
+      res[0] = diagcat(horzsplit(res[0], jf.size2_out(0)));
+    } else {
+      res[0] = MX(n_*jf.size1_out(0), 0);
+    }
+    return Function(name, arg, res, opts);
+  }
+
   MapSum::MapSum(const std::string& name, const Function& f, int n,
                        const std::vector<bool> &repeat_in,
                        const std::vector<bool> &repeat_out)
@@ -547,6 +579,48 @@ namespace casadi {
     evalGen<double>(arg, res, iw, w, std::plus<double>());
   }
 
+  MapThread::~MapThread() {
+  }
+
+  void MapThread::init(const Dict& opts) {
+    // Call the initialization method of the base class
+    PureMap::init(opts);
+
+    // Allocate sufficient memory for parallel evaluation
+    alloc_arg(f_.sz_arg() * n_);
+    alloc_res(f_.sz_res() * n_);
+    alloc_w(f_.sz_w() * n_);
+    alloc_iw(f_.sz_iw() * n_);
+  }
+
+  void MapThread::eval(void* mem, const double** arg, double** res, int* iw, double* w) const {
+    size_t sz_arg, sz_res, sz_iw, sz_w;
+    f_.sz_work(sz_arg, sz_res, sz_iw, sz_w);
+
+    AsyncExecutor::parallel_for(n_, [&](int i) {
+        const double** arg_i = arg + n_in_ + sz_arg*i;
+        for (int j=0; j<n_in_; ++j) {
+          arg_i[j] = arg[j] ? arg[j]+i*f_.nnz_in(j) : 0;
+        }
+        double** res_i = res + n_out_ + sz_res*i;
+        for (int j=0; j<n_out_; ++j) {
+          res_i[j] = res[j] ? res[j]+i*f_.nnz_out(j) : 0;
+        }
+        int* iw_i = iw + i*sz_iw;
+        double* w_i = w + i*sz_w;
+
+        // Memory object of its own, since instances run concurrently
+        int mem_i = f_->checkout();
+        try {
+          f_->_eval(arg_i, res_i, iw_i, w_i, mem_i);
+        } catch (...) {
+          f_->release(mem_i);
+          throw;
+        }
+        f_->release(mem_i);
+      });
+  }
+
 #ifdef WITH_OPENMP
 
   MapOmp::~MapOmp() {
@@ -594,6 +668,7 @@ namespace casadi {
   }
 
   void MapOmp::generateBody(CodeGenerator& g) const {
+    casadi_assert_message(!g.embedded, "OpenMP parallelization not supported in embedded mode");
     size_t sz_arg, sz_res, sz_iw, sz_w;
     f_.sz_work(sz_arg, sz_res, sz_iw, sz_w);
 
@@ -160,6 +160,13 @@ namespace casadi {
     virtual int get_n_reverse() const { return 64;}
     ///@}
 
+    /** \brief Jacobian sparsity, block diagonal with the pattern of \a f_ */
+    virtual Sparsity getJacSparsity(int iind, int oind, bool symmetric);
+
+    /** \brief Jacobian, a map of the Jacobian of \a f_ */
+    virtual Function getJacobian(const std::string& name, int iind, int oind,
+                                 bool compact, bool symmetric, const Dict& opts);
+
   };
 
 
@@ -299,6 +306,28 @@ namespace casadi {
 
   };
 
+  /** A map Evaluate in parallel using the worker threads of the AsyncExecutor */
+  class CASADI_EXPORT MapThread : public PureMap {
+    friend class PureMap;
+    friend class MapBase;
+  protected:
+    // Constructor (protected, use create function in MapBase)
+    MapThread(const std::string& name, const Function& f, int n) : PureMap(name, f, n) {}
+
+    /** \brief  Destructor */
+    virtual ~MapThread();
+
+    /// Evaluate the function numerically
+    virtual void eval(void* mem, const double** arg, double** res, int* iw, double* w) const;
+
+    /** \brief  Initialize */
+    virtual void init(const Dict& opts);
+
+    /// Type of parallellization
+    virtual std::string parallelization() const { return "thread"; }
+
+  };
+
 #ifdef WITH_OPENMP
   /** A map Evaluate in parallel using OpenMP
       \author Joel Andersson
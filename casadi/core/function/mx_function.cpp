@@ -29,6 +29,7 @@
 #include "../casadi_interrupt.hpp"
 
 #include <stack>
+#include <chrono>
 #include <typeinfo>
 
 using namespace std;
@@ -358,6 +359,17 @@ namespace casadi {
       }
     }
 
+    // Profiling data, one entry per algorithm element
+    if (profile_) {
+      profile_ops_.clear();
+      for (int k=0; k<algorithm_.size(); ++k) {
+        const AlgEl& e = algorithm_[k];
+        const char* op_name = casadi_math<double>::name(e.op);
+        profile_ops_.push_back(ProfileEntry(k, op_name ? op_name : "unknown",
+                                            e.op==OP_CALL ? e.data->getFunction(0) : Function()));
+      }
+    }
+
     // Does any embedded function have reference counting for codegen?
     for (auto&& a : algorithm_) {
       if (!a.data.is_null() && a.data->has_refcount()) {
@@ -383,9 +395,20 @@ namespace casadi {
                    << free_vars_ << " are free.");
     }
 
+    // Profiling, with timing of each algorithm element
+    typedef std::chrono::steady_clock clock;
+    clock::time_point t_start, t0;
+    vector<double> t_op;
+    if (profile_) {
+      t_start = clock::now();
+      t_op.resize(algorithm_.size(), 0);
+    }
+
     // Evaluate all of the nodes of the algorithm:
     // should only evaluate nodes that have not yet been calculated!
-    for (auto&& e : algorithm_) {
+    for (int k=0; k<algorithm_.size(); ++k) {
+      const AlgEl& e = algorithm_[k];
+      if (profile_) t0 = clock::now();
       if (e.op==OP_INPUT) {
         // Pass an input
         double *w1 = w+workloc_[e.res.front()];
@@ -409,9 +432,19 @@ namespace casadi {
         for (int i=0; i<e.res.size(); ++i)
           res1[i] = e.res[i]>=0 ? w+workloc_[e.res[i]] : 0;
 
+        // Respond to cancellation of asynchronous evaluations
+        if (e.op==OP_CALL) InterruptHandler::check_cancelled();
+
         // Evaluate
         e.data->eval(arg1, res1, iw, w, 0);
       }
+      if (profile_) t_op[k] = std::chrono::duration<double>(clock::now() - t0).count();
+    }
+
+    // Each element is evaluated once
+    if (profile_) {
+      profile_add(std::chrono::duration<double>(clock::now() - t_start).count(),
+                  vector<long>(algorithm_.size(), 1), t_op);
     }
 
     casadi_msg("MXFunction::eval():end "  << name_);
@@ -468,6 +501,79 @@ namespace casadi {
     }
   }
 
+  size_t MXFunction::graph_bytes() const {
+    size_t ret = 0;
+    for (auto&& e : algorithm_) {
+      if (e.op==OP_OUTPUT) continue;
+      ret += sizeof(MXNode) + e.data->ndep()*sizeof(MX);
+      // Numerical values of constants
+      if (e.op==OP_CONST) ret += e.data.nnz()*sizeof(double);
+    }
+    for (auto&& e : free_vars_) ret += sizeof(MXNode);
+    return ret;
+  }
+
+  size_t MXFunction::algorithm_bytes() const {
+    size_t ret = algorithm_.capacity()*sizeof(AlgEl) + workloc_.capacity()*sizeof(int)
+      + default_in_.capacity()*sizeof(double);
+    for (auto&& e : algorithm_) {
+      ret += (e.arg.capacity() + e.res.capacity())*sizeof(int);
+    }
+    return ret;
+  }
+
+  size_t MXFunction::get_structural_hash() const {
+    size_t h = 0;
+    for (auto&& e : algorithm_) {
+      hash_combine(h, e.op);
+      hash_combine(h, e.arg.size());
+      hash_combine(h, get_ptr(e.arg), e.arg.size());
+      hash_combine(h, e.res.size());
+      hash_combine(h, get_ptr(e.res), e.res.size());
+      if (e.op==OP_INPUT || e.op==OP_OUTPUT) continue;
+
+      // Node-specific data, e.g. nonzero indices, is part of the printed expression
+      hash_combine(h, e.data.sparsity().hash());
+      stringstream ss;
+      print(ss, e);
+      for (char c : ss.str()) hash_combine(h, c);
+
+      // Embedded functions must be hashable
+      for (int i=0; i<e.data->numFunctions(); ++i) {
+        size_t h_i = e.data->getFunction(i)->structural_hash();
+        if (h_i==0) return 0;
+        hash_combine(h, h_i);
+      }
+    }
+    hash_combine(h, free_vars_.size());
+    return h==0 ? 1 : h;
+  }
+
+  bool MXFunction::get_structural_fingerprint(std::vector<int>& fp) const {
+    for (auto&& e : algorithm_) {
+      fp.push_back(e.op);
+      fp.push_back(e.arg.size());
+      fp.insert(fp.end(), e.arg.begin(), e.arg.end());
+      fp.push_back(e.res.size());
+      fp.insert(fp.end(), e.res.begin(), e.res.end());
+      if (e.op==OP_INPUT || e.op==OP_OUTPUT) continue;
+
+      // Node-specific data, as in get_structural_hash
+      vector<int> sp = e.data.sparsity().compress();
+      fp.insert(fp.end(), sp.begin(), sp.end());
+      stringstream ss;
+      print(ss, e);
+      string s = ss.str();
+      fp.push_back(s.size());
+      fp.insert(fp.end(), s.begin(), s.end());
+      for (int i=0; i<e.data->numFunctions(); ++i) {
+        if (!e.data->getFunction(i)->structural_fingerprint(fp)) return false;
+      }
+    }
+    fp.push_back(free_vars_.size());
+    return true;
+  }
+
   void MXFunction::spFwd(const bvec_t** arg, bvec_t** res, int* iw, bvec_t* w, int mem) {
     // Temporaries to hold pointers to operation input and outputs
     const bvec_t** arg1=arg+n_in();
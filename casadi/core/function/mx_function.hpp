@@ -197,6 +197,18 @@ namespace casadi {
     /** \brief Number of nodes in the algorithm */
     virtual int n_nodes() const { return algorithm_.size();}
 
+    /** \brief Memory held by the expression graph [bytes], estimate */
+    virtual size_t graph_bytes() const;
+
+    /** \brief Memory held by the algorithm [bytes], estimate */
+    virtual size_t algorithm_bytes() const;
+
+    /** \brief Hash of the structure of the algorithm */
+    virtual std::size_t get_structural_hash() const;
+
+    /** \brief Structure of the algorithm */
+    virtual bool get_structural_fingerprint(std::vector<int>& fp) const;
+
     /** \brief Get default input value */
     virtual double default_in(int ind) const { return default_in_.at(ind);}
   };
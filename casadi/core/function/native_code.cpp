@@ -0,0 +1,368 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+
+#include "native_code.hpp"
+#include "sx_function.hpp"
+#include <cstring>
+#include <cmath>
+#include <stdint.h>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define CASADI_NATIVE_X86_64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+namespace casadi {
+
+#ifdef CASADI_NATIVE_X86_64
+  namespace {
+    typedef double (*UnaryFcn)(double);
+    typedef double (*BinaryFcn)(double, double);
+
+    // Operations without a native instruction sequence or a libm counterpart
+    double native_fallback(double x, double y, int op) {
+      double f;
+      casadi_math<double>::fun(op, x, y, f);
+      return f;
+    }
+
+    // libm functions matching the interpreter
+    UnaryFcn libm_unary(int op) {
+      switch (op) {
+      case OP_SIN: return static_cast<UnaryFcn>(std::sin);
+      case OP_COS: return static_cast<UnaryFcn>(std::cos);
+      case OP_TAN: return static_cast<UnaryFcn>(std::tan);
+      case OP_ASIN: return static_cast<UnaryFcn>(std::asin);
+      case OP_ACOS: return static_cast<UnaryFcn>(std::acos);
+      case OP_ATAN: return static_cast<UnaryFcn>(std::atan);
+      case OP_SINH: return static_cast<UnaryFcn>(std::sinh);
+      case OP_COSH: return static_cast<UnaryFcn>(std::cosh);
+      case OP_TANH: return static_cast<UnaryFcn>(std::tanh);
+      case OP_EXP: return static_cast<UnaryFcn>(std::exp);
+      case OP_LOG: return static_cast<UnaryFcn>(std::log);
+      case OP_FLOOR: return static_cast<UnaryFcn>(std::floor);
+      case OP_CEIL: return static_cast<UnaryFcn>(std::ceil);
+      default: return 0;
+      }
+    }
+    BinaryFcn libm_binary(int op) {
+      switch (op) {
+      case OP_POW: case OP_CONSTPOW: return static_cast<BinaryFcn>(std::pow);
+      case OP_ATAN2: return static_cast<BinaryFcn>(std::atan2);
+      case OP_FMOD: return static_cast<BinaryFcn>(std::fmod);
+      default: return 0;
+      }
+    }
+
+    // Registers
+    enum {RAX=0, RBX=3, R14=14, R15=15};
+
+    // Bit patterns of constants
+    uint64_t bits(double v) {
+      uint64_t r;
+      memcpy(&r, &v, sizeof(r));
+      return r;
+    }
+    const uint64_t SIGN_MASK = 0x8000000000000000ULL;
+    const uint64_t ABS_MASK = 0x7fffffffffffffffULL;
+
+    /* x86-64 emitter, System V calling convention. arg, res and w are kept in the
+       callee-saved registers r14, r15 and rbx. xmm0 and xmm1 are scratch registers,
+       xmm2-xmm15 cache work vector entries. The cache is write-through, so that
+       entries can be dropped at any time, e.g. when calling into libm. */
+    class X86Emitter {
+    public:
+      vector<unsigned char> code;
+
+      X86Emitter() : next_(FIRST) { clobber();}
+
+      void byte(int b) { code.push_back(static_cast<unsigned char>(b));}
+      void int32(int v) { for (int k=0; k<4; ++k) byte(v >> (8*k));}
+      void int64(uint64_t v) { for (int k=0; k<8; ++k) byte(static_cast<int>(v >> (8*k)));}
+
+      // SSE2 instruction, register-register
+      void sse(int prefix, int opcode, int dst, int src) {
+        byte(prefix);
+        if (dst>=8 || src>=8) byte(0x40 | (dst>=8)<<2 | (src>=8));
+        byte(0x0f);
+        byte(opcode);
+        byte(0xc0 | (dst&7)<<3 | (src&7));
+      }
+
+      // SSE2 instruction, register-memory at [base + disp32]
+      void sse_mem(int prefix, int opcode, int reg, int base, int disp) {
+        byte(prefix);
+        if (reg>=8 || base>=8) byte(0x40 | (reg>=8)<<2 | (base>=8));
+        byte(0x0f);
+        byte(opcode);
+        byte(0x80 | (reg&7)<<3 | (base&7));
+        int32(disp);
+      }
+
+      // Scalar double instructions
+      void movapd(int dst, int src) { if (dst!=src) sse(0x66, 0x28, dst, src);}
+      void load(int dst, int base, int disp) { sse_mem(0xf2, 0x10, dst, base, disp);}
+      void store(int src, int base, int disp) { sse_mem(0xf2, 0x11, src, base, disp);}
+      void cmpsd(int dst, int src, int pred) { sse(0xf2, 0xc2, dst, src); byte(pred);}
+      void zero(int dst) { sse(0x66, 0x57, dst, dst);}
+
+      // mov reg64, [base + disp32]
+      void load_ptr(int reg, int base, int disp) {
+        byte(0x48 | (reg>=8)<<2 | (base>=8));
+        byte(0x8b);
+        byte(0x80 | (reg&7)<<3 | (base&7));
+        int32(disp);
+      }
+
+      // Load a bit pattern to an xmm register via rax
+      void constant(int dst, uint64_t v) {
+        byte(0x48); byte(0xb8); int64(v);                   // mov rax, imm64
+        byte(0x66); byte(0x48 | (dst>=8)<<2);               // movq xmm, rax
+        byte(0x0f); byte(0x6e); byte(0xc0 | (dst&7)<<3);
+      }
+
+      // Jump if rax is null, returns the position of the offset to be patched
+      int jump_if_null() {
+        byte(0x48); byte(0x85); byte(0xc0);                 // test rax, rax
+        byte(0x0f); byte(0x84); int32(0);                   // je rel32
+        return code.size();
+      }
+      void patch(int pos) {
+        int rel = code.size() - pos;
+        memcpy(&code[pos-4], &rel, 4);
+      }
+
+      // Call a function, all xmm registers are clobbered
+      void call(const void* f) {
+        uint64_t addr;
+        memcpy(&addr, &f, sizeof(addr));
+        byte(0x48); byte(0xb8); int64(addr);                // mov rax, imm64
+        byte(0xff); byte(0xd0);                             // call rax
+        clobber();
+      }
+
+      // Register holding a work vector entry, loading it if needed
+      int get(int slot, int pin=-1) {
+        for (int r=FIRST; r<NREG; ++r) if (slot_[r]==slot) return r;
+        int r = alloc(pin);
+        load(r, RBX, 8*slot);
+        slot_[r] = slot;
+        return r;
+      }
+
+      // Free register, not holding any of the pinned registers
+      int alloc(int pin1=-1, int pin2=-1) {
+        int r;
+        do {
+          r = next_++;
+          if (next_==NREG) next_ = FIRST;
+        } while (r==pin1 || r==pin2);
+        slot_[r] = -1;
+        return r;
+      }
+
+      // Write a register to the work vector, the register then holds the entry
+      void assign(int slot, int r) {
+        store(r, RBX, 8*slot);
+        for (int k=FIRST; k<NREG; ++k) if (slot_[k]==slot) slot_[k] = -1;
+        if (r>=FIRST) slot_[r] = slot;
+      }
+
+      // Forget all cached entries
+      void clobber() { fill(slot_, slot_+NREG, -1);}
+
+    private:
+      static const int FIRST = 2, NREG = 16;
+      int slot_[NREG], next_;
+    };
+  } // namespace
+#endif // CASADI_NATIVE_X86_64
+
+  bool NativeCode::is_supported() {
+#ifdef CASADI_NATIVE_X86_64
+    return true;
+#else // CASADI_NATIVE_X86_64
+    return false;
+#endif // CASADI_NATIVE_X86_64
+  }
+
+  NativeCode::NativeCode(const std::vector<ScalarAtomic>& algorithm)
+    : mem_(0), size_(0), mapped_(0), fcn_(0) {
+#ifdef CASADI_NATIVE_X86_64
+    X86Emitter a;
+
+    // Prologue: save callee-saved registers, which also aligns the stack for calls
+    a.byte(0x53);                               // push rbx
+    a.byte(0x41); a.byte(0x56);                 // push r14
+    a.byte(0x41); a.byte(0x57);                 // push r15
+    a.byte(0x48); a.byte(0x89); a.byte(0xd3);   // mov rbx, rdx (w)
+    a.byte(0x49); a.byte(0x89); a.byte(0xfe);   // mov r14, rdi (arg)
+    a.byte(0x49); a.byte(0x89); a.byte(0xf7);   // mov r15, rsi (res)
+
+    for (auto&& e : algorithm) {
+      int x, y, d, pos;
+      switch (e.op) {
+      case OP_CONST:
+        d = a.alloc();
+        a.constant(d, bits(e.d));
+        a.assign(e.i0, d);
+        break;
+      case OP_INPUT:
+        a.load_ptr(RAX, R14, 8*e.i1);
+        d = a.alloc();
+        a.zero(d);
+        pos = a.jump_if_null();
+        a.load(d, RAX, 8*e.i2);
+        a.patch(pos);
+        a.assign(e.i0, d);
+        break;
+      case OP_OUTPUT:
+        x = a.get(e.i1);
+        a.load_ptr(RAX, R15, 8*e.i0);
+        pos = a.jump_if_null();
+        a.store(x, RAX, 8*e.i2);
+        a.patch(pos);
+        break;
+      case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV:
+        x = a.get(e.i1);
+        y = a.get(e.i2, x);
+        d = a.alloc(x, y);
+        a.movapd(d, x);
+        a.sse(0xf2, e.op==OP_ADD ? 0x58 : e.op==OP_SUB ? 0x5c : e.op==OP_MUL ? 0x59 : 0x5e,
+              d, y);
+        a.assign(e.i0, d);
+        break;
+      case OP_FMIN: case OP_FMAX:
+        // minsd/maxsd return the second operand if unordered, as std::min/std::max
+        x = a.get(e.i1);
+        y = a.get(e.i2, x);
+        d = a.alloc(x, y);
+        a.movapd(d, y);
+        a.sse(0xf2, e.op==OP_FMIN ? 0x5d : 0x5f, d, x);
+        a.assign(e.i0, d);
+        break;
+      case OP_ASSIGN: case OP_SQ: case OP_TWICE: case OP_SQRT: case OP_NEG: case OP_FABS:
+      case OP_INV:
+        x = a.get(e.i1);
+        d = a.alloc(x);
+        if (e.op==OP_SQRT) {
+          a.sse(0xf2, 0x51, d, x);
+        } else if (e.op==OP_INV) {
+          a.constant(d, bits(1));
+          a.sse(0xf2, 0x5e, d, x);
+        } else {
+          a.movapd(d, x);
+          if (e.op==OP_SQ) a.sse(0xf2, 0x59, d, x);
+          if (e.op==OP_TWICE) a.sse(0xf2, 0x58, d, x);
+          if (e.op==OP_NEG || e.op==OP_FABS) {
+            a.constant(0, e.op==OP_NEG ? SIGN_MASK : ABS_MASK);
+            a.sse(0x66, e.op==OP_NEG ? 0x57 : 0x54, d, 0);  // xorpd/andpd
+          }
+        }
+        a.assign(e.i0, d);
+        break;
+      case OP_LT: case OP_LE: case OP_EQ: case OP_NE:
+        x = a.get(e.i1);
+        y = a.get(e.i2, x);
+        d = a.alloc(x, y);
+        a.movapd(d, x);
+        a.cmpsd(d, y, e.op==OP_LT ? 1 : e.op==OP_LE ? 2 : e.op==OP_EQ ? 0 : 4);
+        a.constant(0, bits(1));
+        a.sse(0x66, 0x54, d, 0);                   // andpd, mask to 1 or 0
+        a.assign(e.i0, d);
+        break;
+      case OP_NOT: case OP_AND: case OP_OR: case OP_IF_ELSE_ZERO:
+        x = a.get(e.i1);
+        y = a.get(e.i2, x);
+        d = a.alloc(x, y);
+        a.zero(1);
+        a.movapd(d, x);
+        a.cmpsd(d, 1, e.op==OP_NOT ? 0 : 4);      // x==0 or x!=0
+        if (e.op==OP_IF_ELSE_ZERO) {
+          a.sse(0x66, 0x54, d, y);                 // andpd, y or 0
+        } else {
+          if (e.op!=OP_NOT) {
+            a.movapd(0, y);
+            a.cmpsd(0, 1, 4);                      // y!=0
+            a.sse(0x66, e.op==OP_AND ? 0x54 : 0x56, d, 0);  // andpd/orpd
+          }
+          a.constant(0, bits(1));
+          a.sse(0x66, 0x54, d, 0);
+        }
+        a.assign(e.i0, d);
+        break;
+      default:
+        casadi_assert_message(e.op!=OP_PARAMETER && e.op<NUM_BUILT_IN_OPS,
+                              "NativeCode: Cannot translate operation " << e.op);
+        // Arguments are read from the work vector, which is always up to date
+        a.load(0, RBX, 8*e.i1);
+        if (libm_unary(e.op)) {
+          a.call(reinterpret_cast<const void*>(libm_unary(e.op)));
+        } else {
+          a.load(1, RBX, 8*e.i2);
+          if (libm_binary(e.op)) {
+            a.call(reinterpret_cast<const void*>(libm_binary(e.op)));
+          } else {
+            a.byte(0xbf); a.int32(e.op);            // mov edi, op
+            a.call(reinterpret_cast<const void*>(native_fallback));
+          }
+        }
+        a.assign(e.i0, 0);
+      }
+    }
+
+    // Epilogue
+    a.byte(0x41); a.byte(0x5f);                 // pop r15
+    a.byte(0x41); a.byte(0x5e);                 // pop r14
+    a.byte(0x5b);                               // pop rbx
+    a.byte(0xc3);                               // ret
+
+    // Copy to pages that are first writable, then executable
+    size_ = a.code.size();
+    size_t page = sysconf(_SC_PAGESIZE);
+    mapped_ = (size_ + page - 1)/page*page;
+    mem_ = mmap(0, mapped_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    casadi_assert_message(mem_!=MAP_FAILED, "NativeCode: mmap failed");
+    memcpy(mem_, &a.code.front(), size_);
+    if (mprotect(mem_, mapped_, PROT_READ | PROT_EXEC)!=0) {
+      munmap(mem_, mapped_);
+      casadi_error("NativeCode: mprotect failed");
+    }
+    memcpy(&fcn_, &mem_, sizeof(fcn_));
+#else // CASADI_NATIVE_X86_64
+    casadi_error("NativeCode: Native code emission requires x86-64 Linux or OS X");
+#endif // CASADI_NATIVE_X86_64
+  }
+
+  NativeCode::~NativeCode() {
+#ifdef CASADI_NATIVE_X86_64
+    if (mem_) munmap(mem_, mapped_);
+#endif // CASADI_NATIVE_X86_64
+  }
+
+} // namespace casadi
@@ -0,0 +1,83 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+
+#ifndef CASADI_NATIVE_CODE_HPP
+#define CASADI_NATIVE_CODE_HPP
+
+#include "../casadi_common.hpp"
+#include <vector>
+
+/// \cond INTERNAL
+
+namespace casadi {
+
+  struct ScalarAtomic;
+
+  /** \brief Machine code for an SXFunction algorithm, emitted in-process
+   *
+   * The algorithm is translated directly to x86-64 instructions (SSE2 scalar double
+   * arithmetic, a small write-through register cache, calls into libm for the
+   * transcendental operations) and placed in executable pages. No external compiler
+   * is involved.
+   */
+  class CASADI_EXPORT NativeCode {
+  public:
+    /// Signature of the emitted code
+    typedef void (*Fcn)(const double** arg, double** res, double* w);
+
+    /// Translate an algorithm
+    explicit NativeCode(const std::vector<ScalarAtomic>& algorithm);
+
+    /// Destructor, releases the executable pages
+    ~NativeCode();
+
+    /// Can native code be emitted on this platform?
+    static bool is_supported();
+
+    /// Evaluate numerically, w has the work vector size of the algorithm
+    void operator()(const double** arg, double** res, double* w) const { fcn_(arg, res, w);}
+
+    /// Size of the emitted code in bytes
+    size_t size() const { return size_;}
+
+  private:
+    // Not copyable
+    NativeCode(const NativeCode&);
+    NativeCode& operator=(const NativeCode&);
+
+    // Executable pages
+    void* mem_;
+    size_t size_, mapped_;
+
+    // Entry point
+    Fcn fcn_;
+  };
+
+} // namespace casadi
+
+/// \endcond
+
+#endif // CASADI_NATIVE_CODE_HPP
@@ -157,6 +157,7 @@ namespace casadi {
     warn_initial_bounds_ = false;
     iteration_callback_ignore_errors_ = false;
     print_time_ = true;
+    memoize_ = false;
   }
 
   Nlpsol::~Nlpsol() {
@@ -227,6 +228,11 @@ namespace casadi {
       {"print_time",
          {OT_BOOL,
           "print information about execution time"}},
+      {"memoize",
+       {OT_BOOL,
+        "Calculate the objective, constraints and their first order derivatives in "
+        "combined functions, sharing common subexpressions, and reuse the results "
+        "as long as x and p do not change [false]. Supported by ipopt and sqpmethod."}},
       {"verbose_init",
        {OT_BOOL,
         "Print out timing information about "
@@ -257,6 +263,8 @@ namespace casadi {
         iteration_callback_ignore_errors_ = op.second;
       } else if (op.first=="print_time") {
         print_time_ = op.second;
+      } else if (op.first=="memoize") {
+        memoize_ = op.second;
       }
     }
 
@@ -303,6 +311,16 @@ namespace casadi {
     m->fstats["mainloop"] = FStats();
     m->fstats["callback_fun"] = FStats();
     m->fstats["callback_prep"] = FStats();
+
+    // Memoized oracle outputs
+    if (!fg_fcn_.is_null()) {
+      m->memo_x.resize(nx_);
+      m->memo_p.resize(np_);
+      m->memo_g.resize(ng_);
+      m->memo_grad_f.resize(nx_);
+      m->memo_jac_g.resize(fg_jac_fcn_.nnz_out(3));
+    }
+    m->memo_fg = m->memo_jac = false;
   }
 
   void Nlpsol::checkInputs(void* mem) const {
@@ -365,6 +383,10 @@ namespace casadi {
     // Reset the solver, prepare for solution
     setup(mem, arg, res, iw, w);
 
+    // Memoized oracle outputs are invalid
+    auto m = static_cast<NlpsolMemory*>(mem);
+    m->memo_fg = m->memo_jac = false;
+
     // Solve the NLP
     solve(mem);
   }
@@ -615,6 +637,58 @@ namespace casadi {
     return 0;
   }
 
+  void Nlpsol::init_fg() {
+    if (!memoize_) return;
+    fg_fcn_ = create_function("nlp_fg", {"x", "p"}, {"f", "g"});
+    fg_jac_fcn_ = create_function("nlp_fg_jac", {"x", "p"}, {"f", "g", "grad_f_x", "jac_g_x"});
+  }
+
+  int Nlpsol::calc_fg(NlpsolMemory* m, const double* x, double* f, double* g,
+                      double* grad_f, double* jac_g) const {
+    casadi_assert(!fg_fcn_.is_null());
+
+    // Invalidate the memoized outputs if the point has changed
+    if ((m->memo_fg || m->memo_jac)
+        && !(equal(x, x+nx_, m->memo_x.begin())
+             && (m->p==0 ? all_of(m->memo_p.begin(), m->memo_p.end(),
+                                  [](double v) { return v==0;})
+                 : equal(m->p, m->p+np_, m->memo_p.begin())))) {
+      m->memo_fg = m->memo_jac = false;
+    }
+
+    // Calculate the requested outputs, if not available
+    bool need_jac = grad_f || jac_g;
+    if (need_jac ? !m->memo_jac : !m->memo_fg) {
+      int flag;
+      if (need_jac) {
+        flag = calc_function(m, fg_jac_fcn_, {x, m->p},
+                             {&m->memo_f, get_ptr(m->memo_g), get_ptr(m->memo_grad_f),
+                                 get_ptr(m->memo_jac_g)});
+      } else {
+        flag = calc_function(m, fg_fcn_, {x, m->p}, {&m->memo_f, get_ptr(m->memo_g)});
+      }
+      if (flag) {
+        m->memo_fg = m->memo_jac = false;
+        return flag;
+      }
+      copy(x, x+nx_, m->memo_x.begin());
+      if (m->p) {
+        copy(m->p, m->p+np_, m->memo_p.begin());
+      } else {
+        fill(m->memo_p.begin(), m->memo_p.end(), 0);
+      }
+      m->memo_fg = true;
+      m->memo_jac = need_jac;
+    }
+
+    // Copy to the output buffers
+    if (f) *f = m->memo_f;
+    if (g) copy(m->memo_g.begin(), m->memo_g.end(), g);
+    if (grad_f) copy(m->memo_grad_f.begin(), m->memo_grad_f.end(), grad_f);
+    if (jac_g) copy(m->memo_jac_g.begin(), m->memo_jac_g.end(), jac_g);
+    return 0;
+  }
+
   void Nlpsol::generate_dependencies(const std::string& fname, const Dict& opts) {
     CodeGenerator gen(opts);
     gen.add(nlp_->all_io("nlp"));
@@ -48,6 +48,16 @@ namespace casadi {
 
     // number of iterations
     int n_iter;
+
+    // Point at which the memoized oracle outputs were calculated
+    std::vector<double> memo_x, memo_p;
+
+    // Memoized oracle outputs
+    double memo_f;
+    std::vector<double> memo_g, memo_grad_f, memo_jac_g;
+
+    // Valid memoized outputs: objective and constraints, first order derivatives
+    bool memo_fg, memo_jac;
   };
 
   /** \brief NLP solver storage class
@@ -89,6 +99,12 @@ namespace casadi {
     // All NLP functions
     std::vector<Function> all_functions_;
 
+    // Evaluate the objective and constraints in combined functions, memoized on (x, p)
+    bool memoize_;
+
+    // Combined oracle functions: (f, g) and (f, g, grad_f, jac_g)
+    Function fg_fcn_, fg_jac_fcn_;
+
   private:
     /// The NLP
     Oracle* nlp_;
@@ -181,6 +197,19 @@ namespace casadi {
                       std::initializer_list<const double*> arg,
                       std::initializer_list<double*> res) const;
 
+    /** \brief Create the combined oracle functions, if memoization is enabled
+     * To be called from the init function of plugins using calc_fg
+     */
+    void init_fg();
+
+    /** \brief Calculate the objective, constraints and their first order derivatives
+     * Outputs that are null are not requested. The outputs are memoized and only
+     * recalculated when x or p change, with the first order derivatives calculated
+     * together with the objective and constraints in one evaluation.
+     */
+    int calc_fg(NlpsolMemory* m, const double* x, double* f, double* g,
+                double* grad_f, double* jac_g) const;
+
    /// Print statistics
    void print_fstats(const NlpsolMemory* m) const;
 
@@ -0,0 +1,262 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "sparsity_cache.hpp"
+#include "../global_options.hpp"
+#include "../std_vector_tools.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <random>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#include <sys/utime.h>
+#else // _WIN32
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#endif // _WIN32
+
+using namespace std;
+
+namespace casadi {
+
+  // File format identifier, increase when the format changes
+  static const char* sparsity_cache_magic = "casadi_sparsity_cache";
+  static const int sparsity_cache_version = 3;
+
+  bool SparsityCache::enabled() {
+    return !GlobalOptions::sparsity_cache_dir.empty();
+  }
+
+  string SparsityCache::entry_name(size_t key) {
+    stringstream ss;
+    ss << GlobalOptions::sparsity_cache_dir << "/sp_" << hex << key << ".txt";
+    return ss.str();
+  }
+
+  bool SparsityCache::write_file(const string& fname, const string& contents) {
+    // Unique name for the temporary file, also across processes
+    static std::random_device rd;
+    stringstream tmpname;
+    tmpname << fname << ".tmp" << hex << rd();
+
+    // Write to temporary file
+    {
+      ofstream f(tmpname.str().c_str());
+      if (!f.good()) return false;
+      f << contents;
+      f.close();
+      if (f.fail()) {
+        remove(tmpname.str().c_str());
+        return false;
+      }
+    }
+
+    // Atomically replace the destination (the remove is needed on Windows)
+    if (rename(tmpname.str().c_str(), fname.c_str())!=0) {
+      remove(fname.c_str());
+      if (rename(tmpname.str().c_str(), fname.c_str())!=0) {
+        remove(tmpname.str().c_str());
+        return false;
+      }
+    }
+    return true;
+  }
+
+  vector<SparsityCache::Entry> SparsityCache::entries() {
+    vector<Entry> ret;
+    const string& dir = GlobalOptions::sparsity_cache_dir;
+#ifdef _WIN32
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA((dir + "/sp_*.txt").c_str(), &fd);
+    if (h==INVALID_HANDLE_VALUE) return ret;
+    do {
+      ULARGE_INTEGER t;
+      t.LowPart = fd.ftLastWriteTime.dwLowDateTime;
+      t.HighPart = fd.ftLastWriteTime.dwHighDateTime;
+      ret.push_back(Entry(static_cast<long>(t.QuadPart/10000000),
+                          make_pair(static_cast<long>(fd.nFileSizeLow),
+                                    dir + "/" + fd.cFileName)));
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+#else // _WIN32
+    DIR* d = opendir(dir.c_str());
+    if (d==0) return ret;
+    while (dirent* e = readdir(d)) {
+      // Only complete entries, not temporary files being written
+      string fname = e->d_name;
+      if (fname.compare(0, 3, "sp_")!=0 || fname.size()<4
+          || fname.compare(fname.size()-4, 4, ".txt")!=0) continue;
+      string path = dir + "/" + fname;
+      struct stat st;
+      if (stat(path.c_str(), &st)!=0) continue;
+      ret.push_back(Entry(static_cast<long>(st.st_mtime),
+                          make_pair(static_cast<long>(st.st_size), path)));
+    }
+    closedir(d);
+#endif // _WIN32
+    return ret;
+  }
+
+  void SparsityCache::touch(const string& fname) {
+#ifdef _WIN32
+    _utime(fname.c_str(), 0);
+#else // _WIN32
+    utime(fname.c_str(), 0);
+#endif // _WIN32
+  }
+
+  void SparsityCache::evict(const string& keep) {
+    vector<Entry> e = entries();
+    long total = 0;
+    for (auto&& i : e) total += i.second.first;
+
+    // Remove least recently used first, never the entry just used. Another process
+    // may remove the same file concurrently, only count successful removals
+    sort(e.begin(), e.end());
+    for (auto&& i : e) {
+      if (total <= GlobalOptions::sparsity_cache_size) break;
+      if (i.second.second==keep) continue;
+      if (remove(i.second.second.c_str())==0) total -= i.second.first;
+    }
+  }
+
+  bool SparsityCache::load(size_t key, const vector<int>& fingerprint, vector<Sparsity>& sp) {
+    if (!enabled()) return false;
+    string fname = entry_name(key);
+    ifstream f(fname.c_str());
+    if (!f.good()) return false;
+
+    // Read and verify contents
+    bool ok = false, collision = false;
+    try {
+      string magic;
+      int version, n=-1, nfp;
+      size_t key_in, checksum_in;
+      f >> magic >> version >> hex >> key_in >> dec >> nfp;
+      if (f.good() && magic==sparsity_cache_magic && version==sparsity_cache_version
+          && key_in==key && nfp>=0) {
+        size_t checksum = 0;
+        hash_combine(checksum, key);
+
+        // Structural fingerprint
+        vector<int> fp(nfp);
+        for (int k=0; k<nfp; ++k) f >> fp[k];
+        hash_combine(checksum, nfp);
+        hash_combine(checksum, get_ptr(fp), nfp);
+
+        // Patterns
+        f >> n;
+        hash_combine(checksum, n);
+        if (!f.good() || n<0) n = 0;
+        vector<Sparsity> ret(n);
+        vector<int> v;
+        for (int i=0; i<n && f.good(); ++i) {
+          int flag, len;
+          f >> flag;
+          hash_combine(checksum, flag);
+          if (flag==0) continue;
+          f >> len;
+          if (!f.good() || len<0) break;
+          hash_combine(checksum, len);
+          v.resize(len);
+          for (int k=0; k<len; ++k) f >> v[k];
+          if (!f.good()) break;
+          hash_combine(checksum, get_ptr(v), len);
+          ret[i] = Sparsity::compressed(v);
+        }
+        f >> hex >> checksum_in;
+        if (!f.fail() && checksum_in==checksum) {
+          if (fp==fingerprint) {
+            sp = ret;
+            ok = true;
+          } else {
+            // Valid entry for a different function with the same key
+            collision = true;
+          }
+        }
+      }
+    } catch (exception&) {
+      ok = false;
+    }
+    f.close();
+
+    if (ok) {
+      touch(fname);
+    } else if (!collision) {
+      casadi_warning("SparsityCache: removing corrupt entry " + fname);
+      remove(fname.c_str());
+    }
+    return ok;
+  }
+
+  void SparsityCache::store(size_t key, const vector<int>& fingerprint,
+                            const vector<Sparsity>& sp) {
+    if (!enabled()) return;
+    stringstream ss;
+    size_t checksum = 0;
+    hash_combine(checksum, key);
+    hash_combine(checksum, fingerprint.size());
+    hash_combine(checksum, get_ptr(fingerprint), fingerprint.size());
+    hash_combine(checksum, sp.size());
+    ss << sparsity_cache_magic << " " << sparsity_cache_version << endl;
+    ss << hex << key << dec << endl;
+    ss << fingerprint.size();
+    for (int k : fingerprint) ss << " " << k;
+    ss << endl;
+    ss << sp.size() << endl;
+    for (auto&& s : sp) {
+      int flag = s.is_null() ? 0 : 1;
+      hash_combine(checksum, flag);
+      ss << flag;
+      if (flag) {
+        vector<int> v = s.compress();
+        hash_combine(checksum, v.size());
+        hash_combine(checksum, get_ptr(v), v.size());
+        ss << " " << v.size();
+        for (int k : v) ss << " " << k;
+      }
+      ss << endl;
+    }
+    ss << hex << checksum << endl;
+
+    // Write to disk, replacing any colliding entry, and enforce the size limit
+    string fname = entry_name(key);
+    if (write_file(fname, ss.str())) {
+      evict(fname);
+    } else {
+      casadi_warning("SparsityCache: cannot write " + fname);
+    }
+  }
+
+  void SparsityCache::clear() {
+    if (!enabled()) return;
+    for (auto&& e : entries()) remove(e.second.second.c_str());
+  }
+
+} // namespace casadi
@@ -0,0 +1,94 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifndef CASADI_SPARSITY_CACHE_HPP
+#define CASADI_SPARSITY_CACHE_HPP
+
+#include "../sparsity.hpp"
+
+#include <vector>
+
+/// \cond INTERNAL
+
+namespace casadi {
+
+  /** \brief Persistent on-disk cache of Jacobian sparsity patterns and seed matrices
+
+      The cache is enabled by setting GlobalOptions::sparsity_cache_dir to an
+      existing directory. Each entry is stored in a separate file, named after
+      its key, together with the structural fingerprint it was computed for, i.e.
+      the complete instruction stream and the input and output patterns, and a
+      checksum. Both are verified when loading, so that a hash collision never
+      returns the pattern of another function. There is no shared index:
+      the modification time of an entry records its last use, and the least
+      recently used entries are removed after a scan of the directory when the
+      total size exceeds GlobalOptions::sparsity_cache_size. Files are written
+      to a temporary name and then renamed, so that several processes can share
+      the same directory.
+  */
+  class CASADI_EXPORT SparsityCache {
+  private:
+    /// No instances are allowed
+    SparsityCache();
+  public:
+    /// Is the cache enabled?
+    static bool enabled();
+
+    /// Look up an entry, returns false if missing, corrupt or for another fingerprint
+    static bool load(std::size_t key, const std::vector<int>& fingerprint,
+                     std::vector<Sparsity>& sp);
+
+    /// Store an entry, evicting least recently used entries if needed
+    static void store(std::size_t key, const std::vector<int>& fingerprint,
+                      const std::vector<Sparsity>& sp);
+
+    /// Remove all entries
+    static void clear();
+
+  private:
+    /// Entry in the cache directory: time of last use, size in bytes and file name
+    typedef std::pair<long, std::pair<long, std::string> > Entry;
+
+    /// Scan the cache directory
+    static std::vector<Entry> entries();
+
+    /// Mark an entry as used
+    static void touch(const std::string& fname);
+
+    /// Evict least recently used entries until the size limit is met
+    static void evict(const std::string& keep);
+
+    /// File name of an entry
+    static std::string entry_name(std::size_t key);
+
+    /// Write a file atomically
+    static bool write_file(const std::string& fname, const std::string& contents);
+  };
+
+} // namespace casadi
+
+/// \endcond
+
+#endif // CASADI_SPARSITY_CACHE_HPP
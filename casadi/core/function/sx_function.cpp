@@ -24,14 +24,20 @@
 
 
 #include "sx_function.hpp"
+#include "native_code.hpp"
 #include <limits>
 #include <stack>
 #include <deque>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <chrono>
 #include "../std_vector_tools.hpp"
 #include "../sx/sx_node.hpp"
+#include "../sx/unary_sx.hpp"
+#include "../sx/binary_sx.hpp"
+#include "../sx/symbolic_sx.hpp"
+#include "../sx/constant_sx.hpp"
 #include "../casadi_types.hpp"
 #include "../sparsity_internal.hpp"
 #include "../global_options.hpp"
@@ -60,9 +66,11 @@ namespace casadi {
     // Default (persistent) options
     just_in_time_opencl_ = false;
     just_in_time_sparsity_ = false;
+    native_ = 0;
   }
 
   SXFunction::~SXFunction() {
+    delete native_;
     // Free OpenCL memory
 #ifdef WITH_OPENCL
     freeOpenCL();
@@ -81,12 +89,27 @@ namespace casadi {
                    << free_vars_ << " are free.");
     }
 
+    // Machine code emitted in-process, not profiled
+    if (native_ && !profile_) return (*native_)(arg, res, w);
+
+    // Profiling, calls and time per operation code
+    typedef std::chrono::steady_clock clock;
+    clock::time_point t_start, t0;
+    vector<long> n_call;
+    vector<double> t_op;
+    if (profile_) {
+      t_start = clock::now();
+      n_call.resize(profile_ops_.size(), 0);
+      t_op.resize(profile_ops_.size(), 0);
+    }
+
     // NOTE: The implementation of this function is very delicate. Small changes in the
     // class structure can cause large performance losses. For this reason,
     // the preprocessor macros are used below
 
     // Evaluate the algorithm
     for (auto&& e : algorithm_) {
+      if (profile_) t0 = clock::now();
       switch (e.op) {
         CASADI_MATH_FUN_BUILTIN(w[e.i1], w[e.i2], w[e.i0])
 
@@ -96,6 +119,14 @@ namespace casadi {
       default:
         casadi_error("SXFunction::eval: Unknown operation" << e.op);
       }
+      if (profile_) {
+        t_op[e.op] += std::chrono::duration<double>(clock::now() - t0).count();
+        n_call[e.op]++;
+      }
+    }
+
+    if (profile_) {
+      profile_add(std::chrono::duration<double>(clock::now() - t_start).count(), n_call, t_op);
     }
 
     casadi_msg("SXFunction::eval():end " << name_);
@@ -185,49 +216,207 @@ namespace casadi {
   }
 
   void SXFunction::generateBody(CodeGenerator& g) const {
+    // In split mode, a large algorithm is divided into chunks, each in a
+    // translation unit of its own
+    int n_alg = algorithm_.size();
+    int chunk_size = n_alg;
+    if (g.split && !simplifiedCall() && n_alg>g.split_size) chunk_size = g.split_size;
+    int n_chunk = n_alg==0 ? 1 : (n_alg + chunk_size - 1)/chunk_size;
+
+    // Real-type of the intermediates
+    string lt = g.local_real_t(name_);
+
+    // Values needed in a later chunk are passed on in the work vector
+    vector<bool> store(n_alg, false);
+    if (n_chunk>1) {
+      vector<int> last_el(sz_w(), -1);
+      for (int k=0; k<n_alg; ++k) {
+        const AlgEl& e = algorithm_[k];
+        int ndep;
+        if (e.op==OP_OUTPUT) {
+          ndep = 1;
+        } else if (e.op==OP_CONST || e.op==OP_INPUT) {
+          ndep = 0;
+        } else {
+          ndep = casadi_math<double>::ndeps(e.op);
+        }
+        for (int c=0; c<ndep; ++c) {
+          int i = c==0 ? e.i1 : e.i2;
+          if (last_el[i]>=0 && last_el[i]/chunk_size != k/chunk_size) store[last_el[i]] = true;
+        }
+        if (e.op!=OP_OUTPUT) last_el[e.i0] = k;
+      }
+    }
 
-    // Which variables have been declared
-    vector<bool> declared(sz_w(), false);
+    for (int chunk=0; chunk<n_chunk; ++chunk) {
+      // Start a new function for the chunk
+      string body_before, cname;
+      if (n_chunk>1) {
+        body_before = g.body.str();
+        g.body.str(string());
+        cname = "CASADI_PREFIX(u" + g.to_string(g.units.size()) + ")";
+        g.body << "void " << cname << "(const real_t** arg, real_t** res, real_t* w) {" << endl;
+      }
 
-    // Run the algorithm
-    for (vector<AlgEl>::const_iterator it = algorithm_.begin(); it!=algorithm_.end(); ++it) {
-      // Indent
-      g.body << "  ";
+      int k_begin = chunk*chunk_size, k_end = std::min(n_alg, (chunk+1)*chunk_size);
+
+      // Inputs and outputs through restrict-qualified pointers
+      string arg = "arg[", res = "res[", brk = "]";
+      if (g.with_restrict) {
+        g.addAuxiliary(CodeGenerator::AUX_RESTRICT);
+        vector<bool> used_in(n_in(), false), used_out(n_out(), false);
+        for (int k=k_begin; k<k_end; ++k) {
+          const AlgEl& e = algorithm_[k];
+          if (e.op==OP_INPUT) used_in[e.i1] = true;
+          if (e.op==OP_OUTPUT) used_out[e.i0] = true;
+        }
+        for (int i=0; i<used_in.size(); ++i) {
+          if (used_in[i]) g.body << "  const real_t* CASADI_RESTRICT arg" << i
+                                 << "=arg[" << i << "];" << endl;
+        }
+        for (int i=0; i<used_out.size(); ++i) {
+          if (used_out[i]) g.body << "  real_t* CASADI_RESTRICT res" << i
+                                  << "=res[" << i << "];" << endl;
+        }
+        arg = "arg";
+        res = "res";
+        brk = "";
+      }
 
-      if (it->op==OP_OUTPUT) {
-        g.body << "if (res[" << it->i0 << "]!=0) "
-                      << "res["<< it->i0 << "][" << it->i2 << "]=" << "a" << it->i1;
-      } else {
-        // Declare result if not already declared
-        if (!declared[it->i0]) {
-          g.body << "real_t ";
-          declared[it->i0]=true;
+      // For each work vector element, the operation that assigned it in this chunk
+      vector<int> assigned(sz_w(), -1);
+
+      // Variable, or work vector element if calculated in an earlier chunk
+      auto var = [&](int i) {
+        if (assigned[i]<0) return "w[" + g.to_string(i) + "]";
+        return "a" + g.to_string(g.single_assignment ? assigned[i] : i);
+      };
+
+      // Run the algorithm
+      for (int k=k_begin; k<k_end; ++k) {
+        const AlgEl& e = algorithm_[k];
+
+        // Indent
+        g.body << "  ";
+
+        if (e.op==OP_OUTPUT) {
+          g.body << "if (" << res << e.i0 << brk << "!=0) "
+                 << res << e.i0 << brk << "[" << e.i2 << "]=" << var(e.i1);
+        } else {
+          // What to store
+          stringstream rhs;
+          if (e.op==OP_CONST) {
+            rhs << g.constant(e.d, lt);
+          } else if (e.op==OP_INPUT) {
+            rhs << arg << e.i1 << brk << " ? "
+                << arg << e.i1 << brk << "[" << e.i2 << "] : 0";
+          } else if (e.op==OP_SQ && lt!="real_t") {
+            // sq takes real_t arguments
+            rhs << var(e.i1) << "*" << var(e.i1);
+          } else {
+            int ndep = casadi_math<double>::ndeps(e.op);
+            casadi_math<double>::printPre(e.op, rhs);
+            for (int c=0; c<ndep; ++c) {
+              if (c==0) {
+                rhs << var(e.i1);
+              } else {
+                casadi_math<double>::printSep(e.op, rhs);
+                rhs << var(e.i2);
+              }
+            }
+            casadi_math<double>::printPost(e.op, rhs);
+          }
+
+          // Declare result if not already declared, in single assignment
+          // form every operation gets a variable of its own
+          if (g.single_assignment) {
+            g.body << "const " << lt << " ";
+          } else if (assigned[e.i0]<0) {
+            g.body << lt << " ";
+          }
+          assigned[e.i0] = k;
+
+          // Where to store the result
+          string v = var(e.i0);
+          g.body << v << "=" << rhs.str();
+
+          // Pass on to a later chunk
+          if (store[k]) g.body << "; w[" << e.i0 << "]=" << v;
         }
+        g.body  << ";" << endl;
+      }
 
-        // Where to store the result
-        g.body << "a" << it->i0 << "=";
+      // Finalize the chunk and call it
+      if (n_chunk>1) {
+        g.body << "}" << endl << endl;
+        g.add_unit("void " + cname + "(const real_t** arg, real_t** res, real_t* w)",
+                   g.body.str());
+        g.body.str(string());
+        g.body << body_before << "  " << cname << "(arg, res, w);" << endl;
+      }
+    }
+  }
 
-        // What to store
-        if (it->op==OP_CONST) {
-          g.body << g.constant(it->d);
-        } else if (it->op==OP_INPUT) {
-          g.body << "arg[" << it->i1 << "] ? arg[" << it->i1 << "][" << it->i2 << "] : 0";
+  void SXFunction::generateBatchBody(CodeGenerator& g, const std::string& fname) const {
+    // Inputs and outputs, nonzero j of point p at j*stride+p
+    g.addAuxiliary(CodeGenerator::AUX_RESTRICT);
+    string all_given;
+    for (int i=0; i<n_in(); ++i) {
+      g.body << "  const real_t* CASADI_RESTRICT x" << i << "=arg[" << i << "];" << endl;
+      all_given += (all_given.empty() ? "" : " && ") + ("x" + g.to_string(i));
+    }
+    for (int i=0; i<n_out(); ++i) {
+      g.body << "  real_t* CASADI_RESTRICT r" << i << "=res[" << i << "];" << endl;
+      all_given += (all_given.empty() ? "" : " && ") + ("r" + g.to_string(i));
+    }
+    if (all_given.empty()) all_given = "1";
+
+    // Loop over the points without branches, so that it can be vectorized
+    g.body << "  if (" << all_given << ") {" << endl
+           << "    int p;" << endl
+           << "#pragma omp simd" << endl
+           << "    for (p=0; p<n; ++p) {" << endl;
+    string lt = g.local_real_t(name_);
+    vector<bool> declared(sz_w(), false);
+    for (auto&& e : algorithm_) {
+      g.body << "      ";
+      if (e.op==OP_OUTPUT) {
+        g.body << "r" << e.i0 << "[" << e.i2 << "*stride+p]=a" << e.i1;
+      } else {
+        if (!declared[e.i0]) {
+          g.body << lt << " ";
+          declared[e.i0]=true;
+        }
+        g.body << "a" << e.i0 << "=";
+        if (e.op==OP_CONST) {
+          g.body << g.constant(e.d, lt);
+        } else if (e.op==OP_INPUT) {
+          g.body << "x" << e.i1 << "[" << e.i2 << "*stride+p]";
+        } else if (e.op==OP_SQ) {
+          // Avoid the function call
+          g.body << "a" << e.i1 << "*a" << e.i1;
         } else {
-          int ndep = casadi_math<double>::ndeps(it->op);
-          casadi_math<double>::printPre(it->op, g.body);
+          int ndep = casadi_math<double>::ndeps(e.op);
+          casadi_math<double>::printPre(e.op, g.body);
           for (int c=0; c<ndep; ++c) {
             if (c==0) {
-              g.body << "a" << it->i1;
+              g.body << "a" << e.i1;
             } else {
-              casadi_math<double>::printSep(it->op, g.body);
-              g.body << "a" << it->i2;
+              casadi_math<double>::printSep(e.op, g.body);
+              g.body << "a" << e.i2;
             }
           }
-          casadi_math<double>::printPost(it->op, g.body);
+          casadi_math<double>::printPost(e.op, g.body);
         }
       }
-      g.body  << ";" << endl;
+      g.body << ";" << endl;
     }
+    g.body << "    }" << endl
+           << "    return 0;" << endl
+           << "  }" << endl;
+
+    // Missing inputs or outputs: evaluate point by point
+    FunctionInternal::generateBatchBody(g, fname);
   }
 
   Options SXFunction::options_
@@ -242,6 +431,10 @@ namespace casadi {
       {"just_in_time_opencl",
        {OT_BOOL,
         "Just-in-time compilation for numeric evaluation using OpenCL (experimental)"}},
+      {"just_in_time_native",
+       {OT_BOOL,
+        "Just-in-time compilation for numeric evaluation to x86-64 machine code, "
+        "emitted in-process without an external compiler (experimental)"}},
       {"live_variables",
        {OT_BOOL,
         "Reuse variables in the work vector"}}
@@ -255,6 +448,7 @@ namespace casadi {
 
     // Default (temporary) options
     bool live_variables = true;
+    bool just_in_time_native = false;
 
     // Read options
     for (auto&& op : opts) {
@@ -266,6 +460,8 @@ namespace casadi {
         just_in_time_opencl_ = op.second;
       } else if (op.first=="just_in_time_sparsity") {
         just_in_time_sparsity_ = op.second;
+      } else if (op.first=="just_in_time_native") {
+        just_in_time_native = op.second;
       }
     }
 
@@ -507,6 +703,20 @@ namespace casadi {
 #endif // WITH_OPENCL
     }
 
+    // Just-in-time compilation for numeric evaluation to machine code
+    delete native_;
+    native_ = 0;
+    if (just_in_time_native) {
+      casadi_assert_message(NativeCode::is_supported(), "Option \"just_in_time_native\" "
+                            "requires an x86-64 Linux or OS X platform");
+      casadi_assert_message(free_vars_.empty(), "Option \"just_in_time_native\" "
+                            "cannot be used with free variables " << free_vars_);
+      native_ = new NativeCode(algorithm_);
+      if (verbose()) {
+        userOut() << "Emitted " << native_->size() << " bytes of native code" << endl;
+      }
+    }
+
     // Initialize just-in-time compilation for sparsity propagation using OpenCL
     if (just_in_time_sparsity_) {
 #ifdef WITH_OPENCL
@@ -518,6 +728,15 @@ namespace casadi {
 #endif // WITH_OPENCL
     }
 
+    // Profiling data, aggregated by operation code
+    if (profile_) {
+      profile_ops_.clear();
+      for (int op=0; op<NUM_BUILT_IN_OPS; ++op) {
+        const char* op_name = casadi_math<double>::name(op);
+        profile_ops_.push_back(ProfileEntry(-1, op_name ? op_name : "unknown"));
+      }
+    }
+
     // Print
     if (verbose()) {
       userOut() << "SXFunction::init Initialized " << name_ << " ("
@@ -776,6 +995,60 @@ namespace casadi {
     if (verbose()) userOut() << "SXFunction::evalAdj end" << endl;
   }
 
+  size_t SXFunction::graph_bytes() const {
+    // Operations, with unary or binary nodes
+    size_t ret = 0;
+    for (auto&& e : operations_) {
+      ret += casadi_math<double>::ndeps(e.op())==1 ? sizeof(UnarySX) : sizeof(BinarySX);
+    }
+
+    // Constants, shared with the global cache if real or integer
+    ret += constants_.size()*sizeof(RealtypeSX);
+
+    // Symbolic primitives, inputs and free variables
+    for (auto&& x : inputv_) {
+      for (auto&& e : x.nonzeros()) ret += sizeof(SymbolicSX) + e.name().size();
+    }
+    for (auto&& e : free_vars_) ret += sizeof(SymbolicSX) + e.name().size();
+    return ret;
+  }
+
+  size_t SXFunction::algorithm_bytes() const {
+    return algorithm_.capacity()*sizeof(AlgEl)
+      + (operations_.capacity() + constants_.capacity() + free_vars_.capacity()
+         + s_work_.capacity())*sizeof(SXElem)
+      + default_in_.capacity()*sizeof(double);
+  }
+
+  size_t SXFunction::get_structural_hash() const {
+    size_t h = 0;
+    for (auto&& e : algorithm_) {
+      hash_combine(h, e.op);
+      hash_combine(h, e.i0);
+      // Numerical values of constants do not affect the structure
+      if (e.op!=OP_CONST) {
+        hash_combine(h, e.i1);
+        hash_combine(h, e.i2);
+      }
+    }
+    hash_combine(h, free_vars_.size());
+    return h==0 ? 1 : h;
+  }
+
+  bool SXFunction::get_structural_fingerprint(std::vector<int>& fp) const {
+    fp.reserve(fp.size() + 4*algorithm_.size() + 1);
+    for (auto&& e : algorithm_) {
+      fp.push_back(e.op);
+      fp.push_back(e.i0);
+      if (e.op!=OP_CONST) {
+        fp.push_back(e.i1);
+        fp.push_back(e.i2);
+      }
+    }
+    fp.push_back(free_vars_.size());
+    return true;
+  }
+
   void SXFunction::spFwd(const bvec_t** arg, bvec_t** res, int* iw, bvec_t* w, int mem) {
     // Propagate sparsity forward
     for (vector<AlgEl>::iterator it=algorithm_.begin(); it!=algorithm_.end(); ++it) {
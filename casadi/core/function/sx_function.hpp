@@ -38,6 +38,8 @@
 /// \cond INTERNAL
 
 namespace casadi {
+  class NativeCode;
+
   /** \brief  An atomic operation for the SXElem virtual machine */
   struct ScalarAtomic {
     int op;     /// Operator index
@@ -186,6 +188,18 @@ class CASADI_EXPORT SXFunction :
   /** \brief Number of nodes in the algorithm */
   virtual int n_nodes() const { return algorithm_.size() - nnz_out();}
 
+  /** \brief Memory held by the expression graph [bytes], estimate */
+  virtual size_t graph_bytes() const;
+
+  /** \brief Memory held by the algorithm [bytes], estimate */
+  virtual size_t algorithm_bytes() const;
+
+  /** \brief Hash of the structure of the algorithm */
+  virtual std::size_t get_structural_hash() const;
+
+  /** \brief Structure of the algorithm */
+  virtual bool get_structural_fingerprint(std::vector<int>& fp) const;
+
   /** \brief  DATA MEMBERS */
 
   /** \brief  An element of the algorithm, namely a binary operation */
@@ -228,6 +242,9 @@ class CASADI_EXPORT SXFunction :
   /** \brief Generate code for the body of the C function */
   virtual void generateBody(CodeGenerator& g) const;
 
+  /** \brief Generate code for the body of the batch function, a vectorizable loop */
+  virtual void generateBatchBody(CodeGenerator& g, const std::string& fname) const;
+
   /** \brief  Propagate sparsity forward */
   virtual void spFwd(const bvec_t** arg, bvec_t** res, int* iw, bvec_t* w, int mem);
 
@@ -249,6 +266,9 @@ class CASADI_EXPORT SXFunction :
   /// With just-in-time compilation for the sparsity propagation
   bool just_in_time_sparsity_;
 
+  /// Machine code for numeric evaluation, emitted in-process
+  NativeCode* native_;
+
 #ifdef WITH_OPENCL
   // Initialize sparsity propagation using OpenCL
   void allocOpenCL();
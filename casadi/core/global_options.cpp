@@ -31,6 +31,15 @@ namespace casadi {
   bool GlobalOptions::simplification_on_the_fly = true;
   bool GlobalOptions::hierarchical_sparsity = true;
 
+  std::string GlobalOptions::sparsity_cache_dir = "";
+  long GlobalOptions::sparsity_cache_size = 100*1024*1024;
+
+  int GlobalOptions::derivative_cache_entries = 0;
+  long GlobalOptions::derivative_cache_memory = 0;
+
+  std::string GlobalOptions::jit_cache_dir = "";
+  long GlobalOptions::jit_cache_size = 1024*1024*1024;
+
   std::string GlobalOptions::casadipath = "";
 
 } // namespace casadi
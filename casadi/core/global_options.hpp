@@ -61,6 +61,43 @@ namespace casadi {
 
       static bool hierarchical_sparsity;
 
+      /** \brief Directory for the persistent cache of Jacobian sparsity patterns
+      * and seed matrices. The directory must exist. Empty string means disabled.
+      * Default: ""
+      */
+      static std::string sparsity_cache_dir;
+
+      /** \brief Maximum total size of the sparsity cache, in bytes.
+      * Least recently used entries are removed when exceeded.
+      * Default: 100 MB
+      */
+      static long sparsity_cache_size;
+
+      /** \brief Maximum number of derivative functions kept alive by the strong
+      * derivative cache. Least recently used derivatives are released first.
+      * 0 means that only the "derivative_cache" option of each function applies.
+      * Default: 0
+      */
+      static int derivative_cache_entries;
+
+      /** \brief Maximum memory held by the strong derivative cache, in bytes.
+      * 0 means no limit.
+      * Default: 0
+      */
+      static long derivative_cache_memory;
+
+      /** \brief Directory for the persistent cache of JIT compiled shared libraries,
+      * shared between processes. The directory must exist. Empty string means disabled.
+      * Default: ""
+      */
+      static std::string jit_cache_dir;
+
+      /** \brief Maximum total size of the JIT cache, in bytes.
+      * Least recently used libraries are removed when exceeded.
+      * Default: 1 GB
+      */
+      static long jit_cache_size;
+
 #endif //SWIG
       // Setter and getter for simplification_on_the_fly
       static void setSimplificationOnTheFly(bool flag) { simplification_on_the_fly = flag; }
@@ -70,6 +107,24 @@ namespace casadi {
       static void setHierarchicalSparsity(bool flag) { hierarchical_sparsity = flag; }
       static bool getHierarchicalSparsity() { return hierarchical_sparsity; }
 
+      // Setter and getter for the sparsity cache
+      static void setSparsityCacheDir(const std::string& dir) { sparsity_cache_dir = dir; }
+      static std::string getSparsityCacheDir() { return sparsity_cache_dir; }
+      static void setSparsityCacheSize(long size) { sparsity_cache_size = size; }
+      static long getSparsityCacheSize() { return sparsity_cache_size; }
+
+      // Setters and getters for the strong derivative cache
+      static void setDerivativeCacheEntries(int n) { derivative_cache_entries = n; }
+      static int getDerivativeCacheEntries() { return derivative_cache_entries; }
+      static void setDerivativeCacheMemory(long size) { derivative_cache_memory = size; }
+      static long getDerivativeCacheMemory() { return derivative_cache_memory; }
+
+      // Setters and getters for the JIT cache
+      static void setJitCacheDir(const std::string& dir) { jit_cache_dir = dir; }
+      static std::string getJitCacheDir() { return jit_cache_dir; }
+      static void setJitCacheSize(long size) { jit_cache_size = size; }
+      static long getJitCacheSize() { return jit_cache_size; }
+
       static void setCasadiPath(const std::string & path) { casadipath = path; }
       static std::string getCasadiPath() { return casadipath; }
 
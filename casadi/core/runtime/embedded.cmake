@@ -46,6 +46,8 @@ foreach(line ${FILE_CONTENTS})
     string(REGEX REPLACE "[^,]* ([a-z_0-9]+)$" " \\1" args "${args}")
     set(def "#define ${FUNCTION}(${args}) CASADI_PREFIX(${FUNCTION})(${args})")
     file(APPEND ${BINARY_DIR}/${FILE_BASENAME}_embedded.hpp "const char * codegen_str_${FUNCTION}_define = \"${def}\\n\";\n" )
+    string(REGEX REPLACE "^ *(.* CASADI_PREFIX\\([a-z_0-9]+\\)\\(.*\\)) *{.*" "\\1;" decl "${line}")
+    file(APPEND ${BINARY_DIR}/${FILE_BASENAME}_embedded.hpp "const char * codegen_str_${FUNCTION}_decl = \"${decl}\\n\";\n" )
   endif()
 endforeach()
 file(APPEND ${BINARY_DIR}/${FILE_BASENAME}_embedded.hpp "}" )
@@ -61,11 +61,11 @@ namespace casadi {
   void CASADI_PREFIX(axpy)(int n, real_t alpha, const real_t* x, real_t* y);
 
   /// Inner product
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t=real_t>
   real_t CASADI_PREFIX(dot)(int n, const real_t* x, const real_t* y);
 
   /// ASUM: ||x||_1 -> return
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t=real_t>
   real_t CASADI_PREFIX(asum)(int n, const real_t* x);
 
   /// IAMAX: index corresponding to the entry with the largest absolute value
@@ -77,15 +77,15 @@ namespace casadi {
   void CASADI_PREFIX(fill)(real_t* x, int n, real_t alpha);
 
   /// Sparse matrix-matrix multiplication: z <- z + x*y
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t=real_t>
   void CASADI_PREFIX(mtimes)(const real_t* x, const int* sp_x, const real_t* y, const int* sp_y, real_t* z, const int* sp_z, real_t* w, int tr);
 
   /// Sparse matrix-vector multiplication: z <- z + x*y
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t=real_t>
   void CASADI_PREFIX(mv)(const real_t* x, const int* sp_x, const real_t* y, real_t* z, int tr);
 
   /// NRM2: ||x||_2 -> return
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t=real_t>
   real_t CASADI_PREFIX(nrm2)(int n, const real_t* x, int inc_x);
 
   /// TRANS: y <- trans(x)
@@ -95,7 +95,7 @@ namespace casadi {
   /** Inf-norm of a vector *
       Returns the largest element in absolute value
    */
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t=real_t>
   real_t CASADI_PREFIX(norm_inf)(int n, const real_t* x);
 
   /** Inf-norm of a Matrix-matrix product,*
@@ -109,7 +109,7 @@ namespace casadi {
                              real_t *dwork, int *iwork);
 
   /** Calculates dot(x, mul(A, y)) */
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t=real_t>
   real_t CASADI_PREFIX(bilin)(const real_t* A, const int* sp_A, const real_t* x, const real_t* y);
 
   /// Adds a multiple alpha/2 of the outer product mul(x, trans(x)) to A
@@ -123,6 +123,63 @@ namespace casadi {
   /// Evaluate a polynomial
   template<typename real_t>
   real_t CASADI_PREFIX(polyval)(const real_t* p, int n, real_t x);
+  /** \brief Householder reflection in place, cf. cs_house in CSparse
+   * On return, (I - beta*v*v')*x = s*e_0 with x the input v. Returns s.
+   */
+  template<typename real_t>
+  real_t CASADI_PREFIX(house)(real_t* v, real_t* beta, int nv);
+
+  /** \brief Numeric sparse QR factorization of A(prinv, pc), patterns from qr_sparse
+   * \param x  A real work vector of length nrow
+   */
+  template<typename real_t>
+  void CASADI_PREFIX(qr)(const int* sp_a, const real_t* nz_a, real_t* x,
+                         const int* sp_v, real_t* nz_v, const int* sp_r, real_t* nz_r,
+                         real_t* beta, const int* prinv, const int* pc);
+
+  /** \brief Solve with a sparse QR factorization, in place for nrhs right-hand sides
+   * \param w  A real work vector of length nrow
+   */
+  template<typename real_t>
+  void CASADI_PREFIX(qr_solve)(real_t* x, int nrhs, int tr,
+                               const int* sp_v, const real_t* v, const int* sp_r, const real_t* r,
+                               const real_t* beta, const int* prinv, const int* pc, real_t* w);
+
+  /** \brief Numeric sparse LU factorization with static pivoting, patterns from lu_sparse
+   * Pivots smaller than eps*max(|A|) in magnitude are replaced by +/-eps*max(|A|).
+   * Returns the number of perturbed pivots.
+   * \param x  A real work vector of length n
+   */
+  template<typename real_t>
+  int CASADI_PREFIX(lu)(const int* sp_a, const real_t* nz_a, real_t* x,
+                        const int* sp_l, real_t* nz_l, const int* sp_u, real_t* nz_u,
+                        const int* prinv, const int* pc, real_t eps);
+
+  /** \brief Solve with a sparse LU factorization, in place for nrhs right-hand sides
+   * \param w  A real work vector of length n
+   */
+  template<typename real_t>
+  void CASADI_PREFIX(lu_solve)(real_t* x, int nrhs, int tr,
+                               const int* sp_l, const real_t* l, const int* sp_u, const real_t* u,
+                               const int* prinv, const int* pc, real_t* w);
+
+  /** \brief Numeric sparse LDL^T factorization of A(p, p), patterns from ldl_sparse
+   * sp_lt is the pattern of L'. Entries of D smaller than eps*max(|A|) in magnitude are
+   * replaced by +/-eps*max(|A|). Returns the number of perturbed entries.
+   * \param w   A real work vector of length n
+   * \param iw  An integer work vector of length 2*n
+   */
+  template<typename real_t>
+  int CASADI_PREFIX(ldl)(const int* sp_a, const real_t* nz_a, const int* sp_lt,
+                         const int* sp_l, real_t* nz_l, real_t* d, const int* p,
+                         real_t eps, real_t* w, int* iw);
+
+  /** \brief Solve with a sparse LDL^T factorization, in place for nrhs right-hand sides
+   * \param w  A real work vector of length n
+   */
+  template<typename real_t>
+  void CASADI_PREFIX(ldl_solve)(real_t* x, int nrhs, const int* sp_l, const real_t* l,
+                                const real_t* d, const int* p, real_t* w);
 }
 
 // Implementations
@@ -241,17 +298,17 @@ namespace casadi {
     for (i=0; i<n; ++i) *y++ += alpha**x++;
   }
 
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t>
   real_t CASADI_PREFIX(dot)(int n, const real_t* x, const real_t* y) {
-    real_t r = 0;
+    real_acc_t r = 0;
     int i;
     for (i=0; i<n; ++i) r += *x++ * *y++;
     return r;
   }
 
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t>
   real_t CASADI_PREFIX(asum)(int n, const real_t* x) {
-    real_t r = 0;
+    real_acc_t r = 0;
     int i;
     if (x) {
       for (i=0; i<n; ++i) r += fabs(*x++);
@@ -284,7 +341,7 @@ namespace casadi {
     }
   }
 
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t>
   void CASADI_PREFIX(mtimes)(const real_t* x, const int* sp_x, const real_t* y, const int* sp_y, real_t* z, const int* sp_z, real_t* w, int tr) {
     /* Get sparsities */
     int ncol_x = sp_x[1];
@@ -305,10 +362,12 @@ namespace casadi {
         /* Loop over the nonzeros of z */
         for (kk=colind_z[cc]; kk<colind_z[cc+1]; ++kk) {
           int rr = row_z[kk];
+          real_acc_t s = z[kk];
           /* Loop over corresponding columns of x */
           for (kk1=colind_x[rr]; kk1<colind_x[rr+1]; ++kk1) {
-            z[kk] += x[kk1] * w[row_x[kk1]];
+            s += x[kk1] * w[row_x[kk1]];
           }
+          z[kk] = s;
         }
       }
     } else {
@@ -334,7 +393,7 @@ namespace casadi {
     }
   }
 
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t>
   void CASADI_PREFIX(mv)(const real_t* x, const int* sp_x, const real_t* y, real_t* z, int tr) {
     /* Get sparsities */
     int ncol_x = sp_x[1];
@@ -343,10 +402,12 @@ namespace casadi {
     if (tr) {
       /* loop over the columns of x */
       for (i=0; i<ncol_x; ++i) {
+        real_acc_t s = z[i];
         /* loop over the non-zeros of x */
         for (el=colind_x[i]; el<colind_x[i+1]; ++el) {
-          z[i] += x[el] * y[row_x[el]];
+          s += x[el] * y[row_x[el]];
         }
+        z[i] = s;
       }
     } else {
       /* loop over the columns of x */
@@ -359,9 +420,9 @@ namespace casadi {
     }
   }
 
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t>
   real_t CASADI_PREFIX(nrm2)(int n, const real_t* x, int inc_x) {
-    real_t r = 0;
+    real_acc_t r = 0;
     int i;
     for (i=0; i<n; ++i) {
       r += *x**x;
@@ -384,9 +445,9 @@ namespace casadi {
     }
   }
 
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t>
   real_t CASADI_PREFIX(norm_inf)(int n, const real_t* x) {
-    real_t ret = 0;
+    real_acc_t ret = 0;
     int k;
     for (k=0; k<n; ++k) {
       ret = fmax(ret, fabs(x[k]));
@@ -472,14 +533,14 @@ namespace casadi {
     return res;
   }
 
-  template<typename real_t>
+  template<typename real_t, typename real_acc_t>
   real_t CASADI_PREFIX(bilin)(const real_t* A, const int* sp_A, const real_t* x, const real_t* y) {
     /* Get sparsities */
     int ncol_A = sp_A[1];
     const int *colind_A = sp_A+2, *row_A = sp_A + 2 + ncol_A+1;
 
     /* Return value */
-    real_t ret=0;
+    real_acc_t ret=0;
 
     /* Loop over the columns of A */
     int cc, rr, el;
@@ -542,6 +603,254 @@ namespace casadi {
     return r;
   }
 
+  template<typename real_t>
+  real_t CASADI_PREFIX(house)(real_t* v, real_t* beta, int nv) {
+    real_t v0, sigma, s;
+    int i;
+    v0 = v[0];
+    sigma = 0;
+    for (i=1; i<nv; ++i) sigma += v[i]*v[i];
+    if (sigma==0) {
+      s = fabs(v0);
+      *beta = v0<=0 ? 2 : 0;
+      v[0] = 1;
+    } else {
+      s = sqrt(v0*v0 + sigma);
+      v[0] = v0<=0 ? v0-s : -sigma/(v0+s);
+      *beta = -1/(s*v[0]);
+    }
+    return s;
+  }
+
+  template<typename real_t>
+  void CASADI_PREFIX(qr)(const int* sp_a, const real_t* nz_a, real_t* x, const int* sp_v, real_t* nz_v, const int* sp_r, real_t* nz_r, real_t* beta, const int* prinv, const int* pc) {
+    /* Get sparsities */
+    int nrow = sp_a[0], ncol = sp_a[1];
+    const int *a_colind=sp_a+2, *a_row=sp_a+2+ncol+1;
+    const int *v_colind=sp_v+2, *v_row=sp_v+2+ncol+1;
+    const int *r_colind=sp_r+2, *r_row=sp_r+2+ncol+1;
+    int r, c, k, k1;
+    real_t alpha;
+    for (r=0; r<nrow; ++r) x[r] = 0;
+    for (c=0; c<ncol; ++c) {
+      /* Scatter the permuted column of A */
+      for (k=a_colind[pc[c]]; k<a_colind[pc[c]+1]; ++k) {
+        x[prinv[a_row[k]]] = nz_a ? nz_a[k] : 0;
+      }
+      /* Apply the previous reflections, in increasing order */
+      for (k=r_colind[c]; k<r_colind[c+1]-1; ++k) {
+        r = r_row[k];
+        alpha = 0;
+        for (k1=v_colind[r]; k1<v_colind[r+1]; ++k1) alpha += nz_v[k1]*x[v_row[k1]];
+        alpha *= beta[r];
+        for (k1=v_colind[r]; k1<v_colind[r+1]; ++k1) x[v_row[k1]] -= alpha*nz_v[k1];
+        nz_r[k] = x[r];
+        x[r] = 0;
+      }
+      /* Gather the Householder vector and form the reflection */
+      for (k1=v_colind[c]; k1<v_colind[c+1]; ++k1) {
+        nz_v[k1] = x[v_row[k1]];
+        x[v_row[k1]] = 0;
+      }
+      nz_r[k] = CASADI_PREFIX(house)(nz_v+v_colind[c], beta+c, v_colind[c+1]-v_colind[c]);
+    }
+  }
+
+  template<typename real_t>
+  void CASADI_PREFIX(qr_solve)(real_t* x, int nrhs, int tr, const int* sp_v, const real_t* v, const int* sp_r, const real_t* r, const real_t* beta, const int* prinv, const int* pc, real_t* w) {
+    /* Get sparsities */
+    int nrow = sp_v[0], ncol = sp_v[1];
+    const int *v_colind=sp_v+2, *v_row=sp_v+2+ncol+1;
+    const int *r_colind=sp_r+2, *r_row=sp_r+2+ncol+1;
+    int k, c, i, el;
+    real_t alpha;
+    for (k=0; k<nrhs; ++k) {
+      if (tr) {
+        /* Forward substitution with R' */
+        for (c=0; c<ncol; ++c) {
+          w[c] = x[pc[c]];
+          for (el=r_colind[c]; el<r_colind[c+1]-1; ++el) w[c] -= r[el]*w[r_row[el]];
+          w[c] /= r[r_colind[c+1]-1];
+        }
+        for (i=ncol; i<nrow; ++i) w[i] = 0;
+        /* Multiply with Q, last reflection first */
+        for (c=ncol-1; c>=0; --c) {
+          alpha = 0;
+          for (el=v_colind[c]; el<v_colind[c+1]; ++el) alpha += v[el]*w[v_row[el]];
+          alpha *= beta[c];
+          for (el=v_colind[c]; el<v_colind[c+1]; ++el) w[v_row[el]] -= alpha*v[el];
+        }
+        for (i=0; i<nrow; ++i) x[i] = w[prinv[i]];
+      } else {
+        /* Multiply with Q', first reflection first */
+        for (i=0; i<nrow; ++i) w[prinv[i]] = x[i];
+        for (c=0; c<ncol; ++c) {
+          alpha = 0;
+          for (el=v_colind[c]; el<v_colind[c+1]; ++el) alpha += v[el]*w[v_row[el]];
+          alpha *= beta[c];
+          for (el=v_colind[c]; el<v_colind[c+1]; ++el) w[v_row[el]] -= alpha*v[el];
+        }
+        /* Back substitution with R */
+        for (c=ncol-1; c>=0; --c) {
+          w[c] /= r[r_colind[c+1]-1];
+          for (el=r_colind[c]; el<r_colind[c+1]-1; ++el) w[r_row[el]] -= r[el]*w[c];
+        }
+        for (c=0; c<ncol; ++c) x[pc[c]] = w[c];
+      }
+      x += nrow;
+    }
+  }
+
+  template<typename real_t>
+  int CASADI_PREFIX(lu)(const int* sp_a, const real_t* nz_a, real_t* x, const int* sp_l, real_t* nz_l, const int* sp_u, real_t* nz_u, const int* prinv, const int* pc, real_t eps) {
+    /* Get sparsities */
+    int n = sp_a[1];
+    const int *a_colind=sp_a+2, *a_row=sp_a+2+n+1;
+    const int *l_colind=sp_l+2, *l_row=sp_l+2+n+1;
+    const int *u_colind=sp_u+2, *u_row=sp_u+2+n+1;
+    int r, c, k, k1, npert=0;
+    real_t pivot, amax=0;
+    /* Pivot threshold relative to the largest entry of A */
+    if (nz_a) {
+      for (k=0; k<a_colind[n]; ++k) if (fabs(nz_a[k])>amax) amax = fabs(nz_a[k]);
+    }
+    eps *= amax;
+    for (r=0; r<n; ++r) x[r] = 0;
+    for (c=0; c<n; ++c) {
+      /* Scatter the permuted column of A */
+      for (k=a_colind[pc[c]]; k<a_colind[pc[c]+1]; ++k) {
+        x[prinv[a_row[k]]] = nz_a ? nz_a[k] : 0;
+      }
+      /* Left-looking elimination, in increasing order */
+      for (k=u_colind[c]; k<u_colind[c+1]-1; ++k) {
+        r = u_row[k];
+        nz_u[k] = x[r];
+        x[r] = 0;
+        for (k1=l_colind[r]; k1<l_colind[r+1]; ++k1) x[l_row[k1]] -= nz_l[k1]*nz_u[k];
+      }
+      /* Static pivoting */
+      pivot = x[c];
+      x[c] = 0;
+      if (fabs(pivot)<eps) {
+        pivot = pivot<0 ? -eps : eps;
+        npert++;
+      }
+      nz_u[k] = pivot;
+      for (k1=l_colind[c]; k1<l_colind[c+1]; ++k1) {
+        nz_l[k1] = x[l_row[k1]]/pivot;
+        x[l_row[k1]] = 0;
+      }
+    }
+    return npert;
+  }
+
+  template<typename real_t>
+  void CASADI_PREFIX(lu_solve)(real_t* x, int nrhs, int tr, const int* sp_l, const real_t* l, const int* sp_u, const real_t* u, const int* prinv, const int* pc, real_t* w) {
+    /* Get sparsities */
+    int n = sp_l[1];
+    const int *l_colind=sp_l+2, *l_row=sp_l+2+n+1;
+    const int *u_colind=sp_u+2, *u_row=sp_u+2+n+1;
+    int k, c, i, el;
+    for (k=0; k<nrhs; ++k) {
+      if (tr) {
+        /* Forward substitution with U' */
+        for (c=0; c<n; ++c) {
+          w[c] = x[pc[c]];
+          for (el=u_colind[c]; el<u_colind[c+1]-1; ++el) w[c] -= u[el]*w[u_row[el]];
+          w[c] /= u[u_colind[c+1]-1];
+        }
+        /* Back substitution with L' */
+        for (c=n-1; c>=0; --c) {
+          for (el=l_colind[c]; el<l_colind[c+1]; ++el) w[c] -= l[el]*w[l_row[el]];
+        }
+        for (i=0; i<n; ++i) x[i] = w[prinv[i]];
+      } else {
+        /* Forward substitution with L */
+        for (i=0; i<n; ++i) w[prinv[i]] = x[i];
+        for (c=0; c<n; ++c) {
+          for (el=l_colind[c]; el<l_colind[c+1]; ++el) w[l_row[el]] -= l[el]*w[c];
+        }
+        /* Back substitution with U */
+        for (c=n-1; c>=0; --c) {
+          w[c] /= u[u_colind[c+1]-1];
+          for (el=u_colind[c]; el<u_colind[c+1]-1; ++el) w[u_row[el]] -= u[el]*w[c];
+        }
+        for (c=0; c<n; ++c) x[pc[c]] = w[c];
+      }
+      x += n;
+    }
+  }
+
+  template<typename real_t>
+  int CASADI_PREFIX(ldl)(const int* sp_a, const real_t* nz_a, const int* sp_lt, const int* sp_l, real_t* nz_l, real_t* d, const int* p, real_t eps, real_t* w, int* iw) {
+    /* Get sparsities */
+    int n = sp_a[1];
+    const int *a_colind=sp_a+2, *a_row=sp_a+2+n+1;
+    const int *lt_colind=sp_lt+2, *lt_row=sp_lt+2+n+1;
+    const int *l_colind=sp_l+2, *l_row=sp_l+2+n+1;
+    int *pinv=iw, *next=iw+n;
+    int i, j, k, el, npert=0;
+    real_t yi, l_ki, amax=0;
+    /* Pivot threshold relative to the largest entry of A */
+    if (nz_a) {
+      for (el=0; el<a_colind[n]; ++el) if (fabs(nz_a[el])>amax) amax = fabs(nz_a[el]);
+    }
+    eps *= amax;
+    for (i=0; i<n; ++i) {
+      pinv[p[i]] = i;
+      next[i] = l_colind[i];
+      w[i] = 0;
+    }
+    /* Up-looking factorization, one row of L at a time */
+    for (k=0; k<n; ++k) {
+      /* Scatter the upper triangular part of column k of A(p, p) */
+      for (el=a_colind[p[k]]; el<a_colind[p[k]+1]; ++el) {
+        i = pinv[a_row[el]];
+        if (i<=k) w[i] += nz_a ? nz_a[el] : 0;
+      }
+      d[k] = w[k];
+      w[k] = 0;
+      /* Triangular solve with the rows of L computed so far */
+      for (j=lt_colind[k]; j<lt_colind[k+1]; ++j) {
+        i = lt_row[j];
+        yi = w[i];
+        w[i] = 0;
+        for (el=l_colind[i]; el<next[i]; ++el) w[l_row[el]] -= nz_l[el]*yi;
+        l_ki = yi/d[i];
+        d[k] -= l_ki*yi;
+        nz_l[next[i]++] = l_ki;
+      }
+      /* Static pivoting */
+      if (fabs(d[k])<eps) {
+        d[k] = d[k]<0 ? -eps : eps;
+        npert++;
+      }
+    }
+    return npert;
+  }
+
+  template<typename real_t>
+  void CASADI_PREFIX(ldl_solve)(real_t* x, int nrhs, const int* sp_l, const real_t* l, const real_t* d, const int* p, real_t* w) {
+    /* Get sparsities */
+    int n = sp_l[1];
+    const int *l_colind=sp_l+2, *l_row=sp_l+2+n+1;
+    int k, c, i, el;
+    for (k=0; k<nrhs; ++k) {
+      for (i=0; i<n; ++i) w[i] = x[p[i]];
+      /* Forward substitution with L */
+      for (c=0; c<n; ++c) {
+        for (el=l_colind[c]; el<l_colind[c+1]; ++el) w[l_row[el]] -= l[el]*w[c];
+      }
+      for (i=0; i<n; ++i) w[i] /= d[i];
+      /* Back substitution with L' */
+      for (c=n-1; c>=0; --c) {
+        for (el=l_colind[c]; el<l_colind[c+1]; ++el) w[c] -= l[el]*w[l_row[el]];
+      }
+      for (i=0; i<n; ++i) x[p[i]] = w[i];
+      x += n;
+    }
+  }
+
 } // namespace casadi
 
 
@@ -28,6 +28,7 @@
 #include <climits>
 #include <cstdlib>
 #include <cmath>
+#include <set>
 #include "matrix.hpp"
 
 using namespace std;
@@ -1759,8 +1760,7 @@ namespace casadi {
 
     // allocate result
     vector<int> C_colind(n+1, 0), C_row;
-
-    C_colind.resize(anz + bnz);
+    C_row.reserve(anz + bnz);
 
     int* Cp = &C_colind.front();
     for (int j=0; j<n; ++j) {
@@ -1832,6 +1832,151 @@ namespace casadi {
     }
   }
 
+  void SparsityInternal::qr_sparse(Sparsity& V, Sparsity& R, std::vector<int>& prinv,
+                                   std::vector<int>& pc, bool amd) const {
+    int nrow = size1(), ncol = size2();
+    casadi_assert_message(nrow>=ncol, "qr_sparse: more columns than rows");
+
+    // Fill-reducing column ordering and row permutation, cf. cs_sqr
+    vector<int> parent, cp, leftmost;
+    int m2;
+    double lnz, unz;
+    prefactorize(amd ? 3 : 0, 1, prinv, pc, parent, cp, leftmost, m2, lnz, unz);
+    casadi_assert_message(m2==nrow, "qr_sparse: matrix is structurally rank-deficient");
+    prinv.resize(nrow);
+    if (amd) {
+      pc.resize(ncol);
+    } else {
+      pc = range(ncol);
+    }
+
+    // Simulate the Householder sweep structurally, reflections in increasing order
+    const int* colind = this->colind();
+    const int* row = this->row();
+    vector<int> v_colind(1, 0), v_row, r_colind(1, 0), r_row;
+    vector<vector<int> > refl(nrow); // Reflections touching each row
+    set<int> x, cand;
+    for (int c=0; c<ncol; ++c) {
+      x.clear();
+      cand.clear();
+      for (int k=colind[pc[c]]; k<colind[pc[c]+1]; ++k) x.insert(prinv[row[k]]);
+      for (set<int>::const_iterator i=x.begin(); i!=x.end(); ++i) {
+        cand.insert(refl[*i].begin(), refl[*i].end());
+      }
+      while (!cand.empty()) {
+        int r = *cand.begin();
+        cand.erase(cand.begin());
+        for (int k=v_colind[r]; k<v_colind[r+1]; ++k) {
+          if (x.insert(v_row[k]).second) {
+            // Only reflections not yet applied can act on the new entry
+            for (vector<int>::const_iterator j=refl[v_row[k]].begin();
+                 j!=refl[v_row[k]].end(); ++j) {
+              if (*j>r) cand.insert(*j);
+            }
+          }
+        }
+        r_row.push_back(r);
+        x.erase(r);
+      }
+      r_row.push_back(c);
+      r_colind.push_back(r_row.size());
+      x.insert(c);
+      casadi_assert(*x.begin()==c);
+      for (set<int>::const_iterator i=x.begin(); i!=x.end(); ++i) {
+        v_row.push_back(*i);
+        refl[*i].push_back(c);
+      }
+      v_colind.push_back(v_row.size());
+    }
+    V = Sparsity(nrow, ncol, v_colind, v_row);
+    R = Sparsity(ncol, ncol, r_colind, r_row);
+  }
+
+  void SparsityInternal::lu_sparse(Sparsity& L, Sparsity& U, std::vector<int>& prinv,
+                                   std::vector<int>& pc, bool amd) const {
+    int n = size2();
+    casadi_assert_message(size1()==n, "lu_sparse: matrix must be square");
+
+    // Fill-reducing column ordering
+    if (amd) {
+      pc = this->amd(2);
+      pc.resize(n);
+    } else {
+      pc = range(n);
+    }
+
+    // Row permutation giving a zero-free diagonal
+    vector<int> tmp;
+    Sparsity C = permute(tmp, pc, 0);
+    vector<int> imatch, jmatch;
+    Sparsity trans;
+    C->maxTransversal(imatch, jmatch, trans, 0);
+    prinv.resize(n);
+    for (int i=0; i<n; ++i) {
+      casadi_assert_message(jmatch[i]>=0, "lu_sparse: matrix is structurally singular");
+      prinv[i] = jmatch[i];
+    }
+
+    // Left-looking symbolic factorization
+    const int* colind = C.colind();
+    const int* row = C.row();
+    vector<int> l_colind(1, 0), l_row, u_colind(1, 0), u_row;
+    set<int> x;
+    for (int c=0; c<n; ++c) {
+      x.clear();
+      for (int k=colind[c]; k<colind[c+1]; ++k) x.insert(prinv[row[k]]);
+      set<int>::const_iterator i;
+      for (i=x.begin(); i!=x.end() && *i<c; ++i) {
+        // Insertion leaves the iterator valid, new entries are larger than *i
+        x.insert(l_row.begin()+l_colind[*i], l_row.begin()+l_colind[*i+1]);
+        u_row.push_back(*i);
+      }
+      u_row.push_back(c);
+      u_colind.push_back(u_row.size());
+      for (; i!=x.end(); ++i) if (*i>c) l_row.push_back(*i);
+      l_colind.push_back(l_row.size());
+    }
+    L = Sparsity(n, n, l_colind, l_row);
+    U = Sparsity(n, n, u_colind, u_row);
+  }
+
+  void SparsityInternal::ldl_sparse(Sparsity& L, std::vector<int>& p, bool amd) const {
+    int n = size2();
+    casadi_assert_message(is_symmetric(), "ldl_sparse: pattern must be symmetric");
+
+    // Fill-reducing symmetric ordering
+    if (amd) {
+      p = this->amd(1);
+      p.resize(n);
+    } else {
+      p = range(n);
+    }
+    vector<int> pinv(n);
+    for (int i=0; i<n; ++i) pinv[p[i]] = i;
+
+    // Column j of L: entries of A(:, j) below the diagonal and those of its etree children
+    const int* colind = this->colind();
+    const int* row = this->row();
+    vector<int> l_colind(1, 0), l_row;
+    vector<vector<int> > children(n);
+    set<int> x;
+    for (int j=0; j<n; ++j) {
+      x.clear();
+      for (int k=colind[p[j]]; k<colind[p[j]+1]; ++k) {
+        if (pinv[row[k]]>j) x.insert(pinv[row[k]]);
+      }
+      for (vector<int>::const_iterator c=children[j].begin(); c!=children[j].end(); ++c) {
+        for (int k=l_colind[*c]; k<l_colind[*c+1]; ++k) {
+          if (l_row[k]>j) x.insert(l_row[k]);
+        }
+      }
+      if (!x.empty()) children[*x.begin()].push_back(j);
+      l_row.insert(l_row.end(), x.begin(), x.end());
+      l_colind.push_back(l_row.size());
+    }
+    L = Sparsity(n, n, l_colind, l_row);
+  }
+
   Sparsity SparsityInternal::get_diag(std::vector<int>& mapping) const {
     int nrow = this->size1();
     int ncol = this->size2();
@@ -206,6 +206,29 @@ namespace casadi {
                       std::vector<int>& parent, std::vector<int>& cp, std::vector<int>& leftmost,
                       int& m2, double& lnz, double& unz) const;
 
+    /** \brief Symbolic sparse QR: patterns of the Householder vectors V and of R
+     *
+     * Rows are permuted by prinv (old row to new row), columns by pc (new column to old
+     * column). The numeric phase is casadi_qr in the runtime.
+     */
+    void qr_sparse(Sparsity& V, Sparsity& R, std::vector<int>& prinv,
+                   std::vector<int>& pc, bool amd) const;
+
+    /** \brief Symbolic sparse LU: patterns of L (strictly lower) and U (diagonal last)
+     *
+     * Rows are permuted by prinv (old row to new row), columns by pc (new column to old
+     * column). The numeric phase is casadi_lu in the runtime.
+     */
+    void lu_sparse(Sparsity& L, Sparsity& U, std::vector<int>& prinv,
+                   std::vector<int>& pc, bool amd) const;
+
+    /** \brief Symbolic sparse LDL^T: pattern of the strictly lower L
+     *
+     * Symmetric permutation p (new index to old index). The numeric phase is casadi_ldl
+     * in the runtime.
+     */
+    void ldl_sparse(Sparsity& L, std::vector<int>& p, bool amd) const;
+
     /// clear w: cs_wclear in CSparse
     static int wclear(int mark, int lemax, int *w, int n);
 
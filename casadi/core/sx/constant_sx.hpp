@@ -113,6 +113,13 @@ class CASADI_EXPORT RealtypeSX : public ConstantSX {
       }
     }
 
+    /// Number of cached constants and their memory usage [bytes], estimate
+    static size_t cache_size() { return cached_constants_.size();}
+    static size_t cache_bytes() {
+      return cached_constants_.size()*(sizeof(RealtypeSX) + sizeof(std::pair<double, RealtypeSX*>)
+                                       + 2*sizeof(void*));
+    }
+
     ///@{
     /** \brief  Get the value */
     virtual double to_double() const { return value;}
@@ -169,6 +176,13 @@ class CASADI_EXPORT IntegerSX : public ConstantSX {
       }
     }
 
+    /// Number of cached constants and their memory usage [bytes], estimate
+    static size_t cache_size() { return cached_constants_.size();}
+    static size_t cache_bytes() {
+      return cached_constants_.size()*(sizeof(IntegerSX) + sizeof(std::pair<int, IntegerSX*>)
+                                       + 2*sizeof(void*));
+    }
+
     ///@{
     /** \brief  evaluate function */
     virtual double to_double() const {  return value; }
@@ -29,6 +29,7 @@
 #include "casadi/core/std_vector_tools.hpp"
 #include "../../core/global_options.hpp"
 #include "../../core/casadi_interrupt.hpp"
+#include "../../core/casadi_trace.hpp"
 
 #include <ctime>
 #include <stdlib.h>
@@ -166,6 +167,9 @@ namespace casadi {
       exact_hessian_ = hessian_approximation->second == "exact";
     }
 
+    // Combined, memoized functions, unless derivatives are provided by the user
+    if (grad_f_fcn_.is_null() && jac_g_fcn_.is_null()) init_fg();
+
     // Setup NLP functions
     f_fcn_ = create_function("nlp_f", {"x", "p"}, {"f"});
     g_fcn_ = create_function("nlp_g", {"x", "p"}, {"g"});
@@ -407,6 +411,7 @@ namespace casadi {
                         double regularization_size, double alpha_du, double alpha_pr,
                         int ls_trials, bool full_callback) const {
     m->n_iter += 1;
+    Trace::instant("iteration", "nlpsol");
     try {
       log("intermediate_callback started");
       if (gather_stats_) {
@@ -85,16 +85,25 @@ namespace casadi {
 
   // returns the value of the objective function
   bool IpoptUserClass::eval_f(Index n, const Number* x, bool new_x, Number& obj_value) {
+    if (!solver_.fg_fcn_.is_null()) {
+      return solver_.calc_fg(mem_, x, &obj_value, 0, 0, 0)==0;
+    }
     return solver_.calc_function(mem_, solver_.f_fcn_, {x, mem_->p}, {&obj_value})==0;
   }
 
   // return the gradient of the objective function grad_ {x} f(x)
   bool IpoptUserClass::eval_grad_f(Index n, const Number* x, bool new_x, Number* grad_f) {
+    if (!solver_.fg_fcn_.is_null()) {
+      return solver_.calc_fg(mem_, x, 0, 0, grad_f, 0)==0;
+    }
     return solver_.calc_function(mem_, solver_.grad_f_fcn_, {x, mem_->p}, {0, grad_f})==0;
   }
 
   // return the value of the constraints: g(x)
   bool IpoptUserClass::eval_g(Index n, const Number* x, bool new_x, Index m, Number* g) {
+    if (!solver_.fg_fcn_.is_null()) {
+      return solver_.calc_fg(mem_, x, 0, g, 0, 0)==0;
+    }
     return solver_.calc_function(mem_, solver_.g_fcn_, {x, mem_->p}, {g})==0;
   }
 
@@ -104,6 +113,9 @@ namespace casadi {
                                   Number* values) {
     if (values) {
       // Evaluate Jacobian
+      if (!solver_.fg_fcn_.is_null()) {
+        return solver_.calc_fg(mem_, x, 0, 0, 0, values)==0;
+      }
       return solver_.calc_function(mem_, solver_.jac_g_fcn_, {x, mem_->p}, {0, values})==0;
     } else {
       // Get the sparsity pattern
@@ -116,8 +116,8 @@ namespace casadi {
     if (exact_jacobian_) {
       switch (linsol_f_) {
       case SD_ITERATIVE:
-        f_fwd_ = f_.derivative(1, 0);
-        alloc(f_fwd_);
+        f_jvp_ = f_.jvp();
+        alloc(f_jvp_);
         break;
       default: break;
       }
@@ -126,8 +126,8 @@ namespace casadi {
     if (exact_jacobianB_) {
       switch (linsol_g_) {
       case SD_ITERATIVE:
-        g_fwd_ = g_.derivative(1, 0);
-        alloc(g_fwd_);
+        g_jvp_ = g_.jvp();
+        alloc(g_jvp_);
         break;
       default: break;
       }
@@ -795,22 +795,21 @@ namespace casadi {
     // Get time
     m->time1 = clock();
 
-    // Evaluate f_fwd_
-    m->arg[DAE_T] = &t;
-    m->arg[DAE_X] = NV_DATA_S(x);
-    m->arg[DAE_Z] = 0;
-    m->arg[DAE_P] = get_ptr(m->p);
-    m->arg[DAE_NUM_IN + DAE_T] = 0;
-    m->arg[DAE_NUM_IN + DAE_X] = NV_DATA_S(v);
-    m->arg[DAE_NUM_IN + DAE_Z] = 0;
-    m->arg[DAE_NUM_IN + DAE_P] = 0;
-    m->res[DAE_ODE] = 0;
-    m->res[DAE_ALG] = 0;
-    m->res[DAE_QUAD] = 0;
-    m->res[DAE_NUM_OUT + DAE_ODE] = NV_DATA_S(Jv);
-    m->res[DAE_NUM_OUT + DAE_ALG] = 0;
-    m->res[DAE_NUM_OUT + DAE_QUAD] = 0;
-    f_fwd_(m->arg, m->res, m->iw, m->w, 0);
+    // Evaluate J*v
+    const double *x1[DAE_NUM_IN], *v1[DAE_NUM_IN];
+    double* r1[DAE_NUM_OUT];
+    x1[DAE_T] = &t;
+    x1[DAE_X] = NV_DATA_S(x);
+    x1[DAE_Z] = 0;
+    x1[DAE_P] = get_ptr(m->p);
+    v1[DAE_T] = 0;
+    v1[DAE_X] = NV_DATA_S(v);
+    v1[DAE_Z] = 0;
+    v1[DAE_P] = 0;
+    r1[DAE_ODE] = NV_DATA_S(Jv);
+    r1[DAE_ALG] = 0;
+    r1[DAE_QUAD] = 0;
+    f_jvp_(x1, v1, r1, 0, m->arg, m->res, m->iw, m->w);
 
     // Log time duration
     m->time2 = clock();
@@ -825,38 +824,22 @@ namespace casadi {
     // Get time
     m->time1 = clock();
 
-    // Hack:
-    vector<const double*> arg1(g_fwd_.sz_arg());
-    const double** arg1_ = get_ptr(arg1);
-    vector<double*> res1(g_fwd_.sz_res());
-    double** res1_ = get_ptr(res1);
-    vector<int> iw(g_fwd_.sz_iw());
-    int* iw_ = get_ptr(iw);
-    vector<double> w(g_fwd_.sz_w());
-    double* w_ = get_ptr(w);
-
-    // Evaluate g_fwd_
-    arg1_[RDAE_T] = &t;
-    arg1_[RDAE_X] = NV_DATA_S(x);
-    arg1_[RDAE_Z] = 0;
-    arg1_[RDAE_P] = get_ptr(m->p);
-    arg1_[RDAE_RX] = NV_DATA_S(rx);
-    arg1_[RDAE_RZ] = 0;
-    arg1_[RDAE_RP] = get_ptr(m->rp);;
-    arg1_[RDAE_NUM_IN + RDAE_T] = 0;
-    arg1_[RDAE_NUM_IN + RDAE_X] = 0;
-    arg1_[RDAE_NUM_IN + RDAE_Z] = 0;
-    arg1_[RDAE_NUM_IN + RDAE_P] = 0;
-    arg1_[RDAE_NUM_IN + RDAE_RX] = NV_DATA_S(v);
-    arg1_[RDAE_NUM_IN + RDAE_RZ] = 0;
-    arg1_[RDAE_NUM_IN + RDAE_RP] = 0;
-    res1_[RDAE_ODE] = 0;
-    res1_[RDAE_ALG] = 0;
-    res1_[RDAE_QUAD] = 0;
-    res1_[RDAE_NUM_OUT + RDAE_ODE] = NV_DATA_S(Jv);
-    res1_[RDAE_NUM_OUT + RDAE_ALG] = 0;
-    res1_[RDAE_NUM_OUT + RDAE_QUAD] = 0;
-    g_fwd_(arg1_, res1_, iw_, w_, 0);
+    // Evaluate J*v
+    const double *x1[RDAE_NUM_IN], *v1[RDAE_NUM_IN];
+    double* r1[RDAE_NUM_OUT];
+    x1[RDAE_T] = &t;
+    x1[RDAE_X] = NV_DATA_S(x);
+    x1[RDAE_Z] = 0;
+    x1[RDAE_P] = get_ptr(m->p);
+    x1[RDAE_RX] = NV_DATA_S(rx);
+    x1[RDAE_RZ] = 0;
+    x1[RDAE_RP] = get_ptr(m->rp);
+    fill_n(v1, RDAE_NUM_IN, nullptr);
+    v1[RDAE_RX] = NV_DATA_S(v);
+    r1[RDAE_ODE] = NV_DATA_S(Jv);
+    r1[RDAE_ALG] = 0;
+    r1[RDAE_QUAD] = 0;
+    g_jvp_(x1, v1, r1, 0, m->arg, m->res, m->iw, m->w);
 
     // Log time duration
     m->time2 = clock();
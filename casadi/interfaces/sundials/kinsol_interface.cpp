@@ -232,8 +232,7 @@ namespace casadi {
       }
       if (exact_jacobian_) {
         // Form the Jacobian-times-vector function
-        f_fwd_ = f_.derivative(1, 0);
-        alloc(f_fwd_);
+        init_jtimes();
       }
       if (use_preconditioner_) {
         // Make sure that a Jacobian has been provided
@@ -251,8 +250,7 @@ namespace casadi {
       casadi_assert(!linsol_.is_null());
 
       // Form the Jacobian-times-vector function
-      f_fwd_ = f_.derivative(1, 0);
-      alloc(f_fwd_);
+      init_jtimes();
 
       // Allocate space for Jacobian
       alloc_w(jac_.nnz_out(0), true);
@@ -492,23 +490,34 @@ namespace casadi {
     }
   }
 
+  void KinsolInterface::init_jtimes() {
+    f_jvp_ = f_.jvp();
+    size_t sz_arg, sz_res, sz_iw, sz_w;
+    f_jvp_.sz_work(sz_arg, sz_res, sz_iw, sz_w);
+    alloc_arg(2*n_in() + sz_arg);
+    alloc_res(n_out() + sz_res);
+    alloc_iw(sz_iw);
+    alloc_w(sz_w);
+  }
+
   void KinsolInterface::jtimes(KinsolMemory& m, N_Vector v, N_Vector Jv,
                             N_Vector u, int* new_u) const {
     // Get time
     m.time1 = clock();
 
-    // Temporary memory
-    const double** arg1 = m.arg + n_in();
-    double** res1 = m.res + n_out();
-
-    // Evaluate f_fwd_
-    copy(m.arg, m.arg + n_in(), arg1);
-    arg1[iin_] = NV_DATA_S(u);
-    fill_n(arg1 + n_in(), n_in(), nullptr);
-    arg1[n_in()+iin_] = NV_DATA_S(v);
-    fill_n(res1, f_fwd_.n_out(), nullptr);
-    res1[n_out()] = NV_DATA_S(Jv);
-    f_fwd_(arg1, res1, m.iw, m.w, 0);
+    // Nondifferentiated inputs, seeds and sensitivities, cf. init_jtimes
+    const double** x1 = m.arg + n_in();
+    const double** v1 = x1 + n_in();
+    double** r1 = m.res + n_out();
+
+    // Evaluate J*v
+    copy(m.arg, m.arg + n_in(), x1);
+    x1[iin_] = NV_DATA_S(u);
+    fill_n(v1, n_in(), nullptr);
+    v1[iin_] = NV_DATA_S(v);
+    fill_n(r1, n_out(), nullptr);
+    r1[iout_] = NV_DATA_S(Jv);
+    f_jvp_(x1, v1, r1, 0, v1 + n_in(), r1 + n_out(), m.iw, m.w);
 
     // Log time duration
     m.time2 = clock();
@@ -147,7 +147,7 @@ namespace casadi {
     double abstol_;
 
     // Jacobian times vector function
-    Function f_fwd_;
+    JacobianProduct f_jvp_;
 
     // Raise an error specific to KinSol
     void kinsol_error(const std::string& module, int flag, bool fatal=true) const;
@@ -171,6 +171,9 @@ namespace casadi {
     void bjac(KinsolMemory& m, long N, long mupper, long mlower, N_Vector u, N_Vector fu, DlsMat J,
               N_Vector tmp1, N_Vector tmp2) const;
     void jtimes(KinsolMemory& m, N_Vector v, N_Vector Jv, N_Vector u, int* new_u) const;
+
+    /// Form the Jacobian-times-vector products and allocate work vectors for jtimes
+    void init_jtimes();
     void psetup(KinsolMemory& m, N_Vector u, N_Vector uscale, N_Vector fval, N_Vector fscale,
                 N_Vector tmp1, N_Vector tmp2) const;
     void psolve(KinsolMemory& m, N_Vector u, N_Vector uscale,
@@ -162,8 +162,8 @@ namespace casadi {
     // Jacobian of the DAE with respect to the state and state derivatives
     Function jac_, jacB_;
 
-    // Jacobian times vector functions
-    Function f_fwd_, g_fwd_;
+    // Jacobian-times-vector products
+    JacobianProduct f_jvp_, g_jvp_;
 
     /** \brief  Get the integrator Jacobian for the forward problem */
     virtual Function getJac()=0;
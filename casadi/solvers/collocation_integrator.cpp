@@ -330,4 +330,16 @@ namespace casadi {
     }
   }
 
+  void CollocationIntegrator::generate_guess(CodeGenerator& g, bool backward,
+                                             const std::string& x, const std::string& z,
+                                             const std::string& Z) const {
+    // Same guess for all collocation points
+    int nx = backward ? nrx_ : nx_, nz = backward ? nrz_ : nz_;
+    for (int d=0; d<deg_; ++d) {
+      int off = d*(nx+nz);
+      g.body << "  " << g.copy(x, nx, Z + "+" + g.to_string(off)) << endl
+             << "  " << g.copy(z, nz, Z + "+" + g.to_string(off+nx)) << endl;
+    }
+  }
+
 } // namespace casadi
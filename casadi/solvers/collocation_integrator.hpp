@@ -94,6 +94,10 @@ namespace casadi {
     virtual void resetB(IntegratorMemory* mem, double t, const double* rx,
                         const double* rz, const double* rp) const;
 
+    /// Generate code for the initial guess of the discrete time algebraic variables
+    virtual void generate_guess(CodeGenerator& g, bool backward, const std::string& x,
+                                const std::string& z, const std::string& Z) const;
+
     // Interpolation order
     int deg_;
 
@@ -202,6 +202,73 @@ namespace casadi {
     casadi_msg("Newton::solveNonLinear():end after " << iter << " steps");
   }
 
+  void Newton::generateDeclarations(CodeGenerator& g) const {
+    // Generate code for the embedded functions
+    jac_->addDependency(g);
+    linsol_->addDependency(g);
+  }
+
+  void Newton::generateBody(CodeGenerator& g) const {
+    // IO buffers and work vectors, as in eval
+    g.body << "  const real_t** arg1 = arg + " << n_in() << ";" << endl
+           << "  real_t** res1 = res + " << n_out() << ";" << endl
+           << "  real_t* x = w; w += " << n_ << ";" << endl
+           << "  real_t* f = w; w += " << jac_.nnz_out(1+iout_) << ";" << endl
+           << "  real_t* jac = w; w += " << jac_.nnz_out(0) << ";" << endl
+           << "  real_t abstol, abstolStep;" << endl
+           << "  int i, iter;" << endl;
+
+    // Get the initial guess
+    g.body << "  " << g.copy("arg[" + g.to_string(iin_) + "]", n_, "x") << endl;
+
+    // Perform the Newton iterations
+    g.body << "  for (iter=1; iter<=" << max_iter_ << "; ++iter) {" << endl;
+
+    // Use x to evaluate J
+    g.body << "    for (i=0; i<" << n_in() << "; ++i) arg1[i] = arg[i];" << endl
+           << "    arg1[" << iin_ << "] = x;" << endl
+           << "    res1[0] = jac;" << endl
+           << "    for (i=0; i<" << n_out() << "; ++i) res1[i+1] = res[i];" << endl
+           << "    res1[" << (1+iout_) << "] = f;" << endl
+           << "    if (" << g(jac_, "arg1", "res1", "iw", "w") << ") return 1;" << endl;
+
+    // Check convergence
+    g.body << "    abstol = 0;" << endl;
+    if (abstol_ != numeric_limits<double>::infinity()) {
+      g.body << "    for (i=0; i<" << n_ << "; ++i) "
+             << "if (fabs(f[i])>abstol) abstol = fabs(f[i]);" << endl
+             << "    if (abstol <= " << g.constant(abstol_) << ") break;" << endl;
+    }
+
+    // Factorize and solve with J, overwriting f with the step
+    g.body << "    arg1[" << LINSOL_A << "] = jac;" << endl
+           << "    arg1[" << LINSOL_B << "] = f;" << endl
+           << "    res1[" << LINSOL_X << "] = f;" << endl
+           << "    if (" << g(linsol_, "arg1", "res1", "iw", "w") << ") return 1;" << endl;
+
+    // Check convergence again
+    g.body << "    abstolStep = 0;" << endl;
+    if (abstolStep_ != numeric_limits<double>::infinity()) {
+      g.body << "    for (i=0; i<" << n_ << "; ++i) "
+             << "if (fabs(f[i])>abstolStep) abstolStep = fabs(f[i]);" << endl
+             << "    if (abstolStep <= " << g.constant(abstolStep_) << ") break;" << endl;
+    }
+
+    // Print iteration information
+    if (print_iteration_) {
+      g.body << "    " << g.printf("%5d %10.2e %10.2e\\n", "iter", "abstol", "abstolStep")
+             << endl;
+    }
+
+    // Update Xk+1 = Xk - J^(-1) F
+    g.addAuxiliary(CodeGenerator::AUX_AXPY);
+    g.body << "    axpy(" << n_ << ", -1., f, x);" << endl
+           << "  }" << endl;
+
+    // Get the solution
+    g.body << "  " << g.copy("x", n_, "res[" + g.to_string(iout_) + "]") << endl;
+  }
+
   void Newton::printIteration(std::ostream &stream) const {
     stream << setw(5) << "iter";
     stream << setw(10) << "res";
@@ -91,6 +91,12 @@ namespace casadi {
     virtual void eval(void* mem, const double** arg, double** res,
                       int* iw, double* w) const;
 
+    /** \brief Generate code for the declarations of the C function */
+    virtual void generateDeclarations(CodeGenerator& g) const;
+
+    /** \brief Generate code for the body of the C function */
+    virtual void generateBody(CodeGenerator& g) const;
+
     /// A documentation string
     static const std::string meta_doc;
 
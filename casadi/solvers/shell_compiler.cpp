@@ -26,10 +26,21 @@
 #include "shell_compiler.hpp"
 #include "casadi/core/std_vector_tools.hpp"
 #include "casadi/core/casadi_meta.hpp"
+#include "casadi/core/global_options.hpp"
+#include "casadi/core/function/code_generator.hpp"
+#include "casadi/core/function/async_call.hpp"
 #include <fstream>
+#include <sstream>
+#include <random>
+#include <algorithm>
 #include <dlfcn.h>
 #include <cstdlib>
+#include <cstdio>
+#include <ctime>
 #include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
 
 using namespace std;
 namespace casadi {
@@ -50,17 +61,19 @@ namespace casadi {
   }
 
   ShellCompiler::ShellCompiler(const std::string& name) :
-    CompilerInternal(name) {
+    CompilerInternal(name), handle_(0) {
   }
 
   ShellCompiler::~ShellCompiler() {
     // Unload
     if (handle_) dlclose(handle_);
 
-    // Delete the temporary file
-    std::string rmcmd = "rm " + bin_name_;
-    if (system(rmcmd.c_str())) {
-      casadi_warning("Failed to delete temporary file:" + bin_name_);
+    // Delete the temporary file, libraries in the cache are kept
+    if (!bin_name_.empty()) {
+      std::string rmcmd = "rm " + bin_name_;
+      if (system(rmcmd.c_str())) {
+        casadi_warning("Failed to delete temporary file:" + bin_name_);
+      }
     }
   }
 
@@ -76,7 +89,18 @@ namespace casadi {
         " custom flags."}},
       {"flags",
        {OT_STRINGVECTOR,
-      "Compile flags for the JIT compiler. Default: None"}}
+      "Compile flags for the JIT compiler. Default: None"}},
+      {"cache",
+       {OT_BOOL,
+        "Use the persistent compile cache, if a cache directory is set [true]"}},
+      {"cache_dir",
+       {OT_STRING,
+        "Directory of the persistent compile cache. "
+        "Default: GlobalOptions::jit_cache_dir"}},
+      {"extra_sources",
+       {OT_STRINGVECTOR,
+        "Additional source files, e.g. from CodeGenerator in split mode. "
+        "All sources are compiled in parallel and linked into one library"}}
      }
   };
 
@@ -88,6 +112,8 @@ namespace casadi {
     string compiler = "gcc";
     string compiler_setup = "-fPIC -shared";
     vector<string> flags;
+    bool cache = true;
+    cache_dir_ = GlobalOptions::jit_cache_dir;
 
     // Read options
     for (auto&& op : opts) {
@@ -97,8 +123,15 @@ namespace casadi {
         compiler_setup = op.second.to_string();
       } else if (op.first=="flags") {
         flags = op.second;
+      } else if (op.first=="cache") {
+        cache = op.second;
+      } else if (op.first=="cache_dir") {
+        cache_dir_ = op.second.to_string();
+      } else if (op.first=="extra_sources") {
+        extra_sources_ = op.second;
       }
     }
+    if (!cache) cache_dir_.clear();
 
     // Construct the compiler command
     stringstream cmd;
@@ -107,8 +140,43 @@ namespace casadi {
       cmd << " " << *i;
     }
 
-    // C/C++ source file
-    cmd << " " << name_;
+    // Look up the persistent compile cache
+    if (!cache_dir_.empty()) {
+      stringstream ss;
+      set<string> visited;
+      for (int k=-1; k<static_cast<int>(extra_sources_.size()); ++k) {
+        const string& fname = k<0 ? name_ : extra_sources_[k];
+        ifstream src(fname.c_str());
+        casadi_assert_message(src.good(), "ShellCompiler: Cannot read " + fname);
+        if (k>=0) ss << '\0';
+        cache_source(fname, ss, visited);
+      }
+      string lib = cache_dir_ + "/jit_" + cache_key(ss.str(), cmd.str()) + ".so";
+
+      // Cache hit, mark as recently used
+      if (load(lib)) {
+        utime(lib.c_str(), 0);
+        return;
+      }
+
+      // Cache miss, compile to a temporary file and atomically move into place,
+      // so that concurrent processes never load a partially written library
+      static std::random_device rd;
+      stringstream tmpname;
+      tmpname << lib << ".tmp" << hex << rd();
+      compile(cmd.str(), tmpname.str());
+      if (rename(tmpname.str().c_str(), lib.c_str())==0) {
+        cache_evict(cache_dir_, GlobalOptions::jit_cache_size, lib);
+        casadi_assert_message(load(lib), "ShellCompiler: Cannot open function: "
+                              << lib << ". error code: "<< dlerror());
+      } else {
+        casadi_warning("ShellCompiler: Cannot add " + lib + " to the cache");
+        bin_name_ = tmpname.str();
+        casadi_assert_message(load(bin_name_), "ShellCompiler: Cannot open function: "
+                              << bin_name_ << ". error code: "<< dlerror());
+      }
+      return;
+    }
 
     // Name of temporary file
 #ifdef HAVE_MKSTEMPS
@@ -130,20 +198,151 @@ namespace casadi {
       bin_name_ = "./" + bin_name_;
     }
 
-    // Temporary file
-    cmd << " -o " << bin_name_;
-
     // Compile into a shared library
-    if (system(cmd.str().c_str())) {
-      casadi_error("Compilation failed. Tried \"" + cmd.str() + "\"");
-    }
+    compile(cmd.str(), bin_name_);
 
     // Load shared library
-    handle_ = dlopen(bin_name_.c_str(), RTLD_LAZY);
-    casadi_assert_message(handle_!=0, "CommonExternal: Cannot open function: "
+    casadi_assert_message(load(bin_name_), "CommonExternal: Cannot open function: "
                           << bin_name_ << ". error code: "<< dlerror());
+  }
+
+  void ShellCompiler::compile(const std::string& cmd, const std::string& bin_name) const {
+    // Single source file
+    if (extra_sources_.empty()) {
+      string cmd_out = cmd + " " + name_ + " -o " + bin_name;
+      if (system(cmd_out.c_str())) {
+        casadi_error("Compilation failed. Tried \"" + cmd_out + "\"");
+      }
+      return;
+    }
+
+    // Compile all sources to object files in parallel
+    vector<string> src = extra_sources_;
+    src.insert(src.begin(), name_);
+    vector<string> cmd_obj(src.size());
+    vector<int> status(src.size(), 0);
+    string objs;
+    for (int k=0; k<src.size(); ++k) {
+      string obj = bin_name + "." + CodeGenerator::to_string(k) + ".o";
+      cmd_obj[k] = cmd + " -c " + src[k] + " -o " + obj;
+      objs += " " + obj;
+    }
+    AsyncExecutor::parallel_for(src.size(), [&](int k) {
+      status[k] = system(cmd_obj[k].c_str());
+    });
+
+    // Link into one shared library
+    string cmd_out = cmd + objs + " -o " + bin_name;
+    bool failed = false;
+    for (int k=0; k<src.size(); ++k) {
+      if (status[k]) {
+        cmd_out = cmd_obj[k];
+        failed = true;
+        break;
+      }
+    }
+    if (!failed) failed = system(cmd_out.c_str())!=0;
+    string rmcmd = "rm -f" + objs;
+    if (system(rmcmd.c_str())) {
+      casadi_warning("Failed to delete temporary files:" + objs);
+    }
+    if (failed) {
+      casadi_error("Compilation failed. Tried \"" + cmd_out + "\"");
+    }
+  }
+
+  bool ShellCompiler::load(const std::string& bin_name) {
+    handle_ = dlopen(bin_name.c_str(), RTLD_LAZY);
+    if (handle_==0) return false;
     // reset error
     dlerror();
+    return true;
+  }
+
+  void ShellCompiler::cache_source(const std::string& fname, std::ostream& ss,
+                                   std::set<std::string>& visited) {
+    ifstream src(fname.c_str());
+    if (!src.good() || !visited.insert(fname).second) return;
+
+    // Quoted includes are looked up relative to the including file first
+    string::size_type sep = fname.find_last_of("/\\");
+    string dir = sep==string::npos ? "" : fname.substr(0, sep+1);
+    vector<string> includes;
+    string line;
+    while (getline(src, line)) {
+      ss << line << '\n';
+      string::size_type i = line.find_first_not_of(" \t");
+      if (i==string::npos || line[i]!='#') continue;
+      i = line.find_first_not_of(" \t", i+1);
+      if (i==string::npos || line.compare(i, 7, "include")!=0) continue;
+      string::size_type b = line.find('"', i+7);
+      if (b==string::npos) continue;
+      string::size_type e = line.find('"', b+1);
+      if (e==string::npos) continue;
+      includes.push_back(dir + line.substr(b+1, e-b-1));
+    }
+
+    // Hash the headers after the file, tagged with their names
+    for (auto&& inc : includes) {
+      if (visited.count(inc)) continue;
+      ss << '\0' << inc << '\0';
+      cache_source(inc, ss, visited);
+    }
+  }
+
+  std::string ShellCompiler::cache_key(const std::string& src, const std::string& cmd) {
+    // Two 64-bit FNV-1a hashes with different offset bases
+    uint64_t h1 = 14695981039346656037ULL, h2 = 7809847782465536322ULL;
+    for (const string* s : {&cmd, &src}) {
+      for (unsigned char c : *s) {
+        h1 = (h1 ^ c) * 1099511628211ULL;
+        h2 = (h2 ^ c) * 1099511628211ULL;
+      }
+      // Separator, so that the command and the source cannot be shifted
+      h1 = (h1 ^ 0xff) * 1099511628211ULL;
+      h2 = (h2 ^ 0xff) * 1099511628211ULL;
+    }
+    stringstream ss;
+    ss << hex << h1 << "_" << h2 << "_" << src.size();
+    return ss.str();
+  }
+
+  void ShellCompiler::cache_evict(const std::string& dir, long max_size,
+                                  const std::string& keep) {
+    // Libraries in the cache, with time of last use and size
+    vector<pair<time_t, pair<long, string> > > entries;
+    long total = 0;
+    DIR* d = opendir(dir.c_str());
+    if (d==0) return;
+    time_t now = time(0);
+    while (dirent* e = readdir(d)) {
+      string fname = e->d_name;
+      if (fname.compare(0, 4, "jit_")!=0) continue;
+      string path = dir + "/" + fname;
+      struct stat st;
+      if (stat(path.c_str(), &st)!=0) continue;
+
+      // Leftovers of compilations that were interrupted before the rename. Files
+      // that are more than an hour old are no longer being written
+      if (fname.find(".so.tmp")!=string::npos) {
+        if (difftime(now, st.st_mtime)>3600) remove(path.c_str());
+        continue;
+      }
+      if (fname.size()<3 || fname.compare(fname.size()-3, 3, ".so")!=0) continue;
+      total += static_cast<long>(st.st_size);
+      if (path!=keep) {
+        entries.push_back(make_pair(st.st_mtime, make_pair(st.st_size, path)));
+      }
+    }
+    closedir(d);
+
+    // Remove least recently used first. Libraries loaded by another process stay
+    // valid until unloaded, they are only unlinked
+    sort(entries.begin(), entries.end());
+    for (auto&& e : entries) {
+      if (total<=max_size) break;
+      if (remove(e.second.second.c_str())==0) total -= e.second.first;
+    }
   }
 
   void* ShellCompiler::getFunction(const std::string& symname) {
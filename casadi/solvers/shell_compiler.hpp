@@ -28,6 +28,7 @@
 
 #include "casadi/core/function/compiler_internal.hpp"
 #include <casadi/solvers/casadi_compiler_shell_export.h>
+#include <set>
 
 /** \defgroup plugin_Compiler_shell
       Interface to the JIT compiler SHELL
@@ -77,10 +78,35 @@ namespace casadi {
 
     /// Get a function pointer for numerical evaluation
     virtual void* getFunction(const std::string& symname);
+
+    /// Compile the source file(s) into a shared library
+    void compile(const std::string& cmd, const std::string& bin_name) const;
+
+    /// Load a shared library, returns false if it could not be loaded
+    bool load(const std::string& bin_name);
+
+    /** \brief Append a source file and the local headers it includes, recursively,
+     * to the cache key source. Headers that are not found next to the including
+     * file, e.g. system headers, are skipped */
+    static void cache_source(const std::string& fname, std::ostream& ss,
+                             std::set<std::string>& visited);
+
+    /// Cache key: hash of the source code and the compiler command
+    static std::string cache_key(const std::string& src, const std::string& cmd);
+
+    /// Remove least recently used libraries from the cache, except \a keep, and stale
+    /// temporary files
+    static void cache_evict(const std::string& dir, long max_size, const std::string& keep);
   protected:
-    /// Temporary file
+    /// Temporary file, deleted on destruction
     std::string bin_name_;
 
+    /// Directory of the persistent compile cache, empty if disabled
+    std::string cache_dir_;
+
+    /// Source files compiled and linked together with the main one
+    std::vector<std::string> extra_sources_;
+
     // Shared library handle
     typedef void* handle_t;
     handle_t handle_;
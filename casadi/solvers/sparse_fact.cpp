@@ -0,0 +1,217 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "sparse_fact.hpp"
+#include "casadi/core/sparsity_internal.hpp"
+
+using namespace std;
+namespace casadi {
+
+  extern "C"
+  int CASADI_LINSOL_SPARSEFACT_EXPORT
+  casadi_register_linsol_sparsefact(Linsol::Plugin* plugin) {
+    plugin->creator = SparseFact::creator;
+    plugin->name = "sparsefact";
+    plugin->doc = SparseFact::meta_doc.c_str();
+    plugin->version = 30;
+    return 0;
+  }
+
+  extern "C"
+  void CASADI_LINSOL_SPARSEFACT_EXPORT casadi_load_linsol_sparsefact() {
+    Linsol::registerPlugin(casadi_register_linsol_sparsefact);
+  }
+
+  SparseFact::SparseFact(const std::string& name, const Sparsity& sparsity, int nrhs) :
+    Linsol(name, sparsity, nrhs) {
+  }
+
+  SparseFact::~SparseFact() {
+    clear_memory();
+  }
+
+  Options SparseFact::options_
+  = {{&FunctionInternal::options_},
+    {{"method",
+      {OT_STRING,
+       "Factorization method: qr (default), lu or ldl (symmetric matrices)"}},
+     {"amd",
+      {OT_BOOL,
+       "Use an approximate minimum degree fill-reducing ordering [true]"}},
+     {"pivot_tol",
+      {OT_DOUBLE,
+       "Static pivoting threshold for lu and ldl, relative to the largest entry "
+       "of the matrix [1e-12]"}}
+    }
+  };
+
+  void SparseFact::init(const Dict& opts) {
+    // Call the base class initializer
+    Linsol::init(opts);
+
+    // Default options
+    string method = "qr";
+    bool amd = true;
+    pivot_tol_ = 1e-12;
+
+    // Read options
+    for (auto&& op : opts) {
+      if (op.first=="method") {
+        method = op.second.to_string();
+      } else if (op.first=="amd") {
+        amd = op.second;
+      } else if (op.first=="pivot_tol") {
+        pivot_tol_ = op.second;
+      }
+    }
+
+    // Symbolic analysis
+    if (method=="qr") {
+      method_ = QR;
+      sparsity_->qr_sparse(sp1_, sp2_, prinv_, pc_, amd);
+    } else if (method=="lu") {
+      method_ = LU;
+      sparsity_->lu_sparse(sp1_, sp2_, prinv_, pc_, amd);
+    } else if (method=="ldl") {
+      method_ = LDL;
+      sparsity_->ldl_sparse(sp1_, pc_, amd);
+      sp2_ = sp1_.T();
+    } else {
+      casadi_error("SparseFact: Unknown method \"" + method + "\", "
+                   "expected \"qr\", \"lu\" or \"ldl\"");
+    }
+    casadi_assert(pivot_tol_>=0);
+
+    if (verbose()) {
+      userOut() << "SparseFact: " << method << " factorization with "
+                << sp1_.nnz() << "+" << sp2_.nnz() << " structural nonzeros in the factors"
+                << endl;
+    }
+
+    // Storage for the factorization and work vector in generated code
+    alloc_w(sp1_.nnz() + (method_==LDL ? 0 : sp2_.nnz()) + (method_==LU ? 0 : neq_), true);
+    alloc_w(neq_, true);
+    if (method_==LDL) alloc_iw(2*neq_, true);
+  }
+
+  void SparseFact::init_memory(void* mem) const {
+    auto m = static_cast<SparseFactMemory*>(mem);
+    m->f1.resize(sp1_.nnz());
+    m->f2.resize(method_==LDL ? 0 : sp2_.nnz());
+    m->f3.resize(method_==LU ? 0 : neq_);
+    m->w.resize(neq_);
+    m->iw.resize(method_==LDL ? 2*neq_ : 0);
+  }
+
+  void SparseFact::linsol_factorize(void* mem, const double* A) const {
+    auto m = static_cast<SparseFactMemory*>(mem);
+    int npert = 0;
+    switch (method_) {
+    case QR:
+      casadi_qr(sparsity_, A, get_ptr(m->w), sp1_, get_ptr(m->f1), sp2_, get_ptr(m->f2),
+                get_ptr(m->f3), get_ptr(prinv_), get_ptr(pc_));
+      break;
+    case LU:
+      npert = casadi_lu(sparsity_, A, get_ptr(m->w), sp1_, get_ptr(m->f1), sp2_,
+                        get_ptr(m->f2), get_ptr(prinv_), get_ptr(pc_), pivot_tol_);
+      break;
+    case LDL:
+      npert = casadi_ldl(sparsity_, A, sp2_, sp1_, get_ptr(m->f1), get_ptr(m->f3),
+                         get_ptr(pc_), pivot_tol_, get_ptr(m->w), get_ptr(m->iw));
+      break;
+    }
+    if (npert>0 && verbose()) {
+      userOut() << "SparseFact: " << npert << " pivot(s) perturbed" << endl;
+    }
+  }
+
+  void SparseFact::linsol_solve(void* mem, double* x, int nrhs, bool tr) const {
+    auto m = static_cast<SparseFactMemory*>(mem);
+    switch (method_) {
+    case QR:
+      casadi_qr_solve(x, nrhs, tr, sp1_, get_ptr(m->f1), sp2_, get_ptr(m->f2),
+                      get_ptr(m->f3), get_ptr(prinv_), get_ptr(pc_), get_ptr(m->w));
+      break;
+    case LU:
+      casadi_lu_solve(x, nrhs, tr, sp1_, get_ptr(m->f1), sp2_, get_ptr(m->f2),
+                      get_ptr(prinv_), get_ptr(pc_), get_ptr(m->w));
+      break;
+    case LDL:
+      casadi_ldl_solve(x, nrhs, sp1_, get_ptr(m->f1), get_ptr(m->f3), get_ptr(pc_),
+                       get_ptr(m->w));
+      break;
+    }
+  }
+
+  void SparseFact::generateBody(CodeGenerator& g) const {
+    // Constant data
+    string s_a = g.sparsity(sparsity_);
+    string s_1 = g.sparsity(sp1_), s_2 = g.sparsity(sp2_);
+    string s_pc = "s" + g.to_string(g.getConstant(pc_, true));
+    string s_prinv = method_==LDL ? "" : "s" + g.to_string(g.getConstant(prinv_, true));
+
+    // Factors, followed by the work vector
+    int nnz2 = method_==LDL ? 0 : sp2_.nnz(), n3 = method_==LU ? 0 : neq_;
+    g.body << "  real_t *f1 = w";
+    if (nnz2) g.body << ", *f2 = w+" << sp1_.nnz();
+    if (n3) g.body << ", *f3 = w+" << (sp1_.nnz() + nnz2);
+    g.body << ";" << endl
+           << "  w += " << (sp1_.nnz() + nnz2 + n3) << ";" << endl;
+
+    // Quick return if no solution requested
+    g.body << "  if (!res[" << LINSOL_X << "]) return 0;" << endl;
+
+    // The right hand side may alias the solution
+    g.body << "  " << g.copy("arg[" + g.to_string(LINSOL_B) + "]", neq_*nrhs_,
+                             "res[" + g.to_string(LINSOL_X) + "]") << endl;
+
+    // Factorize and solve
+    string a = "arg[" + g.to_string(LINSOL_A) + "]", x = "res[" + g.to_string(LINSOL_X) + "]";
+    switch (method_) {
+    case QR:
+      g.addAuxiliary(CodeGenerator::AUX_QR);
+      g.body << "  qr(" << s_a << ", " << a << ", w, " << s_1 << ", f1, " << s_2 << ", f2, f3, "
+             << s_prinv << ", " << s_pc << ");" << endl
+             << "  qr_solve(" << x << ", " << nrhs_ << ", 0, " << s_1 << ", f1, " << s_2
+             << ", f2, f3, " << s_prinv << ", " << s_pc << ", w);" << endl;
+      break;
+    case LU:
+      g.addAuxiliary(CodeGenerator::AUX_LU);
+      g.body << "  lu(" << s_a << ", " << a << ", w, " << s_1 << ", f1, " << s_2 << ", f2, "
+             << s_prinv << ", " << s_pc << ", " << g.constant(pivot_tol_) << ");" << endl
+             << "  lu_solve(" << x << ", " << nrhs_ << ", 0, " << s_1 << ", f1, " << s_2
+             << ", f2, " << s_prinv << ", " << s_pc << ", w);" << endl;
+      break;
+    case LDL:
+      g.addAuxiliary(CodeGenerator::AUX_LDL);
+      g.body << "  ldl(" << s_a << ", " << a << ", " << s_2 << ", " << s_1 << ", f1, f3, "
+             << s_pc << ", " << g.constant(pivot_tol_) << ", w, iw);" << endl
+             << "  ldl_solve(" << x << ", " << nrhs_ << ", " << s_1 << ", f1, f3, " << s_pc
+             << ", w);" << endl;
+      break;
+    }
+  }
+
+} // namespace casadi
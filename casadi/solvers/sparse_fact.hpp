@@ -0,0 +1,123 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifndef CASADI_SPARSE_FACT_HPP
+#define CASADI_SPARSE_FACT_HPP
+
+#include "casadi/core/function/linsol_impl.hpp"
+#include <casadi/solvers/casadi_linsol_sparsefact_export.h>
+
+/** \defgroup plugin_Linsol_sparsefact
+
+       Linsol based on sparse direct factorizations (QR, LU with static pivoting or LDL^T).
+      The symbolic analysis is done once, the numeric phase uses the same kernels as
+      the generated C code.
+*/
+
+/** \pluginsection{Linsol,sparsefact} */
+
+/// \cond INTERNAL
+
+namespace casadi {
+
+  /** \brief Memory for SparseFact  */
+  struct CASADI_LINSOL_SPARSEFACT_EXPORT SparseFactMemory {
+    // Numeric factors: (V, R, beta) for QR, (L, U) for LU, (L, D) for LDL^T
+    std::vector<double> f1, f2, f3;
+
+    // Work vectors
+    std::vector<double> w;
+    std::vector<int> iw;
+  };
+
+  /** \brief \pluginbrief{Linsol,sparsefact}
+
+      @copydoc Linsol_doc
+      @copydoc plugin_Linsol_sparsefact
+  */
+  class CASADI_LINSOL_SPARSEFACT_EXPORT SparseFact : public Linsol {
+  public:
+    // Constructor
+    SparseFact(const std::string& name, const Sparsity& sparsity, int nrhs);
+
+    // Destructor
+    virtual ~SparseFact();
+
+    // Get name of the plugin
+    virtual const char* plugin_name() const { return "sparsefact";}
+
+    /** \brief  Create a new Linsol */
+    static Linsol* creator(const std::string& name, const Sparsity& sp, int nrhs) {
+      return new SparseFact(name, sp, nrhs);
+    }
+
+    ///@{
+    /** \brief Options */
+    static Options options_;
+    virtual const Options& get_options() const { return options_;}
+    ///@}
+
+    // Initialize
+    virtual void init(const Dict& opts);
+
+    /** \brief Create memory block */
+    virtual void* alloc_memory() const { return new SparseFactMemory();}
+
+    /** \brief Free memory block */
+    virtual void free_memory(void *mem) const { delete static_cast<SparseFactMemory*>(mem);}
+
+    /** \brief Initalize memory block */
+    virtual void init_memory(void* mem) const;
+
+    // Factorize the linear system
+    virtual void linsol_factorize(void* mem, const double* A) const;
+
+    // Solve the linear system
+    virtual void linsol_solve(void* mem, double* x, int nrhs, bool tr) const;
+
+    /** \brief Generate code for the body of the C function */
+    virtual void generateBody(CodeGenerator& g) const;
+
+    /// Factorization method
+    enum Method {QR, LU, LDL};
+    Method method_;
+
+    /// Relative threshold for static pivoting
+    double pivot_tol_;
+
+    /// Sparsity patterns of the factors: (V, R) for QR, (L, U) for LU, (L, L') for LDL^T
+    Sparsity sp1_, sp2_;
+
+    /// Row permutation (old to new) and column permutation (new to old)
+    std::vector<int> prinv_, pc_;
+
+    /// A documentation string
+    static const std::string meta_doc;
+  };
+
+} // namespace casadi
+
+/// \endcond
+#endif // CASADI_SPARSE_FACT_HPP
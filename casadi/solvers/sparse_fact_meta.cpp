@@ -0,0 +1,64 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+
+      #include "sparse_fact.hpp"
+      #include <string>
+
+      const std::string casadi::SparseFact::meta_doc=
+      "\n"
+"Linsol based on sparse direct factorizations (QR, LU with static\n"
+"pivoting or LDL^T). The symbolic analysis is done once, the numeric\n"
+"phase uses the same kernels as the generated C code.\n"
+"\n"
+"\n"
+">List of available options\n"
+"\n"
+"+-----------------+-----------------+-----------------+-----------------+\n"
+"|       Id        |      Type       |     Default     |   Description   |\n"
+"+=================+=================+=================+=================+\n"
+"| amd             | OT_BOOL         | true            | Use an          |\n"
+"|                 |                 |                 | approximate     |\n"
+"|                 |                 |                 | minimum degree  |\n"
+"|                 |                 |                 | fill-reducing   |\n"
+"|                 |                 |                 | ordering        |\n"
+"+-----------------+-----------------+-----------------+-----------------+\n"
+"| method          | OT_STRING       | \"qr\"            | Factorization   |\n"
+"|                 |                 |                 | method: qr, lu  |\n"
+"|                 |                 |                 | or ldl          |\n"
+"|                 |                 |                 | (symmetric      |\n"
+"|                 |                 |                 | matrices)       |\n"
+"+-----------------+-----------------+-----------------+-----------------+\n"
+"| pivot_tol       | OT_DOUBLE       | 1e-12           | Static pivoting |\n"
+"|                 |                 |                 | threshold for   |\n"
+"|                 |                 |                 | lu and ldl,     |\n"
+"|                 |                 |                 | relative to the |\n"
+"|                 |                 |                 | largest entry   |\n"
+"+-----------------+-----------------+-----------------+-----------------+\n"
+"\n"
+"\n"
+"\n"
+"\n"
+;
@@ -28,6 +28,7 @@
 #include "casadi/core/std_vector_tools.hpp"
 #include "casadi/core/calculus.hpp"
 #include "casadi/core/function/qpsol.hpp"
+#include "casadi/core/casadi_trace.hpp"
 
 #include <ctime>
 #include <iomanip>
@@ -167,6 +168,7 @@ namespace casadi {
     g_fcn_ = create_function("nlp_g", {"x", "p"}, {"g"});
     grad_f_fcn_ = create_function("nlp_grad_f", {"x", "p"}, {"f", "grad_f_x"});
     jac_g_fcn_ = create_function("nlp_jac_g", {"x", "p"}, {"g", "jac_g_x"});
+    init_fg();
     if (exact_hessian_) {
       hess_l_fcn_ = create_function("nlp_jac_f", {"x", "p", "lam_f", "lam_g"},
                                     {"sym_hess_gamma_x_x"},
@@ -378,6 +380,7 @@ namespace casadi {
 
     // MAIN OPTIMIZATION LOOP
     while (true) {
+      TraceScope trace("iteration", "nlpsol");
 
       // Primal infeasability
       double pr_inf = primalInfeasibility(m->xk, m->lbx, m->ubx, m->gk, m->lbg, m->ubg);
@@ -732,7 +735,11 @@ namespace casadi {
       if (ng_==0) return;
 
       // Evaluate the function
-      calc_function(m, g_fcn_, {x, m->p}, {g});
+      if (fg_fcn_.is_null()) {
+        calc_function(m, g_fcn_, {x, m->p}, {g});
+      } else {
+        calc_fg(m, x, 0, g, 0, 0);
+      }
 
     } catch(exception& ex) {
       userOut<true, PL_WARN>() << "eval_g failed: " << ex.what() << endl;
@@ -747,7 +754,11 @@ namespace casadi {
       if (ng_==0) return;
 
       // Evaluate the function
-      calc_function(m, jac_g_fcn_, {x, m->p}, {g, J});
+      if (fg_fcn_.is_null()) {
+        calc_function(m, jac_g_fcn_, {x, m->p}, {g, J});
+      } else {
+        calc_fg(m, x, 0, g, 0, J);
+      }
 
     } catch(exception& ex) {
       userOut<true, PL_WARN>() << "eval_jac_g failed: " << ex.what() << endl;
@@ -760,7 +771,11 @@ namespace casadi {
     try {
 
       // Evaluate the function
-      calc_function(m, grad_f_fcn_, {x, m->p}, {f, grad_f});
+      if (fg_fcn_.is_null()) {
+        calc_function(m, grad_f_fcn_, {x, m->p}, {f, grad_f});
+      } else {
+        calc_fg(m, x, f, 0, grad_f, 0);
+      }
 
     } catch(exception& ex) {
       userOut<true, PL_WARN>() << "eval_grad_f failed: " << ex.what() << endl;
@@ -772,7 +787,11 @@ namespace casadi {
     try {
       // Evaluate the function
       double f;
-      calc_function(m, f_fcn_, {x, m->p}, {&f});
+      if (fg_fcn_.is_null()) {
+        calc_function(m, f_fcn_, {x, m->p}, {&f});
+      } else {
+        calc_fg(m, x, &f, 0, 0, 0);
+      }
 
       return f;
     } catch(exception& ex) {
@@ -185,6 +185,9 @@ namespace casadi {
 
     // Temporary storage
     alloc_w(neq_, true);
+
+    // Storage for the factorization in generated code
+    alloc_w(fact_fcn_.nnz_out(0) + fact_fcn_.nnz_out(1), true);
   }
 
   void SymbolicQr::init_memory(void* mem) const {
@@ -266,11 +269,41 @@ namespace casadi {
     // Generate code for the embedded functions
     fact_fcn_->addDependency(g);
     solv_fcn_N_->addDependency(g);
-    solv_fcn_T_->addDependency(g);
   }
 
   void SymbolicQr::generateBody(CodeGenerator& g) const {
-    casadi_error("Code generation for SymbolicQR still experimental");
+    // Number of nonzeros in the factors
+    int nnz_q = fact_fcn_.nnz_out(0), nnz_r = fact_fcn_.nnz_out(1);
+
+    // Work vectors
+    g.body << "  const real_t** arg1 = arg + " << LINSOL_NUM_IN << ";" << endl
+           << "  real_t** res1 = res + " << LINSOL_NUM_OUT << ";" << endl
+           << "  real_t* b = w; w += " << neq_ << ";" << endl
+           << "  real_t* q = w; w += " << nnz_q << ";" << endl
+           << "  real_t* r = w; w += " << nnz_r << ";" << endl
+           << "  int i;" << endl;
+
+    // Quick return if no solution requested
+    g.body << "  if (!res[" << LINSOL_X << "]) return 0;" << endl;
+
+    // Factorize
+    g.body << "  arg1[0] = arg[" << LINSOL_A << "];" << endl
+           << "  res1[0] = q;" << endl
+           << "  res1[1] = r;" << endl
+           << "  if (" << g(fact_fcn_, "arg1", "res1", "iw", "w") << ") return 1;" << endl;
+
+    // Solve for all right hand sides, the right hand side may alias the solution
+    g.body << "  arg1[0] = q;" << endl
+           << "  arg1[1] = r;" << endl
+           << "  arg1[2] = b;" << endl
+           << "  for (i=0; i<" << nrhs_ << "; ++i) {" << endl
+           << "    " << g.copy("arg[" + g.to_string(LINSOL_B) + "] ? arg["
+                             + g.to_string(LINSOL_B) + "]+i*" + g.to_string(neq_) + " : 0",
+                             neq_, "b") << endl
+           << "    res1[0] = res[" << LINSOL_X << "]+i*" << neq_ << ";" << endl
+           << "    if (" << g(solv_fcn_N_, "arg1", "res1", "iw", "w") << ") return 1;"
+           << endl
+           << "  }" << endl;
   }
 
 } // namespace casadi
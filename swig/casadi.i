@@ -23,7 +23,14 @@
  */
 
 
+#ifdef SWIGPYTHON
+// Thread support, so that callbacks can be called from the workers of Function::call_async
+%module(package="casadi",directors=1,threads=1) casadi
+// The GIL is only released while waiting for an asynchronous evaluation, see below
+%nothread;
+#else
 %module(package="casadi",directors=1) casadi
+#endif
 
  // Include all public CasADi C++
 %{
@@ -54,7 +61,12 @@
     }
 
     static bool pythoncheckinterrupted() {
-      return PyErr_CheckSignals();
+      // Signals are handled by the main thread, which may have released the GIL
+      if (!InterruptHandler::is_main_thread()) return false;
+      PyGILState_STATE gstate = PyGILState_Ensure();
+      bool ret = PyErr_CheckSignals()!=0;
+      PyGILState_Release(gstate);
+      return ret;
     }
 
 
@@ -88,6 +100,8 @@
     extern "C" bool utIsInterruptPending();
 
     static bool mexcheckinterrupted() {
+      // The MATLAB API may only be called from the MATLAB thread
+      if (!InterruptHandler::is_main_thread()) return false;
       return utIsInterruptPending();
     }
   }
@@ -3363,7 +3377,14 @@ def PyFunction(name, obj, inputs, outputs, opts={}):
 %}
 #endif
 
+#ifdef SWIGPYTHON
+// Workers executing Python callbacks need the GIL
+%thread casadi::AsyncCall::wait;
+%thread casadi::AsyncCall::get;
+#endif
+%include <casadi/core/function/async_call.hpp>
 %include <casadi/core/function/function.hpp>
+%include <casadi/core/function/jacobian_product.hpp>
 #ifdef SWIGPYTHON
 namespace casadi{
 %extend Function {
@@ -3560,6 +3581,7 @@ namespace casadi {
 %include <casadi/core/function/compiler.hpp>
 %include <casadi/core/function/callback.hpp>
 %include <casadi/core/global_options.hpp>
+%include <casadi/core/casadi_trace.hpp>
 %include <casadi/core/casadi_meta.hpp>
 %include <casadi/core/misc/integration_tools.hpp>
 %include <casadi/core/misc/nlp_builder.hpp>
@@ -0,0 +1,346 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            K.U. Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+/**
+ *  Microbenchmarks for tracking the performance of CasADi over time.
+ *
+ *  Each benchmark is run for a list of problem sizes. The timed body is repeated
+ *  until a minimum total time has passed and the results are written in JSON
+ *  format, one entry per benchmark and size. Benchmarks depending on plugins that
+ *  are not available are skipped.
+ *
+ *  Usage: casadi_bench [--filter <substring>] [--min_time <s>] [--max_repeat <n>]
+ *                      [--output <file.json>]
+ *  Default output file is casadi_bench.json, progress is printed to stderr
+ */
+
+#include <casadi/casadi.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+using namespace casadi;
+using namespace std;
+
+/// Body of a benchmark, set up for a given problem size
+typedef function<void()> BenchBody;
+
+/// A benchmark: returns the body to be timed for a problem size, null if unavailable
+struct Benchmark {
+  string name;
+  vector<int> sizes;
+  function<BenchBody(int)> setup;
+};
+
+/// Timing result
+struct BenchResult {
+  string name;
+  int size;
+  int repeat;
+  double t_min, t_median, t_mean;
+};
+
+/// Timer settings
+struct BenchSettings {
+  double min_time = 0.2;
+  int max_repeat = 1000;
+};
+
+double wall_time() {
+  return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+BenchResult run(const string& name, int size, const BenchBody& body, const BenchSettings& s) {
+  vector<double> t;
+  double t_total = 0;
+  while (t.empty() || (t_total<s.min_time && t.size()<s.max_repeat)) {
+    double t0 = wall_time();
+    body();
+    t.push_back(wall_time()-t0);
+    t_total += t.back();
+  }
+  vector<double> t_sorted = t;
+  sort(t_sorted.begin(), t_sorted.end());
+  BenchResult r;
+  r.name = name;
+  r.size = size;
+  r.repeat = t.size();
+  r.t_min = t_sorted.front();
+  r.t_median = t_sorted[t.size()/2];
+  r.t_mean = t_total/t.size();
+  return r;
+}
+
+/// Chain of nonlinear operations on x, with a banded Jacobian
+template<typename M>
+M chain(const M& x) {
+  int n = x.nnz();
+  M y = sin(x(Slice(1, n))) * x(Slice(0, n-1)) + x(Slice(1, n))*x(Slice(1, n));
+  return vertcat(y, dot(x, x));
+}
+
+/// Evaluate a Function numerically, work vectors allocated once
+BenchBody eval_body(const Function& f) {
+  auto x = make_shared<vector<double> >(f.nnz_in(0), 0.5);
+  auto y = make_shared<vector<double> >(f.nnz_out(0));
+  auto arg = make_shared<vector<const double*> >(f.sz_arg());
+  auto res = make_shared<vector<double*> >(f.sz_res());
+  auto iw = make_shared<vector<int> >(f.sz_iw());
+  auto w = make_shared<vector<double> >(f.sz_w());
+  (*arg)[0] = get_ptr(*x);
+  (*res)[0] = get_ptr(*y);
+  // Input and output buffers are captured explicitly, only referenced by pointer in the call
+  return [f, x, y, arg, res, iw, w]() {
+    f(get_ptr(*arg), get_ptr(*res), get_ptr(*iw), get_ptr(*w), 0);
+  };
+}
+
+/// Chain of N masses and springs, second order written as first order
+SXDict oscillator_chain(int n) {
+  SX x = SX::sym("x", n), v = SX::sym("v", n), p = SX::sym("p");
+  SX xl = vertcat(SX(0), x(Slice(0, n-1))), xr = vertcat(x(Slice(1, n)), SX(0));
+  SX a = p*(xl - 2*x + xr) - 0.1*v - 0.01*x*x*x;
+  return {{"x", vertcat(x, v)}, {"p", p}, {"ode", vertcat(v, a)}};
+}
+
+/// Chained Rosenbrock function, with a constraint per pair of variables
+SXDict rosenbrock(int n) {
+  SX x = SX::sym("x", n);
+  SX f = 0;
+  for (int i=0; i<n-1; ++i) f += 100*pow(x(i+1)-x(i)*x(i), 2) + pow(1-x(i), 2);
+  SX g = x(Slice(0, n-1)) + x(Slice(1, n));
+  return {{"x", x}, {"f", f}, {"g", g}};
+}
+
+vector<Benchmark> benchmarks() {
+  vector<Benchmark> b;
+
+  // Expression graph construction
+  b.push_back({"sx_construct", {1000, 10000, 100000}, [](int n) -> BenchBody {
+        return [n]() { SX x = SX::sym("x", n); chain(x);};
+      }});
+  b.push_back({"mx_construct", {100, 1000, 10000}, [](int n) -> BenchBody {
+        return [n]() {
+          MX y = MX::sym("y", 2);
+          MX z = y;
+          for (int i=0; i<n; ++i) z = sin(z)*y + z;
+        };
+      }});
+
+  // Numerical evaluation
+  b.push_back({"sxfunction_eval", {1000, 10000, 100000}, [](int n) -> BenchBody {
+        SX x = SX::sym("x", n);
+        return eval_body(Function("f", {x}, {chain(x)}));
+      }});
+  b.push_back({"mxfunction_eval", {1000, 10000, 100000}, [](int n) -> BenchBody {
+        MX x = MX::sym("x", n);
+        return eval_body(Function("f", {x}, {chain(x)}));
+      }});
+
+  // Jacobian sparsity and graph coloring
+  b.push_back({"jac_sparsity", {1000, 10000, 100000}, [](int n) -> BenchBody {
+        SX x = SX::sym("x", n);
+        SX y = chain(x);
+        return [=]() { Function("f", {x}, {y}).sparsity_jac(0, 0);};
+      }});
+  b.push_back({"coloring", {1000, 10000}, [](int n) -> BenchBody {
+        SX x = SX::sym("x", n);
+        Sparsity sp = Function("f", {x}, {chain(x)}).sparsity_jac(0, 0);
+        Sparsity spT = sp.T();
+        return [=]() { sp.uni_coloring(spT);};
+      }});
+
+  // Derivative generation, including the construction of the nondifferentiated function
+  for (string mode : {"forward", "reverse", "jacobian"}) {
+    for (string type : {"sx", "mx"}) {
+      b.push_back({type + "_" + mode, {100, 1000, 10000}, [=](int n) -> BenchBody {
+            return [=]() {
+              Function f;
+              if (type=="sx") {
+                SX x = SX::sym("x", n);
+                f = Function("f", {x}, {chain(x)});
+              } else {
+                MX x = MX::sym("x", n);
+                f = Function("f", {x}, {chain(x)});
+              }
+              if (mode=="forward") {
+                f.forward(1);
+              } else if (mode=="reverse") {
+                f.reverse(1);
+              } else {
+                f.jacobian(0, 0);
+              }
+            };
+          }});
+    }
+  }
+
+  // Code generation and compilation
+  b.push_back({"codegen", {1000, 10000}, [](int n) -> BenchBody {
+        SX x = SX::sym("x", n);
+        Function f("f", {x}, {chain(x)});
+        return [=]() {
+          CodeGenerator g;
+          g.add(f);
+          g.generate();
+        };
+      }});
+  b.push_back({"codegen_compile", {100, 1000}, [](int n) -> BenchBody {
+        if (!Compiler::hasPlugin("shell")) return BenchBody();
+        SX x = SX::sym("x", n);
+        Function f("f", {x}, {chain(x)});
+        return [=]() {
+          CodeGenerator g;
+          g.add(f);
+          g.generate("casadi_bench_codegen.c");
+          Compiler("casadi_bench_codegen.c", "shell");
+        };
+      }});
+
+  // Integrators
+  for (string plugin : {"rk", "collocation", "cvodes"}) {
+    b.push_back({"integrator_" + plugin, {10, 30}, [=](int n) -> BenchBody {
+          if (!has_integrator(plugin)) return BenchBody();
+          vector<double> grid;
+          for (int k=0; k<=20; ++k) grid.push_back(0.1*k);
+          Function F = integrator("F", plugin, oscillator_chain(n), {{"grid", grid}});
+          DM x0 = DM::zeros(2*n);
+          x0(0) = 1;
+          return [=]() mutable { F(DMDict{{"x0", x0}, {"p", 4}});};
+        }});
+  }
+
+  // Rootfinders, a diagonally dominant nonlinear system
+  for (string plugin : {"newton", "kinsol"}) {
+    b.push_back({"rootfinder_" + plugin, {100, 1000}, [=](int n) -> BenchBody {
+          if (!has_rootfinder(plugin)) return BenchBody();
+          SX x = SX::sym("x", n), p = SX::sym("p", n);
+          SX xs = vertcat(x(Slice(1, n)), SX(0));
+          SX r = 4*x + x*x*x + sin(xs) - p;
+          Function g("g", {x, p}, {r});
+          Function G = rootfinder("G", plugin, g);
+          DM x0 = 0.2*DM::ones(n), p0 = DM::ones(n);
+          return [=]() mutable { G(vector<DM>{x0, p0});};
+        }});
+  }
+
+  // NLP solvers
+  for (string plugin : {"sqpmethod", "ipopt"}) {
+    b.push_back({"nlpsol_" + plugin, {10, 100}, [=](int n) -> BenchBody {
+          if (!has_nlpsol(plugin)) return BenchBody();
+          Dict opts;
+          if (plugin=="ipopt") {
+            opts = {{"ipopt.print_level", 0}, {"print_time", false}};
+          } else {
+            if (!has_qpsol("qpoases")) return BenchBody();
+            opts = {{"qpsol", "qpoases"}, {"print_header", false}, {"print_time", false},
+                    {"qpsol_options", Dict{{"printLevel", "none"}}}};
+          }
+          Function solver = nlpsol("solver", plugin, rosenbrock(n), opts);
+          return [=]() mutable {
+            // Suppress the iteration log
+            stringstream ss;
+            streambuf* cout_buf = cout.rdbuf(ss.rdbuf());
+            solver(DMDict{{"x0", DM::zeros(n)}, {"lbg", -1}, {"ubg", 1}});
+            cout.rdbuf(cout_buf);
+          };
+        }});
+  }
+
+  return b;
+}
+
+/// Write the results in JSON format
+void write_json(ostream& s, const vector<BenchResult>& res) {
+  s << "{" << endl;
+  s << "  \"version\": \"" << CasadiMeta::getVersion() << "\"," << endl;
+  s << "  \"git_revision\": \"" << CasadiMeta::getGitRevision() << "\"," << endl;
+  s << "  \"build_type\": \"" << CasadiMeta::getBuildType() << "\"," << endl;
+  s << "  \"timestamp\": " << chrono::duration_cast<chrono::seconds>(
+    chrono::system_clock::now().time_since_epoch()).count() << "," << endl;
+  s << "  \"benchmarks\": [";
+  for (int i=0; i<res.size(); ++i) {
+    const BenchResult& r = res[i];
+    s << (i==0 ? "" : ",") << endl;
+    s << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size
+      << ", \"repeat\": " << r.repeat << ", \"t_min\": " << r.t_min
+      << ", \"t_median\": " << r.t_median << ", \"t_mean\": " << r.t_mean << "}";
+  }
+  s << endl << "  ]" << endl << "}" << endl;
+}
+
+int main(int argc, char* argv[]) {
+  // Parse command line
+  BenchSettings settings;
+  string filter, output = "casadi_bench.json";
+  for (int i=1; i<argc; ++i) {
+    string a = argv[i];
+    if (i+1<argc && a=="--filter") {
+      filter = argv[++i];
+    } else if (i+1<argc && a=="--min_time") {
+      settings.min_time = atof(argv[++i]);
+    } else if (i+1<argc && a=="--max_repeat") {
+      settings.max_repeat = atoi(argv[++i]);
+    } else if (i+1<argc && a=="--output") {
+      output = argv[++i];
+    } else {
+      cerr << "Usage: " << argv[0] << " [--filter <substring>] [--min_time <s>] "
+           << "[--max_repeat <n>] [--output <file.json>]" << endl;
+      return 1;
+    }
+  }
+
+  // Run the benchmarks, progress to stderr
+  vector<BenchResult> res;
+  for (auto&& b : benchmarks()) {
+    if (b.name.find(filter)==string::npos) continue;
+    for (int n : b.sizes) {
+      BenchBody body;
+      try {
+        body = b.setup(n);
+        if (!body) {
+          cerr << b.name << ": skipped, plugin not available" << endl;
+          break;
+        }
+        res.push_back(run(b.name, n, body, settings));
+      } catch (exception& e) {
+        cerr << b.name << " (" << n << "): failed: " << e.what() << endl;
+        continue;
+      }
+      cerr << b.name << " (" << n << "): " << res.back().t_median << " s" << endl;
+    }
+  }
+
+  // Write results, not to stdout since solvers may print there
+  ofstream f(output);
+  casadi_assert_message(f.good(), "Cannot open " << output);
+  write_json(f, res);
+  cerr << "Results written to " << output << endl;
+  return 0;
+}
@@ -420,6 +420,216 @@ class Functiontests(casadiTestCase):
     
     self.checkarray(out,25)
 
+  def test_callback_fd(self):
+    N = 10
+    class mycallback(Callback):
+      def __init__(self, name, opts={}):
+        Callback.__init__(self)
+        self.ncalls = 0
+        self.construct(name, opts)
+      def get_sparsity_in(self,i):
+        return Sparsity.dense(N,1)
+      def get_sparsity_out(self,i):
+        return Sparsity.dense(N,1)
+      def eval(self,argin):
+        self.ncalls+= 1
+        x = argin[0]
+        return [sin(x)*vertcat(1,x[:-1])]
+
+    x = SX.sym("x",N)
+    ref = Function("ref",[x],[sin(x)*vertcat(1,x[:-1])])
+    x0 = DM(range(N))*0.3
+
+    for method in ["central","forward"]:
+      foo = mycallback("my_f",{"fd_options":{"fd_method":method}})
+      foo.set_jac_sparsity(ref.sparsity_jac(0,0),0,0)
+      J = foo.jacobian(0,0)
+      self.assertTrue(J.sparsity_out(0)==ref.sparsity_jac(0,0))
+
+      # Number of calls proportional to the number of colors
+      ncalls = foo.ncalls
+      J(x0)
+      self.assertEqual(foo.ncalls-ncalls,5 if method=="central" else 3)
+      self.checkarray(J(x0)[0],ref.jacobian(0,0)(x0)[0],digits=5)
+
+      # Derivatives of MX expressions embedding the callback
+      xm = MX.sym("x",N)
+      f = Function("f",[xm],[dot(foo(xm),foo(xm))])
+      fref = Function("fref",[x],[dot(ref(x),ref(x))])
+      self.checkarray(f.gradient()(x0),fref.gradient()(x0),digits=5)
+
+    # Finite differences are opt-in
+    foo = mycallback("my_f")
+    with self.assertRaises(Exception):
+      foo.jacobian(0,0)
+    foo = mycallback("my_f",{"enable_fd":True})
+    self.checkarray(foo.jacobian(0,0)(x0)[0],ref.jacobian(0,0)(x0)[0],digits=5)
+
+    # Callbacks cannot be evaluated concurrently
+    foo = mycallback("my_f",{"fd_options":{"n_threads":2}})
+    with self.assertRaises(Exception):
+      foo.jacobian(0,0)
+
+  def test_mem_pool(self):
+    x = SX.sym("x",2)
+    f = Function("f",[x],[sin(x)],{"mem_pool":3})
+
+    # The three preallocated memory objects are handed out first, then the pool grows
+    mem = [f.checkout() for i in range(4)]
+    self.assertEqual(mem,[1,2,3,4])
+
+    # Released memory objects are reused
+    for m in mem: f.release(m)
+    self.assertEqual(sorted([f.checkout() for i in range(4)]),[1,2,3,4])
+    self.checkarray(f(DM([1,2])),sin(DM([1,2])))
+
+  def test_call_batch(self):
+    x = SX.sym("x",2)
+    p = SX.sym("p")
+    f = Function("f",[x,p],[sin(x)*p,SX.ones(Sparsity.lower(2))*p])
+    args = [[DM([k,2*k]),DM(k)] for k in range(10)]
+    res = f.call_batch(args)
+    self.assertEqual(len(res),10)
+    for a,r in zip(args,res):
+      for r1,r2 in zip(r,f(*a)):
+        self.checkarray(r1,r2)
+        self.assertTrue(r1.sparsity()==r2.sparsity())
+
+  def test_profile(self):
+    import json
+    x = SX.sym("x",3)
+    f = Function("f",[x],[sin(x)*x],{"profile":True})
+    X = MX.sym("X",3)
+    g = Function("g",[X],[f(X)+f(2*X)],{"profile":True})
+    for i in range(3): g([1,2,3])
+
+    p = json.loads(g.profile_json())
+    self.assertEqual(p["n_call"],3)
+    calls = [e for e in p["ops"] if e["op"]=="call"]
+    self.assertEqual(len(calls),2)
+    for e in calls:
+      self.assertEqual(e["callee"],"f")
+      self.assertEqual(e["profile"]["n_call"],6)
+    # SX operations aggregated by operation code
+    ops = dict((e["op"],e["n_call"]) for e in p["ops"][1]["profile"]["ops"])
+    self.assertEqual(ops["sin"],18)
+    self.assertEqual(ops["mul"],18)
+
+    for l in g.profile_folded().splitlines():
+      stack, t = l.split(" ")
+      self.assertTrue(stack.startswith("g"))
+      self.assertTrue(int(t)>0)
+
+    g.profile_reset()
+    self.assertEqual(json.loads(g.profile_json())["n_call"],0)
+
+    # Not recorded by default
+    self.assertEqual(json.loads(Function("h",[x],[x]).profile_json())["ops"],[])
+
+  def test_trace(self):
+    import json, tempfile, os
+    x = SX.sym("x",2)
+    f = Function("f",[x],[sin(x)])
+    Trace.start()
+    f([1,2])
+    J = f.jacobian(0,0)
+    Trace.stop()
+    f([1,2])
+    fname = os.path.join(tempfile.mkdtemp(),"trace.json")
+    Trace.write(fname)
+    events = json.load(open(fname))["traceEvents"]
+    self.assertEqual([(e["ph"],e.get("name"),e.get("cat")) for e in events],
+      [("B","f","function"),("E",None,None),("B","jacobian_f_0_0","derivative"),("E",None,None)])
+    self.assertTrue(all(e["ts"]>=0 for e in events))
+
+  def test_memory_usage(self):
+    x = SX.sym("x",10)
+    f = Function("f",[x],[sin(x)*dot(x,x)])
+    m = f.memory_usage()
+    for k in ["graph","algorithm","work","sparsity","jac_sparsity","derivatives"]:
+      self.assertTrue(m[k]>=0)
+    self.assertTrue(m["graph"]>0)
+    self.assertEqual(m["n_derivatives"],0)
+    self.assertAlmostEqual(m["total"],sum(m[k] for k in ["graph","algorithm","work","sparsity","jac_sparsity","derivatives"]))
+
+    # Cached derivatives are accounted for as long as they are alive
+    J = f.jacobian(0,0)
+    F = f.forward(1)
+    m2 = f.memory_usage()
+    self.assertEqual(m2["n_derivatives"],2)
+    self.assertTrue(m2["derivatives"]>0)
+    self.assertTrue(m2["jac_sparsity"]>0)
+
+    # Released caches
+    f.release_derivatives()
+    m3 = f.memory_usage()
+    self.assertEqual(m3["n_derivatives"],0)
+    self.assertEqual(m3["jac_sparsity"],0)
+    self.checkarray(J([1]*10)[0],f.jacobian(0,0)([1]*10)[0])
+
+    g = Function.memory_usage_global()
+    self.assertTrue(g["n_sparsity_cache"]>0)
+    self.assertTrue(g["sparsity_cache"]>0)
+    self.assertTrue(g["sx_constant_cache"]>=0)
+
+  def test_release_derivatives_user_sparsity(self):
+    x = SX.sym("x",3)
+    f = Function("f",[x],[sin(x)])
+    sp = Sparsity.dense(3,3)
+    f.set_jac_sparsity(sp,0,0)
+    f.jacobian(0,0)
+    f.release_derivatives()
+    # Only computed patterns are dropped
+    self.assertTrue(f.sparsity_jac(0,0)==sp)
+    self.assertTrue(f.sparsity_jac(0,0,True)==sp)
+
+  def test_derivative_cache(self):
+    x = SX.sym("x",10)
+    f = Function("f",[x],[sin(x)*dot(x,x)])
+    f.forward(1)
+    self.assertEqual(f.memory_usage()["n_derivatives"],0)
+
+    # Global budget, least recently used first out
+    GlobalOptions.setDerivativeCacheEntries(2)
+    try:
+      f.forward(1)
+      f.reverse(1)
+      self.assertEqual(f.memory_usage()["n_derivatives"],2)
+      self.assertEqual(Function.memory_usage_global()["n_derivative_cache"],2)
+      f.reverse(1)
+      f.jacobian(0,0)
+      self.assertEqual(f.memory_usage()["n_derivatives"],2)
+      f.release_derivatives()
+      self.assertEqual(f.memory_usage()["n_derivatives"],0)
+      self.assertEqual(Function.memory_usage_global()["n_derivative_cache"],0)
+    finally:
+      GlobalOptions.setDerivativeCacheEntries(0)
+
+    # Budget per function
+    g = Function("g",[x],[sin(x)],{"derivative_cache":1})
+    g.forward(1)
+    g.reverse(1)
+    self.assertEqual(g.memory_usage()["n_derivatives"],1)
+    Function.clear_derivative_cache()
+    self.assertEqual(g.memory_usage()["n_derivatives"],0)
+
+    # Cached derivatives do not keep the original function alive
+    h = Function("h",[x],[sin(x)],{"derivative_cache":2})
+    h.forward(1)
+    h.jacobian(0,0)
+    self.assertEqual(Function.memory_usage_global()["n_derivative_cache"],2)
+    del h
+    self.assertEqual(Function.memory_usage_global()["n_derivative_cache"],0)
+
+    # A memory budget alone enables the cache
+    GlobalOptions.setDerivativeCacheMemory(10**9)
+    try:
+      f.forward(2)
+      self.assertEqual(Function.memory_usage_global()["n_derivative_cache"],1)
+    finally:
+      GlobalOptions.setDerivativeCacheMemory(0)
+      Function.clear_derivative_cache()
+
   @known_bug()
   def test_callback_errors(self):
     class mycallback(Callback):
@@ -494,7 +704,7 @@ class Functiontests(casadiTestCase):
         ]:
       print "args", Z_alt
 
-      for parallelization in ["serial","openmp","unroll"] if args.run_slow else ["serial"]:
+      for parallelization in ["serial","openmp","thread","unroll"] if args.run_slow else ["serial"]:
         print parallelization
         res = fun.map(map(lambda x: horzcat(*x),[X,Y,Z_alt,V]),parallelization)
 
@@ -613,6 +823,165 @@ class Functiontests(casadiTestCase):
             for f in [F,toSX_fun(F)]:
               self.checkfunction(f,Fref,inputs=inputs,sparsity_mod=args.run_slow)
 
+  def test_map_jacobian(self):
+    x = SX.sym("x",3)
+    p = SX.sym("p",2)
+    v = SX.sym("v",Sparsity.upper(2))
+
+    fun = Function("f",[x,p,v],[vertcat(sin(x[0])*x[1],x[2]*p[0],x[0]*x[1]*p[1]),v*x[0],dot(x,x)])
+
+    n = 4
+    np.random.seed(0)
+    inputs = [DM(repmat(fun.sparsity_in(i),1,n),np.random.random(n*fun.nnz_in(i))) for i in range(fun.n_in())]
+
+    Fref = fun.map("map","unroll",n)
+    for parallelization in ["serial","openmp","thread"]:
+      F = fun.map("map",parallelization,n)
+      for i in range(fun.n_in()):
+        for j in range(fun.n_out()):
+          # Block diagonal pattern, assembled from the pattern of fun
+          self.assertTrue(F.sparsity_jac(i,j)==Fref.sparsity_jac(i,j))
+          self.assertTrue(F.sparsity_jac(i,j,True)==kron(Sparsity.diag(n),fun.sparsity_jac(i,j,True)))
+          for compact in [False,True]:
+            J = F.jacobian(i,j,compact)
+            Jref = Fref.jacobian(i,j,compact)
+            self.assertTrue(J.sparsity_out(0)==Jref.sparsity_out(0))
+            for k in range(J.n_out()):
+              self.checkarray(J(*inputs)[k],Jref(*inputs)[k],"jacobian %d %d" % (i,j))
+
+  def test_jacobian_product(self):
+    x = SX.sym("x",3)
+    p = SX.sym("p",2)
+    f = Function("f",[x,p],[sin(x)*p[0],dot(x,x)*p[1]])
+    x0 = DM([0.1,0.2,0.3])
+    p0 = DM([2,3])
+    # J[j][i]: Jacobian of output j with respect to input i
+    J = [[f.jacobian(i,j)(x0,p0)[0] for i in range(2)] for j in range(2)]
+
+    # J*v, several directions
+    v = [DM([1,0,2]),DM([0.5,1]),DM([0,1,0]),DM([1,1])]
+    jvp = f.jvp(2)
+    self.assertEqual(jvp.n_dir(),2)
+    r = jvp.call([x0,p0],v)
+    self.assertEqual(len(r),4)
+    for d in range(2):
+      for j in range(2):
+        self.checkarray(r[2*d+j],mtimes(J[j][0],v[2*d])+mtimes(J[j][1],v[2*d+1]))
+
+    # v^T*J, several directions
+    w = [DM([1,0,2]),DM(0.5),DM([0,1,0]),DM(1)]
+    s = f.vjp(2).call([x0,p0],w)
+    self.assertEqual(len(s),4)
+    for d in range(2):
+      for i in range(2):
+        self.checkarray(s[2*d+i],mtimes(J[0][i].T,w[2*d])+mtimes(J[1][i].T,w[2*d+1]))
+
+    # Derivative function with seeds that do not have the sparsity of the input
+    z = SX.sym("z",Sparsity.diag(3))
+    g = Function("g",[z],[sin(z[0,0])*DM.ones(3)+vertcat(z[0,0],z[1,1],z[2,2])])
+    class mycallback(Callback):
+      def __init__(self, name, opts={}):
+        Callback.__init__(self)
+        self.construct(name, opts)
+      def get_sparsity_in(self,i):
+        return Sparsity.diag(3)
+      def get_sparsity_out(self,i):
+        return Sparsity.dense(3,1)
+      def eval(self,argin):
+        return [g(argin[0])]
+      def get_n_forward(self):
+        return 1
+      def get_forward(self,name,nfwd,opts):
+        X = MX.sym("x",Sparsity.diag(3))
+        Y = MX.sym("y",3,1)
+        V = [MX.sym("v",3,3) for d in range(nfwd)]
+        JX = jacobian(g(X),X)
+        return Function(name,[X,Y]+V,[mtimes(JX,vec(project(v,Sparsity.diag(3)))) for v in V])
+
+    cb = mycallback("cb")
+    jvp = cb.jvp(1)
+    self.assertTrue(jvp.derivative().name().startswith("proj_"))
+    z0 = DM(Sparsity.diag(3),[0.1,0.2,0.3])
+    vz = DM(Sparsity.diag(3),[1,2,3])
+    self.checkarray(jvp.call([z0],[vz])[0],mtimes(g.jacobian()(z0)[0],vec(densify(vz))))
+
+  def test_call_async(self):
+    x = SX.sym("x",20)
+    g = Function("g",[x],[sin(mtimes(DM.ones(20,20)*0.01,x))])
+    xm = MX.sym("x",20)
+    y = xm
+    for i in range(500):
+      y = g(y)
+    f = Function("f",[xm],[y])
+    x0 = DM.ones(20,1)
+    ref = f(x0)
+
+    h = f.call_async([x0])
+    self.assertTrue(h.valid())
+    self.checkarray(h.get()[0],ref)
+    self.assertTrue(h.ready())
+
+    # Cancellation, checked before the evaluation starts and before each call node.
+    # The callback blocks until cancel() has been issued
+    import threading
+    class Blocker(Callback):
+      def __init__(self, name, opts={}):
+        Callback.__init__(self)
+        self.issued = threading.Event()
+        self.construct(name, opts)
+      def eval(self,argin):
+        self.issued.wait()
+        return [argin[0]]
+    b = Blocker("b")
+    fb = Function("fb",[xm],[g(xm*b(xm[0]))])
+    h = fb.call_async([x0])
+    h.cancel()
+    b.issued.set()
+    with self.assertRaises(Exception):
+      h.get()
+
+    # The workers of a thread map check the cancellation of the enclosing evaluation
+    b.issued.clear()
+    F = fb.map("F","thread",8)
+    h = F.call_async([repmat(x0,1,8)])
+    h.cancel()
+    b.issued.set()
+    with self.assertRaises(Exception):
+      h.get()
+
+    # Nested asynchronous calls, more than there are workers
+    h = [F.call_async([repmat(x0*(i+1),1,8)]) for i in range(10)]
+    for i in range(10):
+      self.checkarray(h[i].get()[0],repmat(f(x0*(i+1)),1,8))
+
+  def test_compressed_jacobian(self):
+    x = SX.sym("x",5)
+    p = SX.sym("p",Sparsity.upper(2))
+    y = vertcat(sin(x[0])*x[1],x[2]*p[0,1],x[3]*x[4]*p[1,1],sum1(x**2))
+    g = gradient(dot(y,y),x)
+
+    for ad_weight in [0,1]:
+      f = Function("f",[x,p],[y,g])
+      fc = Function("f",[x,p],[y,g],{"compressed_jacobian":True,"ad_weight":ad_weight,"ad_weight_sp":ad_weight})
+
+      inputs = [DM(range(5))*0.3,DM(Sparsity.upper(2),[1,2,3])]
+      for i in range(f.n_in()):
+        for j in range(f.n_out()):
+          for compact in [False,True]:
+            J = f.jacobian(i,j,compact)
+            Jc = fc.jacobian(i,j,compact)
+            self.assertTrue(J.sparsity_out(0)==Jc.sparsity_out(0))
+            for k in range(J.n_out()):
+              self.checkarray(J(*inputs)[k],Jc(*inputs)[k],"jacobian %d %d" % (i,j))
+
+      # Symmetric, star coloring
+      H = f.jacobian(0,1,False,True)
+      Hc = fc.jacobian(0,1,False,True)
+      self.checkarray(H(*inputs)[0],Hc(*inputs)[0],"hessian")
+
+      # Higher order derivatives fall back on the symbolic Jacobian
+      self.checkfunction(fc.jacobian(0,0),f.jacobian(0,0),inputs=inputs,jacobian=False,gradient=False,hessian=False,evals=False)
+
   def test_issue1522(self):
     V = MX.sym("X",2)
     P = MX.sym("X",0)
@@ -857,6 +1226,118 @@ class Functiontests(casadiTestCase):
   #   [v] = f([])
   #   self.checkarray(2.37683, v, digits=4)
     
+  @requiresPlugin(Compiler,"shell")
+  def test_shell_cache(self):
+    import tempfile
+    import shutil
+    import os
+    d = tempfile.mkdtemp()
+    libs = lambda: [f for f in os.listdir(d) if f.endswith(".so")]
+    size = GlobalOptions.getJitCacheSize()
+    try:
+      x = SX.sym("x")
+      Function("f",[x],[sin(x)]).generate("cache_f")
+
+      # Second compilation of the same source is a cache hit: the library is marked
+      # as used, a compilation would replace the file
+      for k in range(2):
+        compiler = Compiler("cache_f.c","shell",{"cache_dir":d})
+        self.checkarray(external("f",compiler)(1),sin(1))
+        self.assertEqual(len(libs()),1)
+        lib = os.path.join(d,libs()[0])
+        if k==0:
+          ino = os.stat(lib).st_ino
+          os.utime(lib,(1,1))
+      self.assertEqual(os.stat(lib).st_ino,ino)
+      self.assertTrue(os.stat(lib).st_mtime>1)
+
+      # Changed flags or source miss
+      compiler = Compiler("cache_f.c","shell",{"cache_dir":d,"flags":["-O1"]})
+      self.checkarray(external("f",compiler)(1),sin(1))
+      self.assertEqual(len(libs()),2)
+      Function("f",[x],[cos(x)]).generate("cache_f")
+      compiler = Compiler("cache_f.c","shell",{"cache_dir":d})
+      self.checkarray(external("f",compiler)(1),cos(1))
+      self.assertEqual(len(libs()),3)
+
+      # Eviction keeps the directory within its limit, apart from the newest library,
+      # and removes stale leftovers of interrupted compilations
+      for f in ["jit_stale.so.tmp1","jit_fresh.so.tmp2"]:
+        open(os.path.join(d,f),"w").close()
+      os.utime(os.path.join(d,"jit_stale.so.tmp1"),(1,1))
+      GlobalOptions.setJitCacheSize(1)
+      Function("f",[x],[tan(x)]).generate("cache_f")
+      compiler = Compiler("cache_f.c","shell",{"cache_dir":d})
+      self.checkarray(external("f",compiler)(1),tan(1))
+      self.assertEqual(len(libs()),1)
+      self.assertFalse(os.path.exists(os.path.join(d,"jit_stale.so.tmp1")))
+      self.assertTrue(os.path.exists(os.path.join(d,"jit_fresh.so.tmp2")))
+    finally:
+      GlobalOptions.setJitCacheSize(size)
+      shutil.rmtree(d)
+      os.remove("cache_f.c")
+
+  @requiresPlugin(Compiler,"shell")
+  def test_shell_cache_include(self):
+    import tempfile
+    import shutil
+    import os
+    d = tempfile.mkdtemp()
+    libs = lambda: [f for f in os.listdir(d) if f.endswith(".so")]
+    try:
+      with open(os.path.join(d,"inc_f.c"),"w") as f:
+        f.write('#include "inc_f.h"\nint g(void) { return K; }\n')
+
+      # A change to a local header misses, restoring it hits
+      for k in [1, 2, 1]:
+        with open(os.path.join(d,"inc_f.h"),"w") as f:
+          f.write("#define K %d\n" % k)
+        Compiler(os.path.join(d,"inc_f.c"),"shell",{"cache_dir":d})
+      self.assertEqual(len(libs()),2)
+    finally:
+      shutil.rmtree(d)
+
+  @requiresPlugin(Compiler,"shell")
+  def test_jit_async_threshold(self):
+    import time
+    x = SX.sym("x")
+    ref = lambda x: sin(x)*x
+
+    # The compiled code is told apart from the interpreter by compiling sin as cos
+    for background in [True, False]:
+      F = Function("f",[x],[ref(x)],{"jit":True,"compiler":"shell","jit_async":background,
+                                     "jit_threshold":3,"jit_options":{"flags":["-Dsin=cos"]}})
+      for k in range(2):
+        self.checkarray(F(0.3),ref(0.3))
+      swapped = False
+      for k in range(200):
+        r = F(0.3)
+        if abs(float(r)-cos(0.3)*0.3)<1e-12:
+          swapped = True
+          break
+        self.checkarray(r,ref(0.3))
+        time.sleep(0.05)
+      self.assertTrue(swapped)
+
+      # Results agree before and after the hot-swap
+      F = Function("f",[x],[ref(x)],{"jit":True,"compiler":"shell","jit_async":background,
+                                     "jit_threshold":3})
+      for k in range(20):
+        self.checkarray(F(0.1*k),ref(0.1*k))
+        time.sleep(0.05)
+
+  @requiresPlugin(Compiler,"shell")
+  def test_jit_async_fallback(self):
+    import time
+    x = SX.sym("x")
+    for background in [True, False]:
+      F = Function("f",[x],[sin(x)*x],{"jit":True,"compiler":"shell","jit_async":background,
+                                       "jit_threshold":2,
+                                       "jit_options":{"flags":["-no-such-flag"]}})
+      for k in range(20):
+        self.checkarray(F(0.1*k),sin(0.1*k)*0.1*k)
+        time.sleep(0.05)
+
   @memory_heavy()
   def test_kernel_sum(self):
     n = 20
@@ -894,6 +1375,174 @@ class Functiontests(casadiTestCase):
     self.checkfunction(F,Fref,inputs=[z,x0],digits=5,allow_nondiff=True,evals=False)
     self.check_codegen(F,inputs=[z,x0])
 
+  def test_codegen_split(self):
+    x = SX.sym("x",5)
+    y = SX.sym("y",2)
+    e = x
+    for i in range(20):
+      e = sin(e*x[i%5]) + cos(e) + y[i%2]*e
+    f = Function("f",[x,y],[sum1(e),e*2])
+    X = MX.sym("X",5)
+    Y = MX.sym("Y",2)
+    g = Function("g",[X,Y],[f(X,Y)[0]*3+X])
+    inputs = [DM([0.1,0.2,0.3,0.4,0.5]),DM([1.5,-0.5])]
+
+    for size in [7, 100000]:
+      cg = CodeGenerator({"split": True, "split_size": size})
+      cg.add(f)
+      cg.add(g)
+      name = "codegen_split_%d" % size
+      lib = cg.compile(name)
+      if size==7:
+        self.assertTrue(len(cg.split_sources(name))>10)
+      else:
+        self.assertEqual(len(cg.split_sources(name)),3)
+      for F in [f, g]:
+        F2 = external(F.name(), lib)
+        Fout = F.call(inputs)
+        Fout2 = F2.call(inputs)
+        for i in range(F.n_out()):
+          self.checkarray(Fout[i],Fout2[i])
+
+  def test_codegen_modes(self):
+    x = SX.sym("x",5)
+    y = SX.sym("y",2)
+    e = x
+    for i in range(10):
+      e = sin(e*x[i%5]) + e*e*y[i%2] + x
+    f = Function("f",[x,y],[e,sum1(e)])
+    inputs = [DM([0.1,0.2,0.3,0.4,0.5]),DM([0.3,-0.5])]
+    for k, opts in enumerate([{"single_assignment": True},
+                              {"with_restrict": True},
+                              {"single_assignment": True, "with_restrict": True},
+                              {"batch": True}]):
+      cg = CodeGenerator(opts)
+      cg.add(f)
+      if "batch" in opts:
+        self.assertTrue("int f_batch(" in cg.generate())
+        self.assertTrue("int f_batch_work(" in cg.generate())
+      F2 = external("f", cg.compile("codegen_modes_%d" % k))
+      Fout = f.call(inputs)
+      Fout2 = F2.call(inputs)
+      for i in range(f.n_out()):
+        self.checkarray(Fout[i],Fout2[i])
+
+  def test_codegen_batch(self):
+    import ctypes
+    import subprocess
+    x = SX.sym("x",5)
+    y = SX.sym("y",2)
+    e = x
+    for i in range(10):
+      e = sin(e*x[i%5]) + e*e*y[i%2] + x
+    f = Function("f",[x,y],[e,sum1(e)])
+    cg = CodeGenerator({"batch": True})
+    cg.add(f)
+    cg.generate("codegen_batch")
+    subprocess.Popen("gcc -fPIC -shared -O3 codegen_batch.c -o codegen_batch.so",
+                     shell=True).wait()
+    lib = ctypes.CDLL("./codegen_batch.so")
+    sz = [ctypes.c_int() for i in range(4)]
+    lib.f_batch_work(*[ctypes.byref(i) for i in sz])
+    sz_arg, sz_res, sz_iw, sz_w = [i.value for i in sz]
+
+    # Nonzero j of point p at j*stride+p, the padding is neither read nor written
+    N = 7
+    stride = 9
+    X = numpy.random.random((5,stride))
+    Y = numpy.random.random((2,stride))
+    dp = ctypes.POINTER(ctypes.c_double)
+    ptr = lambda A: A.ctypes.data_as(dp)
+
+    # All arguments given: vectorized loop, a null argument: point by point
+    for null in [False, True]:
+      R0 = numpy.full((5,stride),7.)
+      R1 = numpy.full((1,stride),7.)
+      arg = (dp*sz_arg)(ptr(X), None if null else ptr(Y))
+      res = (dp*sz_res)(ptr(R0), None if null else ptr(R1))
+      iw = (ctypes.c_int*max(sz_iw,1))()
+      w = (ctypes.c_double*max(sz_w,1))()
+      self.assertEqual(lib.f_batch(arg,res,iw,w,N,stride),0)
+      for p in range(N):
+        r = f(X[:,p],DM.zeros(2) if null else Y[:,p])
+        self.checkarray(DM(R0[:,p]),r[0])
+        if not null: self.checkarray(R1[0,p],r[1])
+      self.assertTrue(numpy.all(R0[:,N:]==7))
+      if null: self.assertTrue(numpy.all(R1==7))
+
+  def test_codegen_precision(self):
+    x = SX.sym("x",5)
+    e = x
+    for i in range(10):
+      e = sin(e*x[i%5])*0.3 + e*e*0.1 + x
+    f = Function("f",[x],[e])
+    X = MX.sym("X",5)
+    A = MX.sym("A",5,5)
+    g = Function("g",[X,A],[mtimes(A.T(),X),dot(X,X)])
+    inputs = [DM([0.1,0.2,0.3,0.4,0.5])]
+
+    # Single precision intermediates, double interface
+    cg = CodeGenerator({"local_real_t": {"f": "float"}})
+    cg.add(f)
+    F2 = external("f", cg.compile("codegen_precision_f"))
+    self.checkarray(F2(*inputs),f(*inputs),digits=5)
+    self.assertTrue(float(norm_inf(F2(*inputs)-f(*inputs)))>0)
+
+    # Accumulation in extended precision
+    cg = CodeGenerator({"real_acc_t": "long double"})
+    cg.add(g)
+    G2 = external("g", cg.compile("codegen_precision_g"))
+    inputs = [DM([0.1,0.2,0.3,0.4,0.5]),DM([[cos(i*j) for i in range(5)] for j in range(5)])]
+    Gout = g.call(inputs)
+    Gout2 = G2.call(inputs)
+    for i in range(g.n_out()):
+      self.checkarray(Gout[i],Gout2[i])
+
+  def test_codegen_embedded(self):
+    x = SX.sym("x",3)
+    p = SX.sym("p")
+    g = Function("g",[x,p],[sin(x)*p,dot(x,x)])
+    X = MX.sym("X",3,4)
+    P = MX.sym("P")
+    r = g.map("gm","serial",4)(X,P)
+    f = Function("f",[X,P],[mtimes(r[0],r[0].T),r[1]])
+
+    cg = CodeGenerator({"embedded": True, "with_header": True})
+    cg.add(f)
+    F2 = external("f", cg.compile("codegen_embedded"))
+    inputs = [DM([[cos(i*j) for i in range(4)] for j in range(3)]), 2]
+    Fout = f.call(inputs)
+    Fout2 = F2.call(inputs)
+    for i in range(f.n_out()):
+      self.checkarray(Fout[i],Fout2[i])
+    code = cg.generate()
+    self.assertTrue("f_arena_eval" in code)
+    self.assertFalse("stdio" in code)
+    fp = cg.footprint()
+    self.assertTrue(fp["ram"]>0)
+    self.assertTrue(fp["rom"]>0)
+
+    # Evaluate through the arena entry point, with the buffers allocated by the caller
+    import ctypes
+    import subprocess
+    cg.generate("codegen_embedded_arena")
+    subprocess.Popen("gcc -fPIC -shared -O3 codegen_embedded_arena.c -o codegen_embedded_arena.so",
+                     shell=True).wait()
+    lib = ctypes.CDLL("./codegen_embedded_arena.so")
+    dp = ctypes.POINTER(ctypes.c_double)
+    x = [numpy.array(DM(i).nonzeros()) for i in inputs]
+    r = [numpy.zeros(f.nnz_out(i)) for i in range(f.n_out())]
+    arg = (dp*f.n_in())(*[i.ctypes.data_as(dp) for i in x])
+    res = (dp*f.n_out())(*[i.ctypes.data_as(dp) for i in r])
+    arena = (ctypes.c_double*(fp["ram"]//8))()
+    self.assertEqual(lib.f_arena_eval(arg,res,ctypes.byref(arena)),0)
+    for i in range(f.n_out()):
+      self.checkarray(DM(f.sparsity_out(i),r[i].tolist()),Fout[i])
+
+    # Printing is not possible without stdio
+    with self.assertRaises(Exception):
+      CodeGenerator({"embedded": True, "main": True})
+
 if __name__ == '__main__':
     unittest.main()
 
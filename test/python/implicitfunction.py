@@ -202,6 +202,19 @@ class ImplicitFunctiontests(casadiTestCase):
     solver_out = solver(-6)
     self.assertAlmostEqual(solver_out[0],-2*pi,5)
     
+  @requires_rootfinder("kinsol")
+  def test_kinsol_jtimes(self):
+    self.message("KINSol with an iterative linear solver, residual is not output 0")
+    x=SX.sym("x",2)
+    p=SX.sym("p")
+    res = vertcat(x[0]**2+x[1]-p, x[0]-x[1]**3+1)
+    f=Function("f", [x,p],[x[0]+x[1],res])
+    solver=rootfinder("solver", "kinsol", f, {"implicit_output":1,"linear_solver_type":"iterative",
+                                              "linear_solver":"csparse","abstol":1e-12})
+    solver_out = solver(DM([1,1]),2)
+    self.checkarray(f(solver_out[1],2)[1],DM.zeros(2),digits=8)
+    self.checkarray(solver_out[0],f(solver_out[1],2)[0],digits=8)
+
   def test_constraints(self):
     for Solver, options in solvers:
       if 'kinsol' in str(Solver): continue
@@ -281,6 +294,14 @@ class ImplicitFunctiontests(casadiTestCase):
     a = SX.sym("a",2)
     f = Function("f", [x,a],[tan(x)-a,sqrt(a)*x**2 ])
 
+  def test_codegen_newton(self):
+    x = SX.sym("x",3)
+    p = SX.sym("p",2)
+    r = vertcat(x[0]**2+x[1]-p[0], sin(x[1])+x[2]*x[0]-p[1], x[2]**3+x[0]-1)
+    f = Function("f", [x,p],[r,sum1(x)])
+    solver = rootfinder("solver", "newton", f, {"linear_solver": "symbolicqr"})
+    self.check_codegen(solver,inputs=[DM([1,0.5,1]),DM([1.2,0.7])])
+
 if __name__ == '__main__':
     unittest.main()
 
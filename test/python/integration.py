@@ -841,6 +841,29 @@ class Integrationtests(casadiTestCase):
     print array(H_out[0])
     
     
+  @requires_integrator("cvodes")
+  @requires_integrator("idas")
+  def test_iterative_jtimes(self):
+    self.message("CVodes and IDAS with iterative linear solvers, forward and adjoint")
+    y=SX.sym("y",2)
+    p=SX.sym("p")
+    dae={'x':y,'p':p,'ode':vertcat(y[1],-p*y[0]),'quad':y[0]**2}
+    for Integrator in ["cvodes","idas"]:
+      opts = {"linear_solver_type":"iterative","tf":1,"abstol":1e-10,"reltol":1e-10}
+      integrator = casadi.integrator("integrator", Integrator, dae, opts)
+      ref = casadi.integrator("ref", Integrator, dae, {"tf":1,"abstol":1e-10,"reltol":1e-10})
+      inputs = {"x0":DM([1,0]),"p":4}
+      out = integrator(**inputs)
+      self.checkarray(out["xf"],DM([cos(2),-2*sin(2)]),digits=6)
+      # Forward sensitivities
+      self.checkarray(integrator.jacobian("p","xf")(**inputs)["dxf_dp"],
+                      ref.jacobian("p","xf")(**inputs)["dxf_dp"],digits=6)
+      # Adjoint sensitivities, with the backward jtimes
+      P = MX.sym("p")
+      G = Function("G",[P],[gradient(integrator(x0=MX(DM([1,0])),p=P)["qf"],P)])
+      Gref = Function("Gref",[P],[gradient(ref(x0=MX(DM([1,0])),p=P)["qf"],P)])
+      self.checkarray(G(4),Gref(4),digits=6)
+
   def test_mathieu_system(self):
     self.message("Mathieu ODE")
     A=array([0.3,1.2])
@@ -1048,7 +1071,22 @@ class Integrationtests(casadiTestCase):
     for k in range(1,10):
       r = [0] + collocation_points(k,"legendre")
       self.assertEqual(len(r),k+1) 
-      
+
+  def test_codegen_collocation(self):
+    x = SX.sym("x",2)
+    z = SX.sym("z")
+    p = SX.sym("p")
+    dae = {'x': x, 'z': z, 'p': p, 'ode': vertcat(x[1],-p*x[0]+z),
+           'alg': z-0.1*x[0]*x[1]+0.1*z**3, 'quad': x[0]**2}
+    opts = {"tf": 1, "number_of_finite_elements": 10, "grid": [0, 0.25, 0.6, 1],
+            "output_t0": True, "rootfinder_options": {"linear_solver": "symbolicqr"}}
+    I = integrator("I", "collocation", dae, opts)
+    self.check_codegen(I,inputs=[DM([1,0]),2,0.1,DM(),DM(),DM()])
+
+    # Backward problem
+    Ir = I.reverse(1)
+    self.check_codegen(Ir,inputs=[DM.ones(Ir.sparsity_in(i)) for i in range(Ir.n_in())])
+
 if __name__ == '__main__':
     unittest.main()
 
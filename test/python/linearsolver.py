@@ -442,6 +442,26 @@ class LinearSolverTests(casadiTestCase):
         f_out = f(A, b)
 
         self.checkarray(mtimes(A_,f_out),b)
-      
+
+  def test_sparsefact(self):
+    numpy.random.seed(1)
+    n = 10
+    A = self.randDM(n,n,sparsity=0.3) + 5*DM.eye(n)
+    H = A + A.T
+    b = self.randDM(n,3)
+
+    for options in [{"method":"qr"},{"method":"lu"},{"method":"ldl"},{"method":"lu","amd":False}]:
+      M = H if options["method"]=="ldl" else A
+      F = linsol("F","sparsefact",M.sparsity(),3,options)
+      self.checkarray(mtimes(M,F(M,b)),b)
+
+      As = MX.sym("A",M.sparsity())
+      bs = MX.sym("B",b.sparsity())
+      for As_,A_ in [(As,M),(As.T,M.T)]:
+        f = Function("f", [As,bs],[solve(As_,bs,"sparsefact",options)])
+        self.checkarray(mtimes(A_,f(M,b)),b)
+
+      self.check_codegen(F,inputs=[M,b])
+
 if __name__ == '__main__':
     unittest.main()
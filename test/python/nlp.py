@@ -128,6 +128,32 @@ class NLPtests(casadiTestCase):
       self.assertAlmostEqual(solver_out["lam_x"][0],0,9,str(Solver))
       self.assertAlmostEqual(solver_out["lam_g"][0],0,9,str(Solver))
       
+  def test_memoize(self):
+    x=SX.sym("x",2)
+    p=SX.sym("p")
+    nlp={'x':x, 'p':p, 'f':(1-x[0])**2+p*(x[1]-x[0]**2)**2, 'g':x[0]+x[1]}
+
+    for Solver, solver_options in solvers:
+      self.message("memoize " + str(Solver))
+      solver_in = {"x0": [-1.2, 1], "lbg": -10, "ubg": 1.5, "p": 100}
+      sol = []
+      iter_count = []
+      for memoize in [True, False]:
+        opts = dict(solver_options)
+        opts["memoize"] = memoize
+        solver = nlpsol("mysolver", Solver, nlp, opts)
+        sol.append(solver(**solver_in))
+        stats = solver.stats()
+        if Solver in ["ipopt", "sqpmethod"]:
+          self.assertEqual("n_call_nlp_fg_jac" in stats, memoize)
+        if "iter_count" in stats:
+          iter_count.append(stats["iter_count"])
+      for k in ["x", "f", "lam_g"]:
+        self.checkarray(sol[0][k],sol[1][k],str(Solver),digits=8)
+      # Same iterates, memoization only saves evaluations
+      if len(iter_count)==2:
+        self.assertEqual(iter_count[0],iter_count[1])
+
   def testIPOPTinf(self):
     self.message("trivial IPOPT, infinity bounds")
     x=SX.sym("x")
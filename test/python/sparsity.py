@@ -29,6 +29,7 @@ from types import *
 from helpers import *
 import numpy 
 import random
+import os
 
 class Sparsitytests(casadiTestCase):
   def test_union(self):
@@ -151,6 +152,42 @@ class Sparsitytests(casadiTestCase):
     b = Sparsity.triplet(4,5,[i[0] for i in nza],[i[1] for i in nza])
     self.checkarray(self.tomatrix(a),self.tomatrix(b),"rowcol")
 
+  def test_sparsity_cache(self):
+    import tempfile
+    import shutil
+    d = tempfile.mkdtemp()
+    try:
+      GlobalOptions.setSparsityCacheDir(d)
+      x = SX.sym("x",200)
+      y = sin(x)*x[list(range(1,200))+[0]]
+      ref = Function('f', [x],[y]).jacobian().sparsity_out(0)
+      self.assertTrue(len(os.listdir(d))>0)
+      self.assertFalse(os.path.exists(os.path.join(d,"index.txt")))
+
+      # A hit marks the entry as used, a miss would replace the file
+      files = {}
+      for e in os.listdir(d):
+        p = os.path.join(d,e)
+        os.utime(p,(1,1))
+        files[e] = os.stat(p).st_ino
+      J = Function('f', [x],[y]).jacobian()
+      self.assertTrue(J.sparsity_out(0)==ref)
+      self.assertEqual(sorted(os.listdir(d)),sorted(files.keys()))
+      for e in files:
+        self.assertEqual(os.stat(os.path.join(d,e)).st_ino,files[e])
+      self.assertTrue(any(os.stat(os.path.join(d,e)).st_mtime>1 for e in files))
+
+      # Eviction keeps the directory within its limit, apart from the newest entry
+      GlobalOptions.setSparsityCacheSize(1)
+      for n in range(5,10):
+        x = SX.sym("x",n)
+        J = Function('f', [x],[sin(x)*x[0]]).jacobian()
+      self.assertEqual(len(os.listdir(d)),1)
+    finally:
+      GlobalOptions.setSparsityCacheSize(100*1024*1024)
+      GlobalOptions.setSparsityCacheDir("")
+      shutil.rmtree(d)
+
   def test_rowcol(self):
     self.message("rowcol constructor")
     
@@ -470,7 +507,17 @@ class Sparsitytests(casadiTestCase):
     J = g.jacobian()
         
     self.assertTrue(DM(J.sparsity_out(0))[:X.nnz(),:].sparsity()==Sparsity.diag(100))
-    
+
+  def test_jacsparsity_threads(self):
+    x = SX.sym("x",1000)
+    y = sin(x)*x[list(range(1,1000))+[0]]
+    f = sumsqr(y)+dot(x[:500],x[500:])
+    for expr, symmetric in [(y, False), (gradient(f,x), True)]:
+      ref = Function('g', [x],[expr]).sparsity_jac(0,0,False,symmetric)
+      for n_threads in [0,2,4]:
+        g = Function('g', [x],[expr], {'n_threads_sp': n_threads})
+        self.assertTrue(g.sparsity_jac(0,0,False,symmetric)==ref)
+
   def test_rowcol(self):
     n = 3
     
@@ -0,0 +1,118 @@
+#
+#     This file is part of CasADi.
+#
+#     CasADi -- A symbolic framework for dynamic optimization.
+#     Copyright (C) 2010-2014 Joel Andersson, Joris Gillis, Moritz Diehl,
+#                             K.U. Leuven. All rights reserved.
+#     Copyright (C) 2011-2014 Greg Horn
+#
+#     CasADi is free software; you can redistribute it and/or
+#     modify it under the terms of the GNU Lesser General Public
+#     License as published by the Free Software Foundation; either
+#     version 3 of the License, or (at your option) any later version.
+#
+#     CasADi is distributed in the hope that it will be useful,
+#     but WITHOUT ANY WARRANTY; without even the implied warranty of
+#     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#     Lesser General Public License for more details.
+#
+#     You should have received a copy of the GNU Lesser General Public
+#     License along with CasADi; if not, write to the Free Software
+#     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+#
+#
+"""
+Timings to guide the choice between alternative implementations.
+Not a unit test, run directly: python speed.py
+"""
+from casadi import *
+from time import time
+
+def timeit(fun,repeat=1):
+  t = time()
+  for i in range(repeat): fun()
+  return (time()-t)/repeat
+
+def jacobian_construction():
+  print "Jacobian: symbolic expression vs compressed numeric evaluation"
+  print "%8s %12s %14s %14s %14s" % ("N","strategy","construct [s]","evaluate [s]","total x100 [s]")
+  for N in [100,1000,10000]:
+    x = SX.sym("x",N)
+    # Banded Jacobian with a dense row, i.e. a handful of colors
+    y = vertcat(sin(x[1:])*x[:-1]+x[1:]**2,sum1(x**2))
+    x0 = DM([cos(i) for i in range(N)])
+    for compressed in [False,True]:
+      opts = {"compressed_jacobian":compressed}
+      t_construct = timeit(lambda: Function("f",[x],[y],opts).jacobian(0,0))
+      J = Function("f",[x],[y],opts).jacobian(0,0)
+      t_eval = timeit(lambda: J(x0),10)
+      print "%8d %12s %14.3e %14.3e %14.3e" % (N,"compressed" if compressed else "symbolic",t_construct,t_eval,t_construct+100*t_eval)
+
+def batch_evaluation():
+  print "Evaluation for independent inputs: loop vs map vs call_batch"
+  print "%8s %12s %14s" % ("N","strategy","evaluate [s]")
+  x = SX.sym("x",10)
+  p = SX.sym("p",2)
+  f = Function("f",[x,p],[sin(x)*p[0]+cos(x)*p[1],dot(x,x)])
+  for N in [100,1000,10000]:
+    args = [[DM([cos(i*k) for i in range(10)]),DM([k,1])] for k in range(N)]
+    t_loop = timeit(lambda: [f(*a) for a in args])
+    fmap = f.map("fmap","serial",N)
+    xcat = hcat([a[0] for a in args])
+    pcat = hcat([a[1] for a in args])
+    t_map = timeit(lambda: fmap(xcat,pcat))
+    print "%8d %12s %14.3e" % (N,"loop",t_loop)
+    print "%8d %12s %14.3e" % (N,"map",t_map)
+    for n_threads in [1,4]:
+      t_batch = timeit(lambda: f.call_batch(args,n_threads))
+      print "%8d %12s %14.3e" % (N,"batch (%d)" % n_threads,t_batch)
+
+def codegen_modes():
+  print "Generated code: default vs single assignment vs restrict-qualified pointers"
+  print "%8s %12s %14s %14s" % ("nodes","mode","compile [s]","evaluate [s]")
+  modes = [("default",{}),
+           ("ssa",{"single_assignment":True}),
+           ("restrict",{"with_restrict":True}),
+           ("ssa+restrict",{"single_assignment":True,"with_restrict":True})]
+  for n in [10,40]:
+    x = SX.sym("x",50)
+    y = SX.sym("y",2)
+    e = x
+    for i in range(n):
+      e = sin(e*x[i%50]) + e*e*y[i%2] + x
+    f = Function("f",[x,y],[e,sum1(e)])
+    args = [DM([0.1]*50),DM([0.3,-0.5])]
+    for k, (mode, opts) in enumerate(modes):
+      cg = CodeGenerator(opts)
+      cg.add(f)
+      name = "speed_codegen_%d_%d" % (n,k)
+      t = time()
+      lib = cg.compile(name)
+      t_compile = time()-t
+      fe = external("f",lib)
+      t_eval = timeit(lambda: fe(*args),1000)
+      print "%8d %12s %14.3e %14.3e" % (f.n_nodes(),mode,t_compile,t_eval)
+
+def codegen_precision():
+  print "Generated code: double vs single precision intermediates"
+  print "%8s %12s %14s %14s" % ("nodes","local_real_t","rel. error","evaluate [s]")
+  x = SX.sym("x",50)
+  e = x
+  for i in range(40):
+    e = sin(e*x[i%50])*0.3 + e*e*0.1 + x
+  f = Function("f",[x],[e])
+  x0 = DM([0.3]*50)
+  ref = f(x0)
+  for lt in ["real_t","float"]:
+    cg = CodeGenerator({"local_real_t":lt})
+    cg.add(f)
+    fe = external("f",cg.compile("speed_precision_%s" % lt))
+    err = float(norm_inf(fe(x0)-ref)/norm_inf(ref))
+    t_eval = timeit(lambda: fe(x0),1000)
+    print "%8d %12s %14.3e %14.3e" % (f.n_nodes(),lt,err,t_eval)
+
+if __name__ == '__main__':
+  jacobian_construction()
+  batch_evaluation()
+  codegen_modes()
+  codegen_precision()
@@ -1229,7 +1229,37 @@ class SXtests(casadiTestCase):
         is_smooth(x)
       warnings.simplefilter("ignore")
       is_smooth(x)
-    
+
+  def test_just_in_time_native(self):
+    import platform
+    x = SX.sym("x",4)
+    y = SX.sym("y")
+
+    # Only x86_64 Linux and macOS are supported, other platforms reject the option
+    if platform.machine() not in ["x86_64","AMD64"] or platform.system() not in ["Linux","Darwin"]:
+      with self.assertRaises(Exception):
+        Function("g",[x,y],[x[0]+y],{"just_in_time_native":True})
+      return
+
+    e = [x[0]+y, x[1]-x[2], x[0]*x[3], x[1]/y, -x[0], x[1]**2, 1/x[3], sqrt(fabs(x[0])),
+         fmin(x[0],x[1]), fmax(x[2],y), x[0]<x[1], x[0]<=x[2], x[1]==x[2], x[0]!=y,
+         logic_not(x[0]), logic_and(x[0],x[1]), logic_or(x[2],x[3]), if_else(x[1]>0,x[2],0),
+         sin(x[0]), exp(x[1]), log(fabs(x[2])+1), atan2(x[0],x[1]), floor(x[2]), erf(x[3]),
+         sign(x[0]), 3.5]
+    z = x[0]
+    for k in range(100):
+      z = z*x[k%4]*0.5 + sin(z) - y/(1+z**2)
+    e.append(z)
+    f = Function("f",[x,y],[vertcat(*e)])
+    g = Function("g",[x,y],[vertcat(*e)],{"just_in_time_native":True})
+    for x0 in [[0.3,-1.2,2.5,0.7],[0,0,0,0],[1,-2,0,4]]:
+      self.checkarray(g(x0,-3),f(x0,-3),digits=15)
+
+    # Missing input argument
+    f = Function("f",[x,y],[vertcat(*e),z])
+    g = Function("g",[x,y],[vertcat(*e),z],{"just_in_time_native":True})
+    self.checkarray(g.call({"i0":[1,2,3,4]})["o1"],f.call({"i0":[1,2,3,4]})["o1"],digits=15)
+
 if __name__ == '__main__':
     unittest.main()
 